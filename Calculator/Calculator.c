@@ -12,6 +12,14 @@
  * Process: in each iteration parsing the expression that is given  by the user converts it to postfix
  * and evaluate it.
  * Output : prints the infix presentation, postfix presentation and the value
+ *
+ * With -c <expression> <table.csv> the expression may refer to the columns of the table by name, it is compiled
+ * once and its value is printed for every row of the table. -J does the same with the expression compiled to
+ * native code when possible.
+ * With -s [<expressions file>] every line of the file (or of the standard input) is evaluated and only its value
+ * is printed, this is the high throughput batch mode. With -j <threads> the lines are evaluated by a pool of
+ * worker threads and printed in their original order. With -w the lines are evaluated in 64 bits and a line
+ * that overflows is printed as overflow.
  */
 
 
@@ -22,46 +30,33 @@
 #include <memory.h>
 #include <math.h>
 #include <errno.h>
+#include <unistd.h>
 #include "stack.h"
 #include "inFix.h"
 #include "postFix.h"
 #include "Tools.h"
+#include "byteCode.h"
+#include "columns.h"
+#include "parser.h"
+#include "batch.h"
+#include "pipeline.h"
+#include "optimizer.h"
+#include "jit.h"
+#include "server.h"
 
 // -------------------------- const definitions -------------------------
 
 #define MAX_LINE 100
-#define END_OF_LINE '\n'
-#define EMPTY_STR '\0'
+#define COLUMNS_FLAG "-c"
+#define JIT_FLAG "-J"
+#define STREAM_FLAG "-s"
+#define THREADS_FLAG "-j"
+#define WIDE_FLAG "-w"
+#define BIG_FLAG "-b"
+#define SERVER_FLAG "-d"
 
 // ------------------------------ functions -----------------------------
 
-/**
- * This function is given a string and counts the number of digits from the beginning till the first non digit char
- * @param buffer a string that includes math expression
- * @param charsNum the number of chars in the main expression
- * @return the number of digits till there is a type that is not a digit
- */
-size_t getDigitNum(const char *buffer, int charsNum)
-{
-    size_t digitCounter = 0;
-    while (isItDigit(charsNum, buffer))
-    {
-        digitCounter++;
-        charsNum++;
-    }
-    return digitCounter;
-}
-
-/**
- *Finds if the given char is operator
- * @param type the type of the given char
- * @return non-zero if true and false otherwise
- */
-int isOperator(char type)
-{
-    return type == plus || type == minus || type == mul || type == division || type == power;
-}
-
 /**
 * This function is given mathematical expression presented and prints it
 * @param valueNum The number of values
@@ -88,40 +83,38 @@ void printExpression(int valueNum, const MathObject *expression, char *order)
 
 /**
  * This function is given mathematical expressions presented by postfix
- * calculates its value and prints it.
+ * calculates its value and prints it. The expression is simplified, an expression that folds to a constant needs
+ * no evaluation and any other is compiled to byte code and evaluated by the VM. Malformed expressions and failed
+ * evaluations fall back to calculatePostfix which reports the error.
  * @param postFix mathematical expressions presented by postfix
  * @param len length of the mathematical expressions
  */
 void printValue(MathObject *postFix, int len)
 {
-    int theValue = calculatePostfix(postFix, len);
+    int theValue, optimizedLen;
+    ByteCode *byteCode = NULL;
+    MathObject *optimized = optimizePostfix(postFix, len, &optimizedLen);
+    if (optimized != NULL && optimizedLen == 1)
+    {
+        theValue = optimized[0].value;
+    }
+    else
+    {
+        if (optimized != NULL)
+        {
+            byteCode = compileByteCode(optimized, optimizedLen);
+        }
+        if (byteCode == NULL || runByteCode(byteCode, NULL, &theValue) != EVAL_OK)
+        {
+            theValue = calculatePostfix(postFix, len);
+        }
+    }
+    free(optimized);
+    freeByteCode(byteCode);
     printf("The value is %d", theValue);
     printf("\n");
 }
 
-/**
- *This function is given mathematical expression and store the digits from a certain place till it meets non-digit char
- *and then it converts the digits into number and store it in the given array
- * @param valuesNum Number of value in the expression
- * @param capacity The current capacity of memory that allocated for the container of the string that
- * represents a number
- * @param inPut The array that will be contain the infix expression
- * @param buffer The container for the whole expression
- * @param charsNum
- * @param num container for the string that represents a number
- * @return
- */
-int parseNumber(char *buffer, char *num, size_t digitCounter)
-{
-    num[digitCounter] = EMPTY_STR;
-    strncpy(num, buffer, digitCounter);
-    char *temp = num;
-
-
-    return convertStrToInt(temp);
-}
-
-
 /**
  * This function generates and prints the output of the program
  * @param valuesNum Number of value in the expression
@@ -143,59 +136,192 @@ void generateOutput(int valuesNum, int parenthesisNum, MathObject *infix)
  */
 void runCalculator()
 {
-    int counterChars, counterValues, counterPars;
+    int counterValues, counterPars;
 
     MathObject inPut[MAX_LINE];
     char *buffer = malloc(MAX_LINE);
-    char *num = NULL;
-    char currType;
-    int currNum = 0;
 
     while (fgets(buffer, MAX_LINE, stdin))
     {
-        counterChars = 0, counterValues = 0, counterPars = 0;
-        while (buffer[counterChars] != END_OF_LINE)
+        counterValues = parseLine(buffer, MAX_LINE, inPut, &counterPars, NULL, 0);
+        if (counterValues == PARSE_OVERFLOW)
+        {
+            fprintf(stderr, "Error: input is not a valid Integer\n");
+            exit(EXIT_FAILURE);
+        }
+        generateOutput(counterValues, counterPars, inPut);
+    }
+    free(buffer);
+}
+
+/**
+ * This function prints the values of the given rows, rows whose evaluation failed are printed as nan
+ */
+void printColumnResults(const int *results, const char *failed, size_t rows)
+{
+    size_t r;
+    for (r = 0; r < rows; r++)
+    {
+        if (failed[r])
+        {
+            fprintf(stderr, failed[r] == EVAL_OVERFLOW ? "Overflow in row %zu\n" : "Division by 0 in row %zu\n", r + 1);
+            printf("nan\n");
+        }
+        else
+        {
+            printf("%d\n", results[r]);
+        }
+    }
+}
+
+/**
+ * This function runs the calculator over a table. The expression is compiled once, its variables are the columns
+ * of the table and it is evaluated for every row of the table block by block, or row by row by native code.
+ * @param expression mathematical expression presented by infix
+ * @param fileName the name of the CSV file that holds the table
+ * @param useJit non zero to evaluate the expression by native code, expressions the JIT can't compile are
+ * evaluated by the VM
+ * @return EXIT_SUCCESS in success and EXIT_FAILURE otherwise
+ */
+int runColumns(const char *expression, const char *fileName, int useJit)
+{
+    int len, parenthesisNum;
+    FILE *file = fopen(fileName, "r");
+    if (file == NULL)
+    {
+        fprintf(stderr, "Error opening file: %s\n", fileName);
+        return EXIT_FAILURE;
+    }
+    Table *table = readTable(file);
+    fclose(file);
+    if (table == NULL)
+    {
+        return EXIT_FAILURE;
+    }
+
+    MathObject *infix = (MathObject *) allocateMemory((strlen(expression) + 1) * sizeof(MathObject));
+    len = parseLine(expression, strlen(expression), infix, &parenthesisNum, table, 0);
+    if (len == PARSE_OVERFLOW)
+    {
+        fprintf(stderr, "Error: input is not a valid Integer\n");
+    }
+    ByteCode *byteCode = NULL;
+    if (len > 0)
+    {
+        int optimizedLen;
+        MathObject *postfix = inToPost(infix, len);
+        MathObject *optimized = optimizePostfix(postfix, len - parenthesisNum, &optimizedLen);
+        if (optimized != NULL)
         {
-            currType = buffer[counterChars];
-            if (isItDigit(counterChars, buffer))
+            byteCode = compileByteCode(optimized, optimizedLen);
+        }
+        free(optimized);
+        free(postfix);
+    }
+    free(infix);
+    if (byteCode == NULL)
+    {
+        fprintf(stderr, "Can't evaluate expression\n");
+        freeTable(table);
+        return EXIT_FAILURE;
+    }
+
+    int *results = (int *) allocateMemory((table->rows + 1) * sizeof(int));
+    char *failed = (char *) allocateMemory(table->rows + 1);
+    JitCode *jitCode = useJit ? compileJit(byteCode) : NULL;
+    EvalStatus status;
+    if (jitCode != NULL)
+    {
+        status = runJitRows(jitCode, byteCode->variablesNum, (const int *const *) table->columns, table->rows,
+                            results, failed);
+    }
+    else
+    {
+        status = runByteCodeBlock(byteCode, (const int *const *) table->columns, table->rows, results, failed);
+    }
+    if (status == EVAL_NO_MEMORY)
+    {
+        fprintf(stderr, "Error: out of memory\n");
+    }
+    else
+    {
+        printColumnResults(results, failed, table->rows);
+    }
+    free(results);
+    free(failed);
+    freeJit(jitCode);
+    freeByteCode(byteCode);
+    freeTable(table);
+    return status == EVAL_OK ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * Runs the calculator program
+ *
+ * @return EXIT_SUCCESS if successful and EXIT_FAILURE otherwise
+ */
+int main(int argc, char **argv)
+{
+    if (argc == 4 && (strcmp(argv[1], COLUMNS_FLAG) == 0 || strcmp(argv[1], JIT_FLAG) == 0))
+    {
+        return runColumns(argv[2], argv[3], strcmp(argv[1], JIT_FLAG) == 0);
+    }
+    if ((argc == 3 || argc == 5) && strcmp(argv[1], SERVER_FLAG) == 0)
+    {
+        int threadsNum = (int) sysconf(_SC_NPROCESSORS_ONLN);
+        if (argc == 5 && strcmp(argv[3], THREADS_FLAG) == 0)
+        {
+            threadsNum = atoi(argv[4]);
+        }
+        if (threadsNum > 0 && (argc == 3 || strcmp(argv[3], THREADS_FLAG) == 0))
+        {
+            return runServer(argv[2], threadsNum);
+        }
+    }
+    else if (argc >= 2 && argc <= 6 && strcmp(argv[1], STREAM_FLAG) == 0)
+    {
+        int threadsNum = 0;
+        Arithmetic arithmetic = ARITHMETIC_INT;
+        const char *fileName = NULL;
+        int i;
+        for (i = 2; i < argc; i++)
+        {
+            if (strcmp(argv[i], THREADS_FLAG) == 0 && i + 1 < argc)
             {
-                char *p = (buffer + counterChars);
-                size_t digitCounter;
-                digitCounter = getDigitNum(buffer, counterChars);
-                counterChars += digitCounter;
-
-                num = malloc(digitCounter + 1);
-                char *temp = num;
-                currNum = parseNumber(p, num, digitCounter);
-                inPut[counterValues].value = currNum;
-                inPut[counterValues].type = operand;
-                free(temp);
+                threadsNum = atoi(argv[++i]);
             }
-            else if (isOperator(currType) || currType == lPar || currType == rPar)
+            else if (strcmp(argv[i], WIDE_FLAG) == 0)
             {
-                inPut[counterValues].type = buffer[counterChars];
-
-                if (currType == lPar || currType == rPar)
-                {
-                    counterPars++;
-                }
-                counterChars++;
+                arithmetic = ARITHMETIC_WIDE;
+            }
+            else if (strcmp(argv[i], BIG_FLAG) == 0)
+            {
+                arithmetic = ARITHMETIC_BIG;
+            }
+            else if (fileName == NULL)
+            {
+                fileName = argv[i];
             }
             else
             {
-                counterChars++;
-                counterValues--;
+                threadsNum = -1;
             }
-            counterValues++;
         }
-
-        generateOutput(counterValues, counterPars, inPut);
+        if (threadsNum == 0)
+        {
+            return runBatch(fileName, arithmetic);
+        }
+        if (threadsNum > 0)
+        {
+            return runPipeline(fileName, threadsNum, arithmetic);
+        }
     }
-    free(buffer);
-}
-
-int main()
-{
-    runCalculator();
-    return 0;
+    else if (argc == 1)
+    {
+        runCalculator();
+        return 0;
+    }
+    fprintf(stdout, "Usage: calc [-c|-J <expression> <table.csv> | -s [-j <threads>] [-w|-b] [<expressions file>] | "
+                    "-d <socket> [-j <threads>]]\n");
+    return EXIT_FAILURE;
 }
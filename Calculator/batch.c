@@ -0,0 +1,423 @@
+// ------------------------------ includes -----------------------------
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "stack.h"
+#include "inFix.h"
+#include "postFix.h"
+#include "parser.h"
+#include "bigInt.h"
+#include "batch.h"
+
+// -------------------------- const definitions -------------------------
+
+#define CHUNK_SIZE (1 << 20)
+
+#define MAX_INT_CHARS 21
+
+#define END_OF_LINE '\n'
+
+#define FAILURE_STR "nan\n"
+
+#define OVERFLOW_STR "overflow\n"
+
+// ------------------------------ functions -----------------------------
+
+/**
+ * This function initializes the buffers of a batch
+ * @param batch the batch
+ * @param sink the stream the output is flushed to, or NULL to keep the whole output in the buffer
+ * @param arithmetic the arithmetic the lines are evaluated with
+ * @return 0 in success and non zero otherwise, the batch must be freed either way
+ */
+int initBatch(Batch *batch, FILE *sink, Arithmetic arithmetic)
+{
+    size_t operandSize = arithmetic == ARITHMETIC_BIG ? sizeof(Number) :
+                         arithmetic == ARITHMETIC_WIDE ? sizeof(long long) : sizeof(int);
+    memset(batch, 0, sizeof(Batch));
+    batch->sink = sink;
+    batch->arithmetic = arithmetic;
+    batch->capacity = MAX_LINE;
+    batch->outputCapacity = OUTPUT_SIZE;
+    batch->infix = malloc(batch->capacity * sizeof(MathObject));
+    batch->postfix = malloc(batch->capacity * sizeof(MathObject));
+    batch->operators = stackAlloc(sizeof(char));
+    batch->operands = stackAlloc(operandSize);
+    batch->output = malloc(batch->outputCapacity);
+    return batch->infix == NULL || batch->postfix == NULL || batch->operators == NULL || batch->operands == NULL ||
+           batch->output == NULL;
+}
+
+/**
+ * Frees the buffers of a batch
+ * @param batch the batch
+ */
+void freeBatch(Batch *batch)
+{
+    free(batch->infix);
+    free(batch->postfix);
+    freeStack(&batch->operators);
+    freeStack(&batch->operands);
+    free(batch->output);
+}
+
+/**
+ * This function makes sure the expression buffers of the batch can hold the given number of objects
+ * @return 0 in success and non zero otherwise
+ */
+int reserveObjects(Batch *batch, size_t len)
+{
+    size_t capacity = batch->capacity;
+    if (len <= capacity)
+    {
+        return 0;
+    }
+    while (capacity < len)
+    {
+        capacity *= 2;
+    }
+    MathObject *infix = realloc(batch->infix, capacity * sizeof(MathObject));
+    if (infix == NULL)
+    {
+        return 1;
+    }
+    batch->infix = infix;
+    MathObject *postfix = realloc(batch->postfix, capacity * sizeof(MathObject));
+    if (postfix == NULL)
+    {
+        return 1;
+    }
+    batch->postfix = postfix;
+    batch->capacity = capacity;
+    return 0;
+}
+
+/**
+ * This function writes the buffered output of the batch to its sink
+ */
+void flushOutput(Batch *batch)
+{
+    fwrite(batch->output, 1, batch->outputLen, batch->sink);
+    batch->outputLen = 0;
+}
+
+/**
+ * This function makes sure the output of the batch has room for len more chars, by flushing it to the sink or, if
+ * the batch has no sink or the flushed buffer is still too small, by growing it
+ * @return 0 in success and non zero otherwise
+ */
+int reserveOutput(Batch *batch, size_t len)
+{
+    size_t capacity = batch->outputCapacity;
+    if (batch->outputLen + len <= capacity)
+    {
+        return 0;
+    }
+    if (batch->sink != NULL)
+    {
+        flushOutput(batch);
+    }
+    while (batch->outputLen + len > capacity)
+    {
+        capacity *= 2;
+    }
+    if (capacity == batch->outputCapacity)
+    {
+        return 0;
+    }
+    char *grown = realloc(batch->output, capacity);
+    if (grown == NULL)
+    {
+        return 1;
+    }
+    batch->output = grown;
+    batch->outputCapacity = capacity;
+    return 0;
+}
+
+/**
+ * This function appends the given value and a new line to the output of the batch
+ */
+void appendValue(Batch *batch, long long value)
+{
+    char digits[MAX_INT_CHARS];
+    int digitsNum = 0;
+    unsigned long long magnitude = value < 0 ? 0ull - (unsigned long long) value : (unsigned long long) value;
+    if (reserveOutput(batch, MAX_INT_CHARS))
+    {
+        batch->failures++;
+        return;
+    }
+    do
+    {
+        digits[digitsNum++] = (char) ('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude != 0);
+    if (value < 0)
+    {
+        batch->output[batch->outputLen++] = '-';
+    }
+    while (digitsNum > 0)
+    {
+        batch->output[batch->outputLen++] = digits[--digitsNum];
+    }
+    batch->output[batch->outputLen++] = END_OF_LINE;
+}
+
+/**
+ * This function appends a failed evaluation to the output of the batch
+ * @param batch the batch
+ * @param text the text that is printed instead of the value
+ */
+void appendFailure(Batch *batch, const char *text)
+{
+    batch->failures++;
+    if (reserveOutput(batch, strlen(text)))
+    {
+        return;
+    }
+    memcpy(batch->output + batch->outputLen, text, strlen(text));
+    batch->outputLen += strlen(text);
+}
+
+/**
+ * This function appends the given number and a new line to the output of the batch
+ */
+void appendNumber(Batch *batch, const Number *number)
+{
+    if (number->big == NULL)
+    {
+        appendValue(batch, number->small);
+        return;
+    }
+    char *digits = bigToString(number->big);
+    if (digits == NULL || reserveOutput(batch, strlen(digits) + 1))
+    {
+        free(digits);
+        appendFailure(batch, FAILURE_STR);
+        return;
+    }
+    memcpy(batch->output + batch->outputLen, digits, strlen(digits));
+    batch->outputLen += strlen(digits);
+    batch->output[batch->outputLen++] = END_OF_LINE;
+    free(digits);
+}
+
+/**
+ * This function evaluates mathematical expression presented by postfix with the arithmetic of the batch
+ * @param line the line the expression was parsed from, with its literals
+ * @param len the length of the line
+ * @param value container for the value, must be freed with numberFree
+ * @return EVAL_OK in success and the reason of the failure otherwise
+ */
+EvalStatus evaluateBatchPostfix(Batch *batch, int postfixLen, const char *line, size_t len, Number *value)
+{
+    int narrowValue;
+    value->big = NULL;
+    if (batch->arithmetic == ARITHMETIC_BIG)
+    {
+        return evaluatePostfixBig(batch->postfix, postfixLen, batch->operands, line, len, value);
+    }
+    if (batch->arithmetic == ARITHMETIC_WIDE)
+    {
+        return evaluatePostfix64(batch->postfix, postfixLen, batch->operands, line, len, &value->small);
+    }
+    EvalStatus status = evaluatePostfix(batch->postfix, postfixLen, batch->operands, &narrowValue);
+    value->small = narrowValue;
+    return status;
+}
+
+/**
+ * This function evaluates a single line and appends its value to the output of the batch
+ * @param batch the batch
+ * @param line the line, without its new line
+ * @param len the length of the line
+ */
+void evaluateLine(Batch *batch, const char *line, size_t len)
+{
+    int parenthesisNum;
+    Number value;
+    if (reserveObjects(batch, len + 1))
+    {
+        appendFailure(batch, FAILURE_STR);
+        return;
+    }
+    int infixLen = parseLine(line, len, batch->infix, &parenthesisNum, NULL, batch->arithmetic != ARITHMETIC_INT);
+    if (infixLen <= 0)
+    {
+        appendFailure(batch, FAILURE_STR);
+        return;
+    }
+    int postfixLen = convertToPostfix(batch->infix, infixLen, batch->postfix, batch->operators);
+    if (postfixLen < 0)
+    {
+        appendFailure(batch, FAILURE_STR);
+        return;
+    }
+    EvalStatus status = evaluateBatchPostfix(batch, postfixLen, line, len, &value);
+    if (status != EVAL_OK)
+    {
+        appendFailure(batch, status == EVAL_OVERFLOW ? OVERFLOW_STR : FAILURE_STR);
+        return;
+    }
+    appendNumber(batch, &value);
+    numberFree(&value);
+}
+
+/**
+ * This function evaluates every complete line of the given data
+ * @param batch the batch
+ * @param data the lines
+ * @param len the length of the data
+ * @return the number of bytes that were consumed, the rest is a partial line
+ */
+size_t evaluateLines(Batch *batch, const char *data, size_t len)
+{
+    const char *line = data;
+    const char *end = data + len;
+    const char *newLine;
+    while ((newLine = memchr(line, END_OF_LINE, (size_t) (end - line))) != NULL)
+    {
+        evaluateLine(batch, line, (size_t) (newLine - line));
+        line = newLine + 1;
+    }
+    return (size_t) (line - data);
+}
+
+/**
+ * This function evaluates every line of the given data, including a last line that has no new line
+ * @param batch the batch
+ * @param data the lines
+ * @param len the length of the data
+ */
+void evaluateData(Batch *batch, const char *data, size_t len)
+{
+    size_t consumed = evaluateLines(batch, data, len);
+    if (consumed < len)
+    {
+        evaluateLine(batch, data + consumed, len - consumed);
+    }
+}
+
+/**
+ * This function evaluates the lines of a stream, reading it in large chunks. A line that is longer than the chunk
+ * grows the chunk.
+ * @return 0 in success and non zero otherwise
+ */
+int runStream(Batch *batch, FILE *file)
+{
+    size_t capacity = CHUNK_SIZE, carry = 0, readNum;
+    char *chunk = malloc(capacity);
+    if (chunk == NULL)
+    {
+        return 1;
+    }
+    while ((readNum = fread(chunk + carry, 1, capacity - carry, file)) > 0)
+    {
+        size_t total = carry + readNum;
+        size_t consumed = evaluateLines(batch, chunk, total);
+        carry = total - consumed;
+        memmove(chunk, chunk + consumed, carry);
+        if (carry == capacity)
+        {
+            char *grown = realloc(chunk, 2 * capacity);
+            if (grown == NULL)
+            {
+                free(chunk);
+                return 1;
+            }
+            chunk = grown;
+            capacity *= 2;
+        }
+    }
+    if (carry > 0)
+    {
+        evaluateLine(batch, chunk, carry);
+    }
+    free(chunk);
+    return ferror(file);
+}
+
+/**
+ * This function evaluates the lines of a memory mapped file. Pipes, terminals and files that can't be mapped are
+ * read as a stream instead. The descriptor is closed.
+ * @return 0 in success and non zero otherwise
+ */
+int runMapped(Batch *batch, int fd)
+{
+    struct stat info;
+    if (fstat(fd, &info) != 0)
+    {
+        close(fd);
+        return 1;
+    }
+    size_t size = (size_t) info.st_size;
+    const char *data = MAP_FAILED;
+    if (S_ISREG(info.st_mode) && size > 0)
+    {
+        data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    if (data == MAP_FAILED)
+    {
+        FILE *file = fdopen(fd, "r");
+        if (file == NULL)
+        {
+            close(fd);
+            return 1;
+        }
+        int failed = runStream(batch, file);
+        fclose(file);
+        return failed;
+    }
+    close(fd);
+    madvise((void *) data, size, MADV_SEQUENTIAL);
+    evaluateData(batch, data, size);
+    munmap((void *) data, size);
+    return 0;
+}
+
+/**
+ * This function evaluates every line of the given file, or of the standard input if no file is given, and prints
+ * the value of each line on its own line. Lines that can't be evaluated are printed as nan.
+ * The input is read in large chunks (a file is memory mapped), lines may have any length and the output is
+ * written through a single large buffer.
+ * @param fileName the name of the file or NULL for the standard input
+ * @param arithmetic the arithmetic the lines are evaluated with, lines that overflow are printed as overflow
+ * @return EXIT_SUCCESS if every line was evaluated and EXIT_FAILURE otherwise
+ */
+int runBatch(const char *fileName, Arithmetic arithmetic)
+{
+    int failed;
+    Batch batch;
+    if (initBatch(&batch, stdout, arithmetic))
+    {
+        fprintf(stderr, "Error: out of memory\n");
+        failed = 1;
+    }
+    else if (fileName == NULL)
+    {
+        failed = runStream(&batch, stdin);
+    }
+    else
+    {
+        int fd = open(fileName, O_RDONLY);
+        if (fd < 0)
+        {
+            fprintf(stderr, "Error opening file: %s\n", fileName);
+            failed = 1;
+        }
+        else
+        {
+            failed = runMapped(&batch, fd);
+        }
+    }
+    flushOutput(&batch);
+    fflush(stdout);
+    freeBatch(&batch);
+    return failed || batch.failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,81 @@
+#ifndef EX3_BATCH_H
+#define EX3_BATCH_H
+
+// ------------------------------ includes -----------------------------
+
+#include <stdio.h>
+#include "stack.h"
+#include "inFix.h"
+
+// -------------------------- const definitions -------------------------
+
+#define OUTPUT_SIZE (1 << 20)
+
+// ------------------------------ structures -----------------------------
+
+/**
+ * The arithmetic of a batch: int, 64 bits with overflow checks or exact arbitrary precision
+ */
+typedef enum
+{
+    ARITHMETIC_INT = 0,
+    ARITHMETIC_WIDE,
+    ARITHMETIC_BIG
+} Arithmetic;
+
+/**
+ * The state of a batch run, every buffer is reused from line to line and only grows
+ */
+typedef struct
+{
+    MathObject *infix;
+    MathObject *postfix;
+    size_t capacity;
+    Stack *operators;
+    Stack *operands;
+    char *output;
+    size_t outputLen;
+    size_t outputCapacity;
+    FILE *sink;
+    Arithmetic arithmetic;
+    int failures;
+} Batch;
+
+// ------------------------------ functions -----------------------------
+
+/**
+ * This function initializes the buffers of a batch
+ * @param batch the batch
+ * @param sink the stream the output is flushed to, or NULL to keep the whole output in the buffer
+ * @param arithmetic the arithmetic the lines are evaluated with
+ * @return 0 in success and non zero otherwise, the batch must be freed either way
+ */
+int initBatch(Batch *batch, FILE *sink, Arithmetic arithmetic);
+
+/**
+ * Frees the buffers of a batch
+ * @param batch the batch
+ */
+void freeBatch(Batch *batch);
+
+/**
+ * This function evaluates every line of the given data, including a last line that has no new line, and appends
+ * the value of each line to the output of the batch
+ * @param batch the batch
+ * @param data the lines
+ * @param len the length of the data
+ */
+void evaluateData(Batch *batch, const char *data, size_t len);
+
+/**
+ * This function evaluates every line of the given file, or of the standard input if no file is given, and prints
+ * the value of each line on its own line. Lines that can't be evaluated are printed as nan.
+ * The input is read in large chunks (a file is memory mapped), lines may have any length and the output is
+ * written through a single large buffer.
+ * @param fileName the name of the file or NULL for the standard input
+ * @param arithmetic the arithmetic the lines are evaluated with, lines that overflow are printed as overflow
+ * @return EXIT_SUCCESS if every line was evaluated and EXIT_FAILURE otherwise
+ */
+int runBatch(const char *fileName, Arithmetic arithmetic);
+
+#endif
@@ -0,0 +1,854 @@
+// ------------------------------ includes -----------------------------
+
+#include <limits.h>
+#include <string.h>
+#include "bigInt.h"
+
+// -------------------------- const definitions -------------------------
+
+#define LIMB_BITS 32
+
+#define LIMB_BASE 4294967296ULL
+
+#define DECIMAL_CHUNK 1000000000u
+
+#define DECIMAL_CHUNK_DIGITS 9
+
+#define MAX_LIMB_DIGITS 10
+
+// ------------------------------ functions -----------------------------
+
+/**
+ * This function allocates an integer with the given number of zero limbs
+ * @return the integer or NULL if there is no memory
+ */
+BigInt *bigAlloc(size_t size)
+{
+    BigInt *a = malloc(sizeof(BigInt));
+    if (a == NULL)
+    {
+        return NULL;
+    }
+    a->limbs = calloc(size > 0 ? size : 1, sizeof(uint32_t));
+    if (a->limbs == NULL)
+    {
+        free(a);
+        return NULL;
+    }
+    a->size = size;
+    a->negative = 0;
+    return a;
+}
+
+/**
+ * This function drops the leading zero limbs of the given integer
+ */
+void bigTrim(BigInt *a)
+{
+    while (a->size > 0 && a->limbs[a->size - 1] == 0)
+    {
+        a->size--;
+    }
+    if (a->size == 0)
+    {
+        a->negative = 0;
+    }
+}
+
+/**
+ * This function creates an arbitrary precision integer
+ * @param value the value of the integer
+ * @return the integer or NULL if there is no memory
+ */
+BigInt *bigFromLong(long long value)
+{
+    unsigned long long magnitude = value < 0 ? 0ull - (unsigned long long) value : (unsigned long long) value;
+    BigInt *a = bigAlloc(2);
+    if (a == NULL)
+    {
+        return NULL;
+    }
+    a->limbs[0] = (uint32_t) magnitude;
+    a->limbs[1] = (uint32_t) (magnitude >> LIMB_BITS);
+    a->negative = value < 0;
+    bigTrim(a);
+    return a;
+}
+
+/**
+ * This function converts an integer to 64 bits
+ * @return non zero if the integer fits in 64 bits and zero otherwise
+ */
+int bigToLong(const BigInt *a, long long *value)
+{
+    unsigned long long magnitude = 0;
+    if (a->size > 2)
+    {
+        return 0;
+    }
+    if (a->size > 0)
+    {
+        magnitude = a->limbs[0];
+    }
+    if (a->size > 1)
+    {
+        magnitude |= (unsigned long long) a->limbs[1] << LIMB_BITS;
+    }
+    if (a->negative)
+    {
+        if (magnitude > (unsigned long long) LLONG_MAX + 1)
+        {
+            return 0;
+        }
+        *value = magnitude == (unsigned long long) LLONG_MAX + 1 ? LLONG_MIN : -(long long) magnitude;
+        return 1;
+    }
+    if (magnitude > LLONG_MAX)
+    {
+        return 0;
+    }
+    *value = (long long) magnitude;
+    return 1;
+}
+
+/**
+ * @return the number of limbs of the given magnitude without its leading zeros
+ */
+size_t magLen(const uint32_t *a, size_t size)
+{
+    while (size > 0 && a[size - 1] == 0)
+    {
+        size--;
+    }
+    return size;
+}
+
+/**
+ * This function compares two trimmed magnitudes
+ * @return negative, zero or positive if a is smaller, equal or bigger than b
+ */
+int magCompare(const uint32_t *a, size_t aSize, const uint32_t *b, size_t bSize)
+{
+    if (aSize != bSize)
+    {
+        return aSize < bSize ? -1 : 1;
+    }
+    while (aSize-- > 0)
+    {
+        if (a[aSize] != b[aSize])
+        {
+            return a[aSize] < b[aSize] ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * This function adds src into out, the sum must fit in the outSize limbs of out
+ */
+void magAddInto(uint32_t *out, size_t outSize, const uint32_t *src, size_t srcSize)
+{
+    uint64_t carry = 0;
+    size_t i;
+    for (i = 0; i < srcSize; i++)
+    {
+        carry += (uint64_t) out[i] + src[i];
+        out[i] = (uint32_t) carry;
+        carry >>= LIMB_BITS;
+    }
+    for (; carry != 0 && i < outSize; i++)
+    {
+        carry += out[i];
+        out[i] = (uint32_t) carry;
+        carry >>= LIMB_BITS;
+    }
+}
+
+/**
+ * This function subtracts src from out, out must not be smaller than src
+ */
+void magSubFrom(uint32_t *out, size_t outSize, const uint32_t *src, size_t srcSize)
+{
+    uint64_t borrow = 0;
+    size_t i;
+    for (i = 0; i < srcSize; i++)
+    {
+        uint64_t difference = (uint64_t) out[i] - src[i] - borrow;
+        out[i] = (uint32_t) difference;
+        borrow = difference >> 63;
+    }
+    for (; borrow != 0 && i < outSize; i++)
+    {
+        uint64_t difference = (uint64_t) out[i] - borrow;
+        out[i] = (uint32_t) difference;
+        borrow = difference >> 63;
+    }
+}
+
+/**
+ * This function multiplies two magnitudes by the schoolbook method into the aSize + bSize limbs of out
+ */
+void magMulSchool(const uint32_t *a, size_t aSize, const uint32_t *b, size_t bSize, uint32_t *out)
+{
+    size_t i, j;
+    memset(out, 0, (aSize + bSize) * sizeof(uint32_t));
+    for (i = 0; i < aSize; i++)
+    {
+        uint64_t carry = 0;
+        for (j = 0; j < bSize; j++)
+        {
+            uint64_t product = (uint64_t) a[i] * b[j] + out[i + j] + carry;
+            out[i + j] = (uint32_t) product;
+            carry = product >> LIMB_BITS;
+        }
+        out[i + bSize] = (uint32_t) carry;
+    }
+}
+
+/**
+ * This function multiplies two magnitudes into the aSize + bSize limbs of out. Below KARATSUBA_THRESHOLD limbs the
+ * schoolbook method is used, otherwise a is split in halves a1 * B^m + a0 and when b is as long as a the product is
+ * z2 * B^2m + ((a0 + a1)(b0 + b1) - z2 - z0) * B^m + z0 with three recursive multiplications.
+ * @return 0 in success and non zero if there is no memory
+ */
+int magMul(const uint32_t *a, size_t aSize, const uint32_t *b, size_t bSize, uint32_t *out)
+{
+    if (aSize < bSize)
+    {
+        const uint32_t *swap = a;
+        size_t swapSize = aSize;
+        a = b, aSize = bSize;
+        b = swap, bSize = swapSize;
+    }
+    if (bSize < KARATSUBA_THRESHOLD)
+    {
+        magMulSchool(a, aSize, b, bSize, out);
+        return 0;
+    }
+
+    size_t half = aSize / 2, aHigh = aSize - half;
+    memset(out, 0, (aSize + bSize) * sizeof(uint32_t));
+    if (bSize <= half)
+    {
+        // b is short, a0 * b + a1 * b * B^m
+        uint32_t *part = malloc((aHigh + bSize) * sizeof(uint32_t));
+        if (part == NULL || magMul(a, half, b, bSize, part))
+        {
+            free(part);
+            return 1;
+        }
+        magAddInto(out, aSize + bSize, part, half + bSize);
+        if (magMul(a + half, aHigh, b, bSize, part))
+        {
+            free(part);
+            return 1;
+        }
+        magAddInto(out + half, aSize + bSize - half, part, aHigh + bSize);
+        free(part);
+        return 0;
+    }
+
+    size_t bHigh = bSize - half;
+    size_t sumASize = aHigh + 1, sumBSize = (bHigh > half ? bHigh : half) + 1;
+    uint32_t *sumA = calloc(sumASize, sizeof(uint32_t));
+    uint32_t *sumB = calloc(sumBSize, sizeof(uint32_t));
+    uint32_t *middle = malloc((sumASize + sumBSize) * sizeof(uint32_t));
+    int failed = sumA == NULL || sumB == NULL || middle == NULL;
+    if (!failed)
+    {
+        failed = magMul(a, half, b, half, out) || magMul(a + half, aHigh, b + half, bHigh, out + 2 * half);
+    }
+    if (!failed)
+    {
+        memcpy(sumA, a, half * sizeof(uint32_t));
+        magAddInto(sumA, sumASize, a + half, aHigh);
+        memcpy(sumB, b, half * sizeof(uint32_t));
+        magAddInto(sumB, sumBSize, b + half, bHigh);
+        size_t sumALen = magLen(sumA, sumASize), sumBLen = magLen(sumB, sumBSize);
+        failed = magMul(sumA, sumALen, sumB, sumBLen, middle);
+        if (!failed)
+        {
+            size_t middleSize = sumALen + sumBLen;
+            magSubFrom(middle, middleSize, out, magLen(out, 2 * half));
+            magSubFrom(middle, middleSize, out + 2 * half, magLen(out + 2 * half, aSize + bSize - 2 * half));
+            magAddInto(out + half, aSize + bSize - half, middle, magLen(middle, middleSize));
+        }
+    }
+    free(sumA);
+    free(sumB);
+    free(middle);
+    return failed;
+}
+
+/**
+ * This function divides the magnitude u of uSize limbs by the magnitude v of vSize limbs (Knuth's algorithm D),
+ * v must be trimmed and not longer than u
+ * @param quotient container for the uSize - vSize + 1 limbs of the quotient
+ * @return 0 in success and non zero if there is no memory
+ */
+int magDiv(const uint32_t *u, size_t uSize, const uint32_t *v, size_t vSize, uint32_t *quotient)
+{
+    size_t i;
+    long long j;
+    if (vSize == 1)
+    {
+        uint64_t remainder = 0;
+        for (j = (long long) uSize - 1; j >= 0; j--)
+        {
+            uint64_t current = (remainder << LIMB_BITS) | u[j];
+            quotient[j] = (uint32_t) (current / v[0]);
+            remainder = current % v[0];
+        }
+        return 0;
+    }
+
+    // normalize so the top limb of the divisor has its high bit set
+    int shift = __builtin_clz(v[vSize - 1]);
+    uint32_t *vn = malloc(vSize * sizeof(uint32_t));
+    uint32_t *un = malloc((uSize + 1) * sizeof(uint32_t));
+    if (vn == NULL || un == NULL)
+    {
+        free(vn);
+        free(un);
+        return 1;
+    }
+    for (i = vSize - 1; i > 0; i--)
+    {
+        vn[i] = (uint32_t) (((uint64_t) v[i] << shift) | ((uint64_t) v[i - 1] >> (LIMB_BITS - shift)));
+    }
+    vn[0] = v[0] << shift;
+    un[uSize] = (uint32_t) ((uint64_t) u[uSize - 1] >> (LIMB_BITS - shift));
+    for (i = uSize - 1; i > 0; i--)
+    {
+        un[i] = (uint32_t) (((uint64_t) u[i] << shift) | ((uint64_t) u[i - 1] >> (LIMB_BITS - shift)));
+    }
+    un[0] = u[0] << shift;
+
+    for (j = (long long) (uSize - vSize); j >= 0; j--)
+    {
+        uint64_t top = ((uint64_t) un[j + vSize] << LIMB_BITS) | un[j + vSize - 1];
+        uint64_t qHat = top / vn[vSize - 1];
+        uint64_t rHat = top % vn[vSize - 1];
+        while (qHat >= LIMB_BASE || qHat * vn[vSize - 2] > ((rHat << LIMB_BITS) | un[j + vSize - 2]))
+        {
+            qHat--;
+            rHat += vn[vSize - 1];
+            if (rHat >= LIMB_BASE)
+            {
+                break;
+            }
+        }
+
+        // multiply and subtract
+        int64_t borrow = 0, t;
+        for (i = 0; i < vSize; i++)
+        {
+            uint64_t product = qHat * vn[i];
+            t = (int64_t) un[i + j] - borrow - (int64_t) (product & 0xFFFFFFFFu);
+            un[i + j] = (uint32_t) t;
+            borrow = (int64_t) (product >> LIMB_BITS) - (t >> LIMB_BITS);
+        }
+        t = (int64_t) un[j + vSize] - borrow;
+        un[j + vSize] = (uint32_t) t;
+
+        quotient[j] = (uint32_t) qHat;
+        if (t < 0)
+        {
+            // qHat was one too big, add the divisor back
+            uint64_t carry = 0;
+            quotient[j]--;
+            for (i = 0; i < vSize; i++)
+            {
+                carry += (uint64_t) un[i + j] + vn[i];
+                un[i + j] = (uint32_t) carry;
+                carry >>= LIMB_BITS;
+            }
+            un[j + vSize] += (uint32_t) carry;
+        }
+    }
+    free(vn);
+    free(un);
+    return 0;
+}
+
+/**
+ * This function copies an integer
+ * @return the copy or NULL if there is no memory
+ */
+BigInt *bigCopy(const BigInt *a)
+{
+    BigInt *copy = bigAlloc(a->size);
+    if (copy == NULL)
+    {
+        return NULL;
+    }
+    memcpy(copy->limbs, a->limbs, a->size * sizeof(uint32_t));
+    copy->negative = a->negative;
+    return copy;
+}
+
+/**
+ * This function adds a to b, or to -b if negateB is non zero
+ * @return the sum or NULL if there is no memory
+ */
+BigInt *bigAddSigned(const BigInt *a, const BigInt *b, int negateB)
+{
+    int bNegative = b->size > 0 && (b->negative != negateB);
+    BigInt *result;
+    if (a->negative == bNegative)
+    {
+        size_t size = (a->size > b->size ? a->size : b->size) + 1;
+        if ((result = bigAlloc(size)) == NULL)
+        {
+            return NULL;
+        }
+        memcpy(result->limbs, a->limbs, a->size * sizeof(uint32_t));
+        magAddInto(result->limbs, size, b->limbs, b->size);
+        result->negative = a->negative;
+    }
+    else
+    {
+        const BigInt *larger = a, *smaller = b;
+        int negative = a->negative;
+        if (magCompare(a->limbs, a->size, b->limbs, b->size) < 0)
+        {
+            larger = b, smaller = a;
+            negative = bNegative;
+        }
+        if ((result = bigAlloc(larger->size)) == NULL)
+        {
+            return NULL;
+        }
+        memcpy(result->limbs, larger->limbs, larger->size * sizeof(uint32_t));
+        magSubFrom(result->limbs, larger->size, smaller->limbs, smaller->size);
+        result->negative = negative;
+    }
+    bigTrim(result);
+    return result;
+}
+
+/**
+ * This function adds two integers
+ * @return a + b or NULL if there is no memory
+ */
+BigInt *bigAdd(const BigInt *a, const BigInt *b)
+{
+    return bigAddSigned(a, b, 0);
+}
+
+/**
+ * This function subtracts two integers
+ * @return a - b or NULL if there is no memory
+ */
+BigInt *bigSub(const BigInt *a, const BigInt *b)
+{
+    return bigAddSigned(a, b, 1);
+}
+
+/**
+ * This function multiplies two integers, with Karatsuba above KARATSUBA_THRESHOLD limbs
+ * @return a * b or NULL if there is no memory
+ */
+BigInt *bigMul(const BigInt *a, const BigInt *b)
+{
+    BigInt *result = bigAlloc(a->size + b->size);
+    if (result == NULL)
+    {
+        return NULL;
+    }
+    if (magMul(a->limbs, a->size, b->limbs, b->size, result->limbs))
+    {
+        bigFree(result);
+        return NULL;
+    }
+    result->negative = a->negative != b->negative;
+    bigTrim(result);
+    return result;
+}
+
+/**
+ * This function divides two integers, the quotient is truncated towards 0
+ * @param b the divisor, must not be 0
+ * @return a / b or NULL if there is no memory
+ */
+BigInt *bigDiv(const BigInt *a, const BigInt *b)
+{
+    if (magCompare(a->limbs, a->size, b->limbs, b->size) < 0)
+    {
+        return bigAlloc(0);
+    }
+    BigInt *result = bigAlloc(a->size - b->size + 1);
+    if (result == NULL)
+    {
+        return NULL;
+    }
+    if (magDiv(a->limbs, a->size, b->limbs, b->size, result->limbs))
+    {
+        bigFree(result);
+        return NULL;
+    }
+    result->negative = a->negative != b->negative;
+    bigTrim(result);
+    return result;
+}
+
+/**
+ * This function raises an integer to a power by square and multiply
+ * @return base ^ exponent or NULL if there is no memory
+ */
+BigInt *bigPow(const BigInt *base, unsigned long long exponent)
+{
+    BigInt *result = bigFromLong(1);
+    BigInt *square = bigCopy(base);
+    BigInt *next;
+    while (result != NULL && square != NULL && exponent > 0)
+    {
+        if (exponent & 1)
+        {
+            next = bigMul(result, square);
+            bigFree(result);
+            result = next;
+        }
+        exponent >>= 1;
+        if (exponent > 0)
+        {
+            next = bigMul(square, square);
+            bigFree(square);
+            square = next;
+        }
+    }
+    if (square == NULL)
+    {
+        bigFree(result);
+        return NULL;
+    }
+    bigFree(square);
+    return result;
+}
+
+/**
+ * This function reads a decimal number, with an optional minus, with arbitrary precision. The digits are taken
+ * DECIMAL_CHUNK_DIGITS at a time, each chunk multiplies the magnitude by a power of 10 and adds to it.
+ * @param text the number
+ * @param len the number of chars the number may span, it ends at the first char that is not a digit
+ * @return the integer or NULL if there is no memory
+ */
+BigInt *bigFromDecimal(const char *text, size_t len)
+{
+    const char *end = text + len;
+    int negative = text < end && *text == minus;
+    size_t digitsNum = 0, used = 0, i;
+    text += negative;
+    while (text + digitsNum < end && '0' <= text[digitsNum] && text[digitsNum] <= '9')
+    {
+        digitsNum++;
+    }
+    // a chunk is less than DECIMAL_CHUNK, so it adds at most one limb
+    BigInt *a = bigAlloc(digitsNum / DECIMAL_CHUNK_DIGITS + 1);
+    if (a == NULL)
+    {
+        return NULL;
+    }
+    while (digitsNum > 0)
+    {
+        size_t chunkLen = (digitsNum - 1) % DECIMAL_CHUNK_DIGITS + 1;
+        uint64_t multiplier = 1, carry = 0;
+        for (i = 0; i < chunkLen; i++)
+        {
+            multiplier *= 10;
+            carry = carry * 10 + (uint64_t) (*text++ - '0');
+        }
+        digitsNum -= chunkLen;
+        for (i = 0; i < used; i++)
+        {
+            uint64_t product = a->limbs[i] * multiplier + carry;
+            a->limbs[i] = (uint32_t) product;
+            carry = product >> LIMB_BITS;
+        }
+        if (carry > 0)
+        {
+            a->limbs[used++] = (uint32_t) carry;
+        }
+    }
+    a->negative = negative;
+    bigTrim(a);
+    return a;
+}
+
+/**
+ * This function converts an integer to decimal
+ * @return the decimal string (must be freed) or NULL if there is no memory
+ */
+char *bigToString(const BigInt *a)
+{
+    size_t i, size = a->size, capacity = a->size * MAX_LIMB_DIGITS + 3;
+    char *text = malloc(capacity);
+    uint32_t *temp = malloc((size > 0 ? size : 1) * sizeof(uint32_t));
+    if (text == NULL || temp == NULL)
+    {
+        free(text);
+        free(temp);
+        return NULL;
+    }
+    char *end = text + capacity - 1;
+    char *digit = end;
+    *end = '\0';
+    memcpy(temp, a->limbs, size * sizeof(uint32_t));
+    if (size == 0)
+    {
+        *--digit = '0';
+    }
+    while (size > 0)
+    {
+        uint64_t remainder = 0;
+        int digitsNum;
+        for (i = size; i-- > 0;)
+        {
+            uint64_t current = (remainder << LIMB_BITS) | temp[i];
+            temp[i] = (uint32_t) (current / DECIMAL_CHUNK);
+            remainder = current % DECIMAL_CHUNK;
+        }
+        size = magLen(temp, size);
+        for (digitsNum = 0; digitsNum < DECIMAL_CHUNK_DIGITS && (size > 0 || remainder > 0); digitsNum++)
+        {
+            *--digit = (char) ('0' + remainder % 10);
+            remainder /= 10;
+        }
+    }
+    if (a->negative)
+    {
+        *--digit = '-';
+    }
+    memmove(text, digit, (size_t) (end - digit) + 1);
+    free(temp);
+    return text;
+}
+
+/**
+ * Frees an integer
+ */
+void bigFree(BigInt *a)
+{
+    if (a != NULL)
+    {
+        free(a->limbs);
+        free(a);
+    }
+}
+
+/**
+ * This function raises an integer to an integer power, a negative exponent truncates the result towards 0
+ * @return EVAL_OK in success and the reason of the failure otherwise
+ */
+EvalStatus bigPower(const BigInt *base, const BigInt *exponent, BigInt **result)
+{
+    int exponentOdd = exponent->size > 0 && (exponent->limbs[0] & 1);
+    int unitBase = base->size == 1 && base->limbs[0] == 1;
+    if (base->size == 0 && exponent->negative)
+    {
+        return EVAL_DIV_BY_ZERO;
+    }
+    if (unitBase || base->size == 0 || exponent->negative)
+    {
+        // 0, 1 and -1 have small powers whatever the exponent is, other bases vanish for negative exponents
+        long long value = unitBase ? (base->negative && exponentOdd ? -1 : 1) : (base->size == 0 &&
+                                                                                    exponent->size == 0);
+        *result = bigFromLong(value);
+        return *result == NULL ? EVAL_NO_MEMORY : EVAL_OK;
+    }
+    size_t baseBits = base->size * LIMB_BITS - (size_t) __builtin_clz(base->limbs[base->size - 1]);
+    if (exponent->size > 1 || (uint64_t) exponent->limbs[0] * (baseBits - 1) > MAX_POWER_BITS)
+    {
+        return EVAL_OVERFLOW;
+    }
+    *result = bigPow(base, exponent->size > 0 ? exponent->limbs[0] : 0);
+    return *result == NULL ? EVAL_NO_MEMORY : EVAL_OK;
+}
+
+/**
+ * This function evaluates left operator right with arbitrary precision, the result is kept small if it fits
+ * @return EVAL_OK in success and the reason of the failure otherwise
+ */
+EvalStatus bigOperate(const Number *left, const Number *right, char operator, Number *result)
+{
+    EvalStatus status = EVAL_OK;
+    BigInt *value = NULL;
+    BigInt *a = left->big != NULL ? left->big : bigFromLong(left->small);
+    BigInt *b = right->big != NULL ? right->big : bigFromLong(right->small);
+    if (a == NULL || b == NULL)
+    {
+        status = EVAL_NO_MEMORY;
+    }
+    else
+    {
+        switch (operator)
+        {
+            case plus:
+                value = bigAdd(a, b);
+                break;
+            case minus:
+                value = bigSub(a, b);
+                break;
+            case mul:
+                value = bigMul(a, b);
+                break;
+            case division:
+                if (b->size == 0)
+                {
+                    status = EVAL_DIV_BY_ZERO;
+                    break;
+                }
+                value = bigDiv(a, b);
+                break;
+            case power:
+                status = bigPower(a, b, &value);
+                break;
+            default:
+                status = EVAL_MALFORMED;
+                break;
+        }
+        if (status == EVAL_OK && value == NULL)
+        {
+            status = EVAL_NO_MEMORY;
+        }
+    }
+    if (a != left->big)
+    {
+        bigFree(a);
+    }
+    if (b != right->big)
+    {
+        bigFree(b);
+    }
+    if (status != EVAL_OK)
+    {
+        return status;
+    }
+    result->big = NULL;
+    if (bigToLong(value, &result->small))
+    {
+        bigFree(value);
+    }
+    else
+    {
+        result->big = value;
+    }
+    return EVAL_OK;
+}
+
+/**
+ * This function is given two numbers and an operator and evaluates the expression left operator right. Two small
+ * numbers are evaluated in 64 bits and only promoted to arbitrary precision if the result overflows.
+ * @param result container for the result, the operands still belong to the caller
+ * @return EVAL_OK in success and the reason of the failure otherwise
+ */
+EvalStatus numberOperate(const Number *left, const Number *right, char operator, Number *result)
+{
+    if (left->big == NULL && right->big == NULL)
+    {
+        EvalStatus status = getResult64(right->small, left->small, operator, &result->small);
+        if (status != EVAL_OVERFLOW)
+        {
+            result->big = NULL;
+            return status;
+        }
+    }
+    return bigOperate(left, right, operator, result);
+}
+
+/**
+ * Frees the arbitrary precision part of a number
+ */
+void numberFree(Number *number)
+{
+    bigFree(number->big);
+    number->big = NULL;
+}
+
+/**
+ * This function is given mathematical expression presented by postfix and evaluates it exactly with arbitrary
+ * precision
+ * @param postfix mathematical expression presented by postfix
+ * @param len the length of the expression
+ * @param stack a reusable stack of Numbers for the operands
+ * @param result container for the value of the expression, must be freed with numberFree
+ * @return EVAL_OK in success and the reason of the failure otherwise
+ */
+EvalStatus evaluatePostfixBig(const MathObject *postfix, int len, Stack *stack, const char *text, size_t textLen,
+                              Number *result)
+{
+    int i;
+    Number left, right, value;
+    EvalStatus status = EVAL_OK;
+    clearStack(stack);
+
+    for (i = 0; i < len && status == EVAL_OK; i++)
+    {
+        if (postfix[i].type == operand || postfix[i].type == literal)
+        {
+            value.small = postfix[i].value;
+            value.big = NULL;
+            // a literal that fits in 64 bits is kept small like every other number
+            if (postfix[i].type == literal &&
+                getLiteral64(text + value.small, textLen - (size_t) value.small, &value.small) != EVAL_OK)
+            {
+                value.big = bigFromDecimal(text + postfix[i].value, textLen - (size_t) postfix[i].value);
+                if (value.big == NULL)
+                {
+                    status = EVAL_NO_MEMORY;
+                    break;
+                }
+            }
+            if (push(stack, &value) != 0)
+            {
+                numberFree(&value);
+                status = EVAL_NO_MEMORY;
+                break;
+            }
+            continue;
+        }
+        if (isEmptyStack(stack))
+        {
+            status = EVAL_MALFORMED;
+            break;
+        }
+        pop(stack, &right);
+        if (isEmptyStack(stack))
+        {
+            numberFree(&right);
+            status = EVAL_MALFORMED;
+            break;
+        }
+        pop(stack, &left);
+        status = numberOperate(&left, &right, postfix[i].type, &value);
+        numberFree(&left);
+        numberFree(&right);
+        if (status == EVAL_OK && push(stack, &value) != 0)
+        {
+            numberFree(&value);
+            status = EVAL_NO_MEMORY;
+        }
+    }
+    if (status == EVAL_OK)
+    {
+        if (isEmptyStack(stack))
+        {
+            status = EVAL_MALFORMED;
+        }
+        else
+        {
+            pop(stack, result);
+            if (!isEmptyStack(stack))
+            {
+                numberFree(result);
+                status = EVAL_MALFORMED;
+            }
+        }
+    }
+    while (!isEmptyStack(stack))
+    {
+        pop(stack, &value);
+        numberFree(&value);
+    }
+    return status;
+}
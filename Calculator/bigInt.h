@@ -0,0 +1,133 @@
+#ifndef EX3_BIGINT_H
+#define EX3_BIGINT_H
+
+// ------------------------------ includes -----------------------------
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "stack.h"
+#include "inFix.h"
+#include "postFix.h"
+
+// -------------------------- const definitions -------------------------
+
+/**
+ * Multiplications of numbers with at least this many limbs use Karatsuba
+ */
+#define KARATSUBA_THRESHOLD 32
+
+/**
+ * The biggest number of bits a power may have, bigger powers fail with EVAL_OVERFLOW
+ */
+#define MAX_POWER_BITS (1 << 20)
+
+// ------------------------------ structures -----------------------------
+
+/**
+ * An arbitrary precision integer, the magnitude is stored in base 2^32 limbs from the least significant one.
+ * Zero has no limbs.
+ */
+typedef struct
+{
+    uint32_t *limbs;
+    size_t size;
+    int negative;
+} BigInt;
+
+/**
+ * A value of the arbitrary precision evaluation, a value that fits in 64 bits is kept in small and big is NULL
+ * so ordinary expressions never touch a BigInt
+ */
+typedef struct
+{
+    long long small;
+    BigInt *big;
+} Number;
+
+// ------------------------------ functions -----------------------------
+
+/**
+ * This function creates an arbitrary precision integer
+ * @param value the value of the integer
+ * @return the integer or NULL if there is no memory
+ */
+BigInt *bigFromLong(long long value);
+
+/**
+ * This function adds two integers
+ * @return a + b or NULL if there is no memory
+ */
+BigInt *bigAdd(const BigInt *a, const BigInt *b);
+
+/**
+ * This function subtracts two integers
+ * @return a - b or NULL if there is no memory
+ */
+BigInt *bigSub(const BigInt *a, const BigInt *b);
+
+/**
+ * This function multiplies two integers, with Karatsuba above KARATSUBA_THRESHOLD limbs
+ * @return a * b or NULL if there is no memory
+ */
+BigInt *bigMul(const BigInt *a, const BigInt *b);
+
+/**
+ * This function divides two integers, the quotient is truncated towards 0
+ * @param b the divisor, must not be 0
+ * @return a / b or NULL if there is no memory
+ */
+BigInt *bigDiv(const BigInt *a, const BigInt *b);
+
+/**
+ * This function raises an integer to a power by square and multiply
+ * @return base ^ exponent or NULL if there is no memory
+ */
+BigInt *bigPow(const BigInt *base, unsigned long long exponent);
+
+/**
+ * This function reads a decimal number, with an optional minus, with arbitrary precision
+ * @param text the number
+ * @param len the number of chars the number may span, it ends at the first char that is not a digit
+ * @return the integer or NULL if there is no memory
+ */
+BigInt *bigFromDecimal(const char *text, size_t len);
+
+/**
+ * This function converts an integer to decimal
+ * @return the decimal string (must be freed) or NULL if there is no memory
+ */
+char *bigToString(const BigInt *a);
+
+/**
+ * Frees an integer
+ */
+void bigFree(BigInt *a);
+
+/**
+ * This function is given two numbers and an operator and evaluates the expression left operator right. Two small
+ * numbers are evaluated in 64 bits and only promoted to arbitrary precision if the result overflows.
+ * @param result container for the result, the operands still belong to the caller
+ * @return EVAL_OK in success and the reason of the failure otherwise
+ */
+EvalStatus numberOperate(const Number *left, const Number *right, char operator, Number *result);
+
+/**
+ * Frees the arbitrary precision part of a number
+ */
+void numberFree(Number *number);
+
+/**
+ * This function is given mathematical expression presented by postfix and evaluates it exactly with arbitrary
+ * precision
+ * @param postfix mathematical expression presented by postfix
+ * @param len the length of the expression
+ * @param stack a reusable stack of Numbers for the operands
+ * @param text the text the expression was parsed from, its literals are read from it, NULL if it has no literals
+ * @param textLen the length of the text
+ * @param result container for the value of the expression, must be freed with numberFree
+ * @return EVAL_OK in success and the reason of the failure otherwise
+ */
+EvalStatus evaluatePostfixBig(const MathObject *postfix, int len, Stack *stack, const char *text, size_t textLen,
+                              Number *result);
+
+#endif
@@ -0,0 +1,295 @@
+// ------------------------------ includes -----------------------------
+
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "byteCode.h"
+
+// ------------------------------ functions -----------------------------
+
+/**
+ * This function is given an operator and returns the instruction that evaluates it
+ */
+int getOpCode(char operator)
+{
+    switch (operator)
+    {
+        case plus:
+            return OP_ADD;
+        case minus:
+            return OP_SUB;
+        case mul:
+            return OP_MUL;
+        case division:
+            return OP_DIV;
+        case power:
+            return OP_POW;
+        default:
+            return -1;
+    }
+}
+
+/**
+ * This function is given mathematical expression presented by postfix and compiles it to byte code
+ * @param postfix mathematical expression presented by postfix
+ * @param len the length of the expression
+ * @return the compiled expression or NULL if the expression is malformed or too deep for the VM
+ */
+ByteCode *compileByteCode(const MathObject *postfix, int len)
+{
+    int i, opCode, depth = 0, length = 0;
+    ByteCode *byteCode = malloc(sizeof(ByteCode));
+    if (byteCode == NULL)
+    {
+        return NULL;
+    }
+    // at most two ints per object plus the terminating OP_END
+    byteCode->code = malloc((2 * (size_t) len + 1) * sizeof(int));
+    if (byteCode->code == NULL)
+    {
+        free(byteCode);
+        return NULL;
+    }
+    byteCode->maxDepth = 0;
+    byteCode->variablesNum = 0;
+
+    for (i = 0; i < len; i++)
+    {
+        if (postfix[i].type == operand)
+        {
+            byteCode->code[length++] = OP_PUSH;
+            byteCode->code[length++] = postfix[i].value;
+            depth++;
+        }
+        else if (postfix[i].type == variable)
+        {
+            byteCode->code[length++] = OP_LOAD;
+            byteCode->code[length++] = postfix[i].value;
+            if (postfix[i].value >= byteCode->variablesNum)
+            {
+                byteCode->variablesNum = postfix[i].value + 1;
+            }
+            depth++;
+        }
+        else
+        {
+            opCode = getOpCode(postfix[i].type);
+            if (opCode < 0 || depth < 2)
+            {
+                freeByteCode(byteCode);
+                return NULL;
+            }
+            byteCode->code[length++] = opCode;
+            depth--;
+        }
+        if (depth > byteCode->maxDepth)
+        {
+            byteCode->maxDepth = depth;
+        }
+    }
+    if (depth != 1 || byteCode->maxDepth > BYTECODE_MAX_DEPTH)
+    {
+        freeByteCode(byteCode);
+        return NULL;
+    }
+    byteCode->code[length++] = OP_END;
+    byteCode->length = length;
+    return byteCode;
+}
+
+/**
+ * This function evaluates a compiled expression
+ * @param byteCode the compiled expression
+ * @param variables the values of the variables of the expression, may be NULL if it has none
+ * @param result container for the value of the expression
+ * @return EVAL_OK in success and the reason of the failure otherwise
+ */
+EvalStatus runByteCode(const ByteCode *byteCode, const int *variables, int *result)
+{
+    int operands[BYTECODE_MAX_DEPTH];
+    int *top = operands - 1;
+    const int *pc = byteCode->code;
+
+    for (;;)
+    {
+        switch (*pc++)
+        {
+            case OP_PUSH:
+                *++top = *pc++;
+                break;
+            case OP_LOAD:
+                *++top = variables[*pc++];
+                break;
+            case OP_ADD:
+                top[-1] = top[-1] + top[0];
+                top--;
+                break;
+            case OP_SUB:
+                top[-1] = top[-1] - top[0];
+                top--;
+                break;
+            case OP_MUL:
+                top[-1] = top[-1] * top[0];
+                top--;
+                break;
+            case OP_DIV:
+                if (top[0] == 0)
+                {
+                    return EVAL_DIV_BY_ZERO;
+                }
+                if (top[-1] == INT_MIN && top[0] == -1)
+                {
+                    return EVAL_OVERFLOW;
+                }
+                top[-1] = top[-1] / top[0];
+                top--;
+                break;
+            case OP_POW:
+                top[-1] = (int) pow(top[-1], top[0]);
+                top--;
+                break;
+            default:
+                *result = *top;
+                return EVAL_OK;
+        }
+    }
+}
+
+/**
+ * This function evaluates a compiled expression over a single block of at most BLOCK_ROWS rows
+ * @param blocks the operand stack, maxDepth blocks of BLOCK_ROWS ints
+ * @param start the index of the first row of the block
+ * @param rows the number of rows in the block
+ * @return the number of rows whose evaluation failed
+ */
+int evaluateBlock(const ByteCode *byteCode, const int *const *columns, size_t start, size_t rows, int *blocks,
+                  int *results, char *failed)
+{
+    size_t r;
+    int value, failures = 0;
+    int depth = 0;
+    int *restrict left;
+    const int *restrict right;
+    const int *pc = byteCode->code;
+
+    memset(failed, 0, rows);
+    for (;;)
+    {
+        switch (*pc++)
+        {
+            case OP_PUSH:
+                left = blocks + (depth++) * BLOCK_ROWS;
+                value = *pc++;
+                for (r = 0; r < rows; r++)
+                {
+                    left[r] = value;
+                }
+                break;
+            case OP_LOAD:
+                left = blocks + (depth++) * BLOCK_ROWS;
+                memcpy(left, columns[*pc++] + start, rows * sizeof(int));
+                break;
+            case OP_END:
+                memcpy(results, blocks, rows * sizeof(int));
+                return failures;
+            default:
+                depth--;
+                right = blocks + depth * BLOCK_ROWS;
+                left = blocks + (depth - 1) * BLOCK_ROWS;
+                switch (pc[-1])
+                {
+                    case OP_ADD:
+                        for (r = 0; r < rows; r++)
+                        {
+                            left[r] = left[r] + right[r];
+                        }
+                        break;
+                    case OP_SUB:
+                        for (r = 0; r < rows; r++)
+                        {
+                            left[r] = left[r] - right[r];
+                        }
+                        break;
+                    case OP_MUL:
+                        for (r = 0; r < rows; r++)
+                        {
+                            left[r] = left[r] * right[r];
+                        }
+                        break;
+                    case OP_DIV:
+                        for (r = 0; r < rows; r++)
+                        {
+                            // a zero divisor fails the row and is replaced by 1, and so is the -1 of INT_MIN / -1,
+                            // so the loop stays branch free. A row keeps the status of its first failure.
+                            int isZero = right[r] == 0;
+                            int isOverflow = (left[r] == INT_MIN) & (right[r] == -1);
+                            char status = (char) (isZero * EVAL_DIV_BY_ZERO + isOverflow * EVAL_OVERFLOW);
+                            // a row is counted once, by the division that fails it first
+                            failures += (failed[r] == 0) & (isZero | isOverflow);
+                            failed[r] = failed[r] ? failed[r] : status;
+                            left[r] = left[r] / (right[r] + isZero + 2 * isOverflow);
+                        }
+                        break;
+                    default:
+                        for (r = 0; r < rows; r++)
+                        {
+                            left[r] = (int) pow(left[r], right[r]);
+                        }
+                        break;
+                }
+                break;
+        }
+    }
+}
+
+/**
+ * This function evaluates a compiled expression over many rows, variable i of row r is columns[i][r].
+ * The rows are evaluated BLOCK_ROWS at a time, each instruction runs as a tight loop over the whole block.
+ * @param byteCode the compiled expression
+ * @param columns the columns of the variables, may be NULL if the expression has none
+ * @param rows the number of rows
+ * @param results container for the value of each row
+ * @param failed container that is set to the status of the evaluation of every row, EVAL_OK (0) or the reason of the
+ * failure
+ * @return EVAL_OK if all the rows were evaluated, the status of the first failed row if some rows failed and
+ * EVAL_NO_MEMORY if no row was evaluated
+ */
+EvalStatus runByteCodeBlock(const ByteCode *byteCode, const int *const *columns, size_t rows, int *results,
+                            char *failed)
+{
+    size_t start, blockRows;
+    int failures = 0;
+    int *blocks = malloc((size_t) byteCode->maxDepth * BLOCK_ROWS * sizeof(int));
+    if (blocks == NULL)
+    {
+        return EVAL_NO_MEMORY;
+    }
+    for (start = 0; start < rows; start += BLOCK_ROWS)
+    {
+        blockRows = rows - start < BLOCK_ROWS ? rows - start : BLOCK_ROWS;
+        failures += evaluateBlock(byteCode, columns, start, blockRows, blocks, results + start, failed + start);
+    }
+    free(blocks);
+    for (start = 0; failures > 0; start++)
+    {
+        if (failed[start])
+        {
+            return (EvalStatus) failed[start];
+        }
+    }
+    return EVAL_OK;
+}
+
+/**
+ * Frees a compiled expression
+ * @param byteCode the compiled expression
+ */
+void freeByteCode(ByteCode *byteCode)
+{
+    if (byteCode != NULL)
+    {
+        free(byteCode->code);
+        free(byteCode);
+    }
+}
@@ -0,0 +1,92 @@
+#ifndef EX3_BYTECODE_H
+#define EX3_BYTECODE_H
+
+// ------------------------------ includes -----------------------------
+
+#include "inFix.h"
+#include "postFix.h"
+
+// -------------------------- const definitions -------------------------
+
+/**
+ * The deepest operand stack a compiled expression may need, the VM keeps its operands in a fixed array of this size
+ */
+#define BYTECODE_MAX_DEPTH 256
+
+/**
+ * The number of rows the block VM evaluates at a time
+ */
+#define BLOCK_ROWS 1024
+
+// ------------------------------ enum -----------------------------
+
+/**
+ * The instructions of the evaluation VM, OP_PUSH is followed by its immediate value and OP_LOAD by the index of
+ * the variable it loads in the code array
+ */
+typedef enum
+{
+    OP_PUSH,
+    OP_LOAD,
+    OP_ADD,
+    OP_SUB,
+    OP_MUL,
+    OP_DIV,
+    OP_POW,
+    OP_END
+} OpCode;
+
+// ------------------------------ structures -----------------------------
+
+/**
+ * A compiled mathematical expression
+ */
+typedef struct
+{
+    int *code;
+    int length;
+    int maxDepth;
+    int variablesNum;
+} ByteCode;
+
+// ------------------------------ functions -----------------------------
+
+/**
+ * This function is given mathematical expression presented by postfix and compiles it to byte code
+ * @param postfix mathematical expression presented by postfix
+ * @param len the length of the expression
+ * @return the compiled expression or NULL if the expression is malformed or too deep for the VM
+ */
+ByteCode *compileByteCode(const MathObject *postfix, int len);
+
+/**
+ * This function evaluates a compiled expression
+ * @param byteCode the compiled expression
+ * @param variables the values of the variables of the expression, may be NULL if it has none
+ * @param result container for the value of the expression
+ * @return EVAL_OK in success and the reason of the failure otherwise
+ */
+EvalStatus runByteCode(const ByteCode *byteCode, const int *variables, int *result);
+
+/**
+ * This function evaluates a compiled expression over many rows, variable i of row r is columns[i][r].
+ * The rows are evaluated BLOCK_ROWS at a time, each instruction runs as a tight loop over the whole block.
+ * @param byteCode the compiled expression
+ * @param columns the columns of the variables, may be NULL if the expression has none
+ * @param rows the number of rows
+ * @param results container for the value of each row
+ * @param failed container that is set to the status of the evaluation of every row, EVAL_OK (0) or the reason of the
+ * failure
+ * @return EVAL_OK if all the rows were evaluated, the status of the first failed row if some rows failed and
+ * EVAL_NO_MEMORY if no row was evaluated
+ */
+EvalStatus runByteCodeBlock(const ByteCode *byteCode, const int *const *columns, size_t rows, int *results,
+                            char *failed);
+
+/**
+ * Frees a compiled expression
+ * @param byteCode the compiled expression
+ */
+void freeByteCode(ByteCode *byteCode);
+
+#endif
@@ -0,0 +1,353 @@
+// ------------------------------ includes -----------------------------
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include "stack.h"
+#include "inFix.h"
+#include "postFix.h"
+#include "parser.h"
+#include "calc.h"
+
+// ------------------------------ structures -----------------------------
+
+/**
+ * The scratch buffers of a context, they only grow. infix, postfix and operators hold capacity objects each.
+ */
+struct CalcContext
+{
+    CalcAllocator allocator;
+    MathObject *infix;
+    MathObject *postfix;
+    char *operators;
+    size_t capacity;
+    long long *operands;
+    size_t operandsCapacity;
+};
+
+/**
+ * A compiled expression, its postfix is validated and depth is the deepest operand stack it needs
+ */
+struct CalcExpression
+{
+    CalcAllocator allocator;
+    int len;
+    int depth;
+    MathObject postfix[];
+};
+
+// ------------------------------ functions -----------------------------
+
+/**
+ * The default allocate of the library
+ */
+static void *defaultAllocate(void *opaque, size_t size)
+{
+    (void) opaque;
+    return malloc(size);
+}
+
+/**
+ * The default release of the library
+ */
+static void defaultRelease(void *opaque, void *pointer)
+{
+    (void) opaque;
+    free(pointer);
+}
+
+/**
+ * This function makes sure the expression buffers of the context can hold the given number of objects, their
+ * content is not kept
+ * @return CALC_OK in success and CALC_ERR_NO_MEMORY otherwise
+ */
+static CalcStatus reserveScratch(CalcContext *context, size_t len)
+{
+    const CalcAllocator *allocator = &context->allocator;
+    size_t capacity = context->capacity > 0 ? context->capacity : MAX_LINE;
+    if (len <= context->capacity)
+    {
+        return CALC_OK;
+    }
+    while (capacity < len)
+    {
+        capacity *= 2;
+    }
+    MathObject *infix = allocator->allocate(allocator->opaque, capacity * sizeof(MathObject));
+    MathObject *postfix = allocator->allocate(allocator->opaque, capacity * sizeof(MathObject));
+    char *operators = allocator->allocate(allocator->opaque, capacity);
+    if (infix == NULL || postfix == NULL || operators == NULL)
+    {
+        allocator->release(allocator->opaque, infix);
+        allocator->release(allocator->opaque, postfix);
+        allocator->release(allocator->opaque, operators);
+        return CALC_ERR_NO_MEMORY;
+    }
+    allocator->release(allocator->opaque, context->infix);
+    allocator->release(allocator->opaque, context->postfix);
+    allocator->release(allocator->opaque, context->operators);
+    context->infix = infix;
+    context->postfix = postfix;
+    context->operators = operators;
+    context->capacity = capacity;
+    return CALC_OK;
+}
+
+/**
+ * This function makes sure the operand buffer of the context can hold the given number of operands
+ * @return CALC_OK in success and CALC_ERR_NO_MEMORY otherwise
+ */
+static CalcStatus reserveOperands(CalcContext *context, size_t depth)
+{
+    const CalcAllocator *allocator = &context->allocator;
+    size_t capacity = context->operandsCapacity > 0 ? context->operandsCapacity : STACK_INITIAL_CAPACITY;
+    if (depth <= context->operandsCapacity)
+    {
+        return CALC_OK;
+    }
+    while (capacity < depth)
+    {
+        capacity *= 2;
+    }
+    long long *operands = allocator->allocate(allocator->opaque, capacity * sizeof(long long));
+    if (operands == NULL)
+    {
+        return CALC_ERR_NO_MEMORY;
+    }
+    allocator->release(allocator->opaque, context->operands);
+    context->operands = operands;
+    context->operandsCapacity = capacity;
+    return CALC_OK;
+}
+
+/**
+ * This function checks that every right parenthesis of the given infix closes a left one and that every left one is
+ * closed, convertToPostfix drops the parentheses that don't match
+ * @return non zero if the parentheses are balanced and 0 otherwise
+ */
+static int isBalanced(const MathObject *infix, int len)
+{
+    int i, open = 0;
+    for (i = 0; i < len && open >= 0; i++)
+    {
+        open += infix[i].type == lPar ? 1 : infix[i].type == rPar ? -1 : 0;
+    }
+    return open == 0;
+}
+
+/**
+ * This function finds the deepest operand stack the evaluation of the given postfix needs
+ * @return the depth or 0 if the postfix is malformed
+ */
+static int measureDepth(const MathObject *postfix, int len)
+{
+    int i, depth = 0, maxDepth = 0;
+    for (i = 0; i < len; i++)
+    {
+        if (postfix[i].type == operand)
+        {
+            depth++;
+            maxDepth = depth > maxDepth ? depth : maxDepth;
+        }
+        else if (isOperator(postfix[i].type) && depth >= 2)
+        {
+            depth--;
+        }
+        else
+        {
+            return 0;
+        }
+    }
+    return depth == 1 ? maxDepth : 0;
+}
+
+/**
+ * @return the status of the library that matches the given status of an evaluation
+ */
+static CalcStatus toCalcStatus(EvalStatus status)
+{
+    switch (status)
+    {
+        case EVAL_OK:
+            return CALC_OK;
+        case EVAL_DIV_BY_ZERO:
+            return CALC_ERR_DIV_BY_ZERO;
+        case EVAL_NO_MEMORY:
+            return CALC_ERR_NO_MEMORY;
+        case EVAL_OVERFLOW:
+            return CALC_ERR_OVERFLOW;
+        default:
+            return CALC_ERR_SYNTAX;
+    }
+}
+
+/**
+ * This function creates a context
+ * @param allocator the memory functions of the context and of the expressions it compiles, NULL for malloc and
+ * free. The allocator is copied.
+ * @param context container for the context
+ * @return CALC_OK in success and the reason of the failure otherwise
+ */
+CalcStatus calc_context_create(const CalcAllocator *allocator, CalcContext **context)
+{
+    CalcAllocator defaultAllocator = {defaultAllocate, defaultRelease, NULL};
+    if (context == NULL || (allocator != NULL && (allocator->allocate == NULL || allocator->release == NULL)))
+    {
+        return CALC_ERR_ARGUMENT;
+    }
+    if (allocator == NULL)
+    {
+        allocator = &defaultAllocator;
+    }
+    *context = allocator->allocate(allocator->opaque, sizeof(CalcContext));
+    if (*context == NULL)
+    {
+        return CALC_ERR_NO_MEMORY;
+    }
+    (*context)->allocator = *allocator;
+    (*context)->infix = NULL;
+    (*context)->postfix = NULL;
+    (*context)->operators = NULL;
+    (*context)->capacity = 0;
+    (*context)->operands = NULL;
+    (*context)->operandsCapacity = 0;
+    return CALC_OK;
+}
+
+/**
+ * Frees a context, the expressions it compiled stay valid
+ * @param context the context, may be NULL
+ */
+void calc_context_destroy(CalcContext *context)
+{
+    if (context == NULL)
+    {
+        return;
+    }
+    CalcAllocator allocator = context->allocator;
+    allocator.release(allocator.opaque, context->infix);
+    allocator.release(allocator.opaque, context->postfix);
+    allocator.release(allocator.opaque, context->operators);
+    allocator.release(allocator.opaque, context->operands);
+    allocator.release(allocator.opaque, context);
+}
+
+/**
+ * This function compiles a mathematical expression of integers, + - * / ^ and parentheses
+ * @param context the context
+ * @param text the expression, not necessarily null terminated
+ * @param len the length of the expression
+ * @param expression container for the compiled expression, must be freed with calc_free
+ * @return CALC_OK in success, CALC_ERR_SYNTAX if the expression is malformed, CALC_ERR_RANGE if one of its
+ * numbers is not a valid int and the reason of the failure otherwise
+ */
+CalcStatus calc_compile(CalcContext *context, const char *text, size_t len, CalcExpression **expression)
+{
+    int parenthesisNum;
+    Stack operators;
+    if (context == NULL || expression == NULL || (text == NULL && len > 0) || len >= INT_MAX)
+    {
+        return CALC_ERR_ARGUMENT;
+    }
+    *expression = NULL;
+    if (reserveScratch(context, len + 1) != CALC_OK)
+    {
+        return CALC_ERR_NO_MEMORY;
+    }
+    int infixLen = parseLine(text, len, context->infix, &parenthesisNum, NULL, 0);
+    if (infixLen == PARSE_OVERFLOW)
+    {
+        return CALC_ERR_RANGE;
+    }
+    if (infixLen <= 0 || !isBalanced(context->infix, infixLen))
+    {
+        return CALC_ERR_SYNTAX;
+    }
+    stackInit(&operators, context->operators, context->capacity, sizeof(char));
+    int postfixLen = convertToPostfix(context->infix, infixLen, context->postfix, &operators);
+    if (postfixLen < 0)
+    {
+        return CALC_ERR_NO_MEMORY;
+    }
+    int depth = measureDepth(context->postfix, postfixLen);
+    if (depth == 0)
+    {
+        return CALC_ERR_SYNTAX;
+    }
+
+    const CalcAllocator *allocator = &context->allocator;
+    CalcExpression *compiled = allocator->allocate(allocator->opaque,
+                                                   sizeof(CalcExpression) + postfixLen * sizeof(MathObject));
+    if (compiled == NULL)
+    {
+        return CALC_ERR_NO_MEMORY;
+    }
+    compiled->allocator = *allocator;
+    compiled->len = postfixLen;
+    compiled->depth = depth;
+    memcpy(compiled->postfix, context->postfix, postfixLen * sizeof(MathObject));
+    *expression = compiled;
+    return CALC_OK;
+}
+
+/**
+ * This function evaluates a compiled expression in 64 bits with overflow checks, / truncates towards 0
+ * @param context the context of the calling thread, not necessarily the one that compiled the expression
+ * @param expression the compiled expression
+ * @param result container for the value of the expression
+ * @return CALC_OK in success and the reason of the failure otherwise
+ */
+CalcStatus calc_eval(CalcContext *context, const CalcExpression *expression, long long *result)
+{
+    Stack operands;
+    if (context == NULL || expression == NULL || result == NULL)
+    {
+        return CALC_ERR_ARGUMENT;
+    }
+    if (reserveOperands(context, (size_t) expression->depth) != CALC_OK)
+    {
+        return CALC_ERR_NO_MEMORY;
+    }
+    // the depth was measured at compile time so the operands never outgrow the buffer
+    stackInit(&operands, context->operands, context->operandsCapacity, sizeof(long long));
+    return toCalcStatus(evaluatePostfix64(expression->postfix, expression->len, &operands, NULL, 0, result));
+}
+
+/**
+ * Frees a compiled expression
+ * @param expression the compiled expression, may be NULL
+ */
+void calc_free(CalcExpression *expression)
+{
+    if (expression != NULL)
+    {
+        CalcAllocator allocator = expression->allocator;
+        allocator.release(allocator.opaque, expression);
+    }
+}
+
+/**
+ * @return a constant description of the given status
+ */
+const char *calc_strerror(CalcStatus status)
+{
+    switch (status)
+    {
+        case CALC_OK:
+            return "success";
+        case CALC_ERR_ARGUMENT:
+            return "invalid argument";
+        case CALC_ERR_NO_MEMORY:
+            return "out of memory";
+        case CALC_ERR_SYNTAX:
+            return "malformed expression";
+        case CALC_ERR_RANGE:
+            return "number is not a valid Integer";
+        case CALC_ERR_DIV_BY_ZERO:
+            return "division by 0";
+        case CALC_ERR_OVERFLOW:
+            return "overflow";
+        default:
+            return "unknown status";
+    }
+}
@@ -0,0 +1,96 @@
+#ifndef EX3_CALC_H
+#define EX3_CALC_H
+
+// ------------------------------ includes -----------------------------
+
+#include <stddef.h>
+
+// ------------------------------ enum -----------------------------
+
+/**
+ * The status every function of the library returns, the library never prints and never exits
+ */
+typedef enum
+{
+    CALC_OK = 0,
+    CALC_ERR_ARGUMENT,
+    CALC_ERR_NO_MEMORY,
+    CALC_ERR_SYNTAX,
+    CALC_ERR_RANGE,
+    CALC_ERR_DIV_BY_ZERO,
+    CALC_ERR_OVERFLOW
+} CalcStatus;
+
+// ------------------------------ structures -----------------------------
+
+/**
+ * The memory functions of the library, allocate returns NULL if there is no memory and release accepts NULL.
+ * opaque is passed to both as is.
+ */
+typedef struct
+{
+    void *(*allocate)(void *opaque, size_t size);
+    void (*release)(void *opaque, void *pointer);
+    void *opaque;
+} CalcAllocator;
+
+/**
+ * The scratch memory of a thread that compiles and evaluates expressions. A context may only be used by one thread
+ * at a time, every thread should have its own.
+ */
+typedef struct CalcContext CalcContext;
+
+/**
+ * A compiled expression, it is never modified after calc_compile so many threads may evaluate it at once
+ */
+typedef struct CalcExpression CalcExpression;
+
+// ------------------------------ functions -----------------------------
+
+/**
+ * This function creates a context
+ * @param allocator the memory functions of the context and of the expressions it compiles, NULL for malloc and
+ * free. The allocator is copied.
+ * @param context container for the context
+ * @return CALC_OK in success and the reason of the failure otherwise
+ */
+CalcStatus calc_context_create(const CalcAllocator *allocator, CalcContext **context);
+
+/**
+ * Frees a context, the expressions it compiled stay valid
+ * @param context the context, may be NULL
+ */
+void calc_context_destroy(CalcContext *context);
+
+/**
+ * This function compiles a mathematical expression of integers, + - * / ^ and parentheses
+ * @param context the context
+ * @param text the expression, not necessarily null terminated
+ * @param len the length of the expression
+ * @param expression container for the compiled expression, must be freed with calc_free
+ * @return CALC_OK in success, CALC_ERR_SYNTAX if the expression is malformed, CALC_ERR_RANGE if one of its
+ * numbers is not a valid int and the reason of the failure otherwise
+ */
+CalcStatus calc_compile(CalcContext *context, const char *text, size_t len, CalcExpression **expression);
+
+/**
+ * This function evaluates a compiled expression in 64 bits with overflow checks, / truncates towards 0
+ * @param context the context of the calling thread, not necessarily the one that compiled the expression
+ * @param expression the compiled expression
+ * @param result container for the value of the expression
+ * @return CALC_OK in success and the reason of the failure otherwise
+ */
+CalcStatus calc_eval(CalcContext *context, const CalcExpression *expression, long long *result);
+
+/**
+ * Frees a compiled expression
+ * @param expression the compiled expression, may be NULL
+ */
+void calc_free(CalcExpression *expression);
+
+/**
+ * @return a constant description of the given status
+ */
+const char *calc_strerror(CalcStatus status);
+
+#endif
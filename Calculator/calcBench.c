@@ -0,0 +1,327 @@
+/**
+ * @file calcBench.c
+ *
+ * @brief Measures the stages of the calculator over synthetic workloads.
+ *
+ * @section DESCRIPTION
+ * Every workload is a set of random valid expressions of a given length (literals), parentheses nesting depth and
+ * operator mix (see exprGen.h). The tokenizer (parseLine), the conversion (inToPost) and the evaluation
+ * (calculatePostfix) are timed separately over the whole set, each stage feeding on the stored output of the
+ * previous one.
+ * Usage: calcBench [-n <expressions>] [-l <literals>] [-d <depth>] [-m <weights of + - * / ^>] [-r <seed>]
+ * [-o <file>] [-g]
+ * Without -l, -d or -m the standard workloads run, -g prints the expressions of the workload instead of timing them.
+ * Output : one JSON object per workload and stage with expressions, tokens, seconds, expr_per_sec and ns_per_token.
+ */
+
+// ------------------------------ includes ------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "stack.h"
+#include "inFix.h"
+#include "postFix.h"
+#include "parser.h"
+#include "exprGen.h"
+
+// -------------------------- const definitions -------------------------
+
+#define DEFAULT_EXPRESSIONS 100000
+
+#define DEFAULT_SEED 1
+
+#define CUSTOM_WORKLOAD "custom"
+
+// ------------------------------ structures -----------------------------
+
+/**
+ * A named workload
+ */
+typedef struct
+{
+    const char *name;
+    GeneratorOptions options;
+} Workload;
+
+/**
+ * The expressions of a workload and the output of every stage. Expression i is
+ * text[textOffsets[i] .. textOffsets[i + 1]) and its tokens are infix[infixOffsets[i] .. infixOffsets[i + 1]).
+ */
+typedef struct
+{
+    size_t expressionsNum;
+    char *text;
+    size_t *textOffsets;
+    MathObject *infix;
+    size_t *infixOffsets;
+    int *postfixLens;
+    MathObject **postfix;
+} Corpus;
+
+// ------------------------------ globals -----------------------------
+
+static const Workload STANDARD_WORKLOADS[] = {
+        {"short", {4, 1, {4, 4, 3, 1, 0}}},
+        {"long", {64, 2, {4, 4, 3, 1, 0}}},
+        {"nested", {32, 16, {3, 3, 3, 1, 0}}},
+        {"power", {16, 2, {2, 2, 2, 1, 3}}},
+};
+
+// ------------------------------ functions -----------------------------
+
+/**
+ * @return the current monotonic time in nanoseconds
+ */
+static double nowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/**
+ * Frees the buffers of a corpus
+ */
+static void freeCorpus(Corpus *corpus)
+{
+    size_t i;
+    if (corpus->postfix != NULL)
+    {
+        for (i = 0; i < corpus->expressionsNum; i++)
+        {
+            free(corpus->postfix[i]);
+        }
+    }
+    free(corpus->text);
+    free(corpus->textOffsets);
+    free(corpus->infix);
+    free(corpus->infixOffsets);
+    free(corpus->postfixLens);
+    free(corpus->postfix);
+}
+
+/**
+ * Generates the expressions of a workload
+ * @return 0 in success and non zero if there is no memory
+ */
+static int generateCorpus(const Workload *workload, size_t expressionsNum, unsigned int seed, Corpus *corpus)
+{
+    size_t i, expressionSize = maxExpressionSize(&workload->options);
+    memset(corpus, 0, sizeof(Corpus));
+    corpus->expressionsNum = expressionsNum;
+    corpus->text = malloc(expressionsNum * expressionSize);
+    corpus->textOffsets = malloc((expressionsNum + 1) * sizeof(size_t));
+    corpus->infix = malloc(expressionsNum * expressionSize * sizeof(MathObject));
+    corpus->infixOffsets = malloc((expressionsNum + 1) * sizeof(size_t));
+    corpus->postfixLens = malloc(expressionsNum * sizeof(int));
+    corpus->postfix = calloc(expressionsNum, sizeof(MathObject *));
+    if (corpus->text == NULL || corpus->textOffsets == NULL || corpus->infix == NULL ||
+        corpus->infixOffsets == NULL || corpus->postfixLens == NULL || corpus->postfix == NULL)
+    {
+        return 1;
+    }
+    corpus->textOffsets[0] = 0;
+    for (i = 0; i < expressionsNum; i++)
+    {
+        size_t offset = corpus->textOffsets[i];
+        corpus->textOffsets[i + 1] = offset + generateExpression(&workload->options, &seed, corpus->text + offset,
+                                                                 expressionSize);
+    }
+    return 0;
+}
+
+/**
+ * Prints the result of a stage as a JSON object
+ */
+static void report(FILE *out, const char *workload, const char *stage, const Corpus *corpus, double elapsed)
+{
+    size_t tokens = corpus->infixOffsets[corpus->expressionsNum];
+    fprintf(out, "{\"workload\": \"%s\", \"stage\": \"%s\", \"expressions\": %zu, \"tokens\": %zu, "
+                 "\"seconds\": %.6f, \"expr_per_sec\": %.0f, \"ns_per_token\": %.3f}\n", workload, stage,
+            corpus->expressionsNum, tokens, elapsed / 1e9, corpus->expressionsNum / (elapsed / 1e9),
+            tokens > 0 ? elapsed / tokens : 0.0);
+}
+
+/**
+ * Times the stages of the calculator over a workload
+ * @return 0 in success and non zero otherwise
+ */
+static int runWorkload(FILE *out, const Workload *workload, size_t expressionsNum, unsigned int seed)
+{
+    size_t i;
+    int parenthesisNum;
+    volatile long long checksum = 0;
+    Corpus corpus;
+    if (generateCorpus(workload, expressionsNum, seed, &corpus))
+    {
+        fprintf(stderr, "Error: out of memory\n");
+        freeCorpus(&corpus);
+        return 1;
+    }
+
+    double start = nowNs();
+    corpus.infixOffsets[0] = 0;
+    for (i = 0; i < expressionsNum; i++)
+    {
+        size_t offset = corpus.infixOffsets[i];
+        const char *text = corpus.text + corpus.textOffsets[i];
+        size_t len = corpus.textOffsets[i + 1] - corpus.textOffsets[i];
+        int infixLen = parseLine(text, len, corpus.infix + offset, &parenthesisNum, NULL, 0);
+        corpus.infixOffsets[i + 1] = offset + (size_t) (infixLen > 0 ? infixLen : 0);
+        corpus.postfixLens[i] = infixLen - parenthesisNum;
+    }
+    report(out, workload->name, "tokenize", &corpus, nowNs() - start);
+
+    start = nowNs();
+    for (i = 0; i < expressionsNum; i++)
+    {
+        corpus.postfix[i] = inToPost(corpus.infix + corpus.infixOffsets[i],
+                                     (int) (corpus.infixOffsets[i + 1] - corpus.infixOffsets[i]));
+    }
+    report(out, workload->name, "in_to_post", &corpus, nowNs() - start);
+
+    start = nowNs();
+    for (i = 0; i < expressionsNum; i++)
+    {
+        checksum += calculatePostfix(corpus.postfix[i], corpus.postfixLens[i]);
+    }
+    report(out, workload->name, "calculate_postfix", &corpus, nowNs() - start);
+
+    freeCorpus(&corpus);
+    return 0;
+}
+
+/**
+ * Prints the expressions of a workload, one per line
+ * @return 0 in success and non zero otherwise
+ */
+static int printWorkload(FILE *out, const Workload *workload, size_t expressionsNum, unsigned int seed)
+{
+    size_t i, expressionSize = maxExpressionSize(&workload->options);
+    char *expression = malloc(expressionSize);
+    if (expression == NULL)
+    {
+        fprintf(stderr, "Error: out of memory\n");
+        return 1;
+    }
+    for (i = 0; i < expressionsNum; i++)
+    {
+        generateExpression(&workload->options, &seed, expression, expressionSize);
+        fprintf(out, "%s\n", expression);
+    }
+    free(expression);
+    return 0;
+}
+
+/**
+ * Parses the operator weights of -m, five comma separated integers
+ * @return 0 in success and non zero otherwise
+ */
+static int parseWeights(const char *text, int *weights)
+{
+    int i;
+    char *end;
+    for (i = 0; i < GENERATOR_OPERATORS_NUM; i++)
+    {
+        long weight = strtol(text, &end, 10);
+        if (end == text || weight < 0 || *end != (i + 1 < GENERATOR_OPERATORS_NUM ? ',' : '\0'))
+        {
+            return 1;
+        }
+        weights[i] = (int) weight;
+        text = end + 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    int i, failed = 0, custom = 0, print = 0;
+    size_t expressionsNum = DEFAULT_EXPRESSIONS;
+    unsigned int seed = DEFAULT_SEED;
+    const char *fileName = NULL;
+    Workload workload = STANDARD_WORKLOADS[0];
+    workload.name = CUSTOM_WORKLOAD;
+
+    for (i = 1; i < argc && !failed; i++)
+    {
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(argv[i], "-g") == 0)
+        {
+            print = 1;
+            continue;
+        }
+        if (value == NULL)
+        {
+            failed = 1;
+            break;
+        }
+        i++;
+        if (strcmp(argv[i - 1], "-n") == 0)
+        {
+            expressionsNum = strtoul(value, NULL, 10);
+        }
+        else if (strcmp(argv[i - 1], "-l") == 0)
+        {
+            workload.options.operands = atoi(value);
+            custom = 1;
+        }
+        else if (strcmp(argv[i - 1], "-d") == 0)
+        {
+            workload.options.depth = atoi(value);
+            custom = 1;
+        }
+        else if (strcmp(argv[i - 1], "-m") == 0)
+        {
+            failed = parseWeights(value, workload.options.weights);
+            custom = 1;
+        }
+        else if (strcmp(argv[i - 1], "-r") == 0)
+        {
+            seed = (unsigned int) strtoul(value, NULL, 10);
+        }
+        else if (strcmp(argv[i - 1], "-o") == 0)
+        {
+            fileName = value;
+        }
+        else
+        {
+            failed = 1;
+        }
+    }
+    if (failed || workload.options.operands <= 0 || workload.options.depth < 0)
+    {
+        fprintf(stdout, "Usage: calcBench [-n <expressions>] [-l <literals>] [-d <depth>] "
+                        "[-m <weights of + - * / ^>] [-r <seed>] [-o <file>] [-g]\n");
+        return EXIT_FAILURE;
+    }
+    FILE *out = fileName == NULL ? stdout : fopen(fileName, "w");
+    if (out == NULL)
+    {
+        fprintf(stderr, "Error opening file: %s\n", fileName);
+        return EXIT_FAILURE;
+    }
+
+    if (print)
+    {
+        failed = printWorkload(out, custom ? &workload : &STANDARD_WORKLOADS[0], expressionsNum, seed);
+    }
+    else if (custom)
+    {
+        failed = runWorkload(out, &workload, expressionsNum, seed);
+    }
+    else
+    {
+        for (i = 0; i < (int) (sizeof(STANDARD_WORKLOADS) / sizeof(STANDARD_WORKLOADS[0])) && !failed; i++)
+        {
+            failed = runWorkload(out, &STANDARD_WORKLOADS[i], expressionsNum, seed);
+        }
+    }
+    if (out != stdout)
+    {
+        fclose(out);
+    }
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
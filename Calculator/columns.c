@@ -0,0 +1,258 @@
+// ------------------------------ includes -----------------------------
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include "parser.h"
+#include "columns.h"
+
+// -------------------------- const definitions -------------------------
+
+#define SEPARATOR ','
+
+#define INITIAL_ROWS 1024
+
+// ------------------------------ functions -----------------------------
+
+/**
+ * This function strips the end of line characters of the given line
+ */
+void stripLine(char *line, ssize_t len)
+{
+    while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r'))
+    {
+        line[--len] = '\0';
+    }
+}
+
+/**
+ * This function checks if the given name can be a variable of an expression: a letter or _ followed by letters,
+ * digits and _
+ * @return non-zero if true and false otherwise
+ */
+int isVariableName(const char *name, size_t len)
+{
+    size_t i;
+    if (len == 0 || !isVariableStart(name[0]))
+    {
+        return 0;
+    }
+    for (i = 1; i < len; i++)
+    {
+        if (!isVariableStart(name[i]) && !('0' <= name[i] && name[i] <= '9'))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * This function parses the header line of the table and creates its columns, every separator ends a name. Empty
+ * names, names that can't be variables and names that repeat an earlier one are rejected, so every column can be
+ * referred to.
+ * @return 0 in success and non zero otherwise (the reason is printed to stderr)
+ */
+int readHeader(Table *table, char *line)
+{
+    int i, j;
+    char *name, *end;
+    table->columnsNum = 1;
+    for (name = line; *name; name++)
+    {
+        table->columnsNum += *name == SEPARATOR;
+    }
+    table->names = calloc((size_t) table->columnsNum, sizeof(char *));
+    table->columns = calloc((size_t) table->columnsNum, sizeof(int *));
+    if (table->names == NULL || table->columns == NULL)
+    {
+        fprintf(stderr, "Error: out of memory\n");
+        return 1;
+    }
+    for (i = 0, name = line; i < table->columnsNum; i++, name = end + 1)
+    {
+        end = strchrnul(name, SEPARATOR);
+        if (end == name)
+        {
+            fprintf(stderr, "Error: column %d of the header has no name\n", i + 1);
+            return 1;
+        }
+        size_t len = (size_t) (end - name);
+        if (!isVariableName(name, len))
+        {
+            fprintf(stderr, "Error: column %d of the header, %.*s, is not a valid variable name\n", i + 1, (int) len,
+                    name);
+            return 1;
+        }
+        for (j = 0; j < i; j++)
+        {
+            if (strncmp(table->names[j], name, len) == 0 && table->names[j][len] == '\0')
+            {
+                fprintf(stderr, "Error: columns %d and %d of the header are both named %.*s\n", j + 1, i + 1,
+                        (int) len, name);
+                return 1;
+            }
+        }
+        table->names[i] = strndup(name, len);
+        table->columns[i] = malloc(table->capacity * sizeof(int));
+        if (table->names[i] == NULL || table->columns[i] == NULL)
+        {
+            fprintf(stderr, "Error: out of memory\n");
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * This function doubles the number of rows the columns of the table can hold
+ * @return 0 in success and non zero otherwise
+ */
+int growTable(Table *table)
+{
+    int i;
+    for (i = 0; i < table->columnsNum; i++)
+    {
+        int *grown = realloc(table->columns[i], 2 * table->capacity * sizeof(int));
+        if (grown == NULL)
+        {
+            return 1;
+        }
+        table->columns[i] = grown;
+    }
+    table->capacity *= 2;
+    return 0;
+}
+
+/**
+ * This function parses a single row of the table and appends it to the columns
+ * @return 0 in success and non zero otherwise
+ */
+int readRow(Table *table, const char *line)
+{
+    int i;
+    long value;
+    char *end;
+    if (table->rows == table->capacity && growTable(table))
+    {
+        fprintf(stderr, "Error: out of memory\n");
+        return 1;
+    }
+    for (i = 0; i < table->columnsNum; i++)
+    {
+        errno = 0;
+        value = strtol(line, &end, 10);
+        if (end == line || errno != 0 || value != (int) value ||
+            *end != (i + 1 < table->columnsNum ? SEPARATOR : '\0'))
+        {
+            fprintf(stderr, "Error: row %zu is not a valid row of %d Integers\n", table->rows + 1,
+                    table->columnsNum);
+            return 1;
+        }
+        table->columns[i][table->rows] = (int) value;
+        line = end + 1;
+    }
+    table->rows++;
+    return 0;
+}
+
+/**
+ * This function reads a CSV file whose first line holds the names of the columns and every other line holds one
+ * integer per column
+ * @param file the file to read
+ * @return the table or NULL if the file is not a valid table (the reason is printed to stderr)
+ */
+Table *readTable(FILE *file)
+{
+    char *line = NULL;
+    size_t lineCapacity = 0;
+    ssize_t len;
+    Table *table = calloc(1, sizeof(Table));
+    if (table == NULL)
+    {
+        return NULL;
+    }
+    table->capacity = INITIAL_ROWS;
+
+    len = getline(&line, &lineCapacity, file);
+    if (len <= 0)
+    {
+        fprintf(stderr, "Error: the table has no header\n");
+        free(line);
+        freeTable(table);
+        return NULL;
+    }
+    stripLine(line, len);
+    if (readHeader(table, line))
+    {
+        free(line);
+        freeTable(table);
+        return NULL;
+    }
+
+    while ((len = getline(&line, &lineCapacity, file)) > 0)
+    {
+        stripLine(line, len);
+        if (*line == '\0')
+        {
+            continue;
+        }
+        if (readRow(table, line))
+        {
+            free(line);
+            freeTable(table);
+            return NULL;
+        }
+    }
+    free(line);
+    return table;
+}
+
+/**
+ * This function finds the index of the column with the given name
+ * @param table the table
+ * @param name the name of the column, not necessarily null terminated
+ * @param len the length of the name
+ * @return the index of the column or -1 if there is no such column
+ */
+int findColumn(const Table *table, const char *name, size_t len)
+{
+    int i;
+    for (i = 0; i < table->columnsNum; i++)
+    {
+        if (strncmp(table->names[i], name, len) == 0 && table->names[i][len] == '\0')
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Frees a table
+ * @param table the table
+ */
+void freeTable(Table *table)
+{
+    int i;
+    if (table == NULL)
+    {
+        return;
+    }
+    for (i = 0; i < table->columnsNum; i++)
+    {
+        if (table->names != NULL)
+        {
+            free(table->names[i]);
+        }
+        if (table->columns != NULL)
+        {
+            free(table->columns[i]);
+        }
+    }
+    free(table->names);
+    free(table->columns);
+    free(table);
+}
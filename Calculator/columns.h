@@ -0,0 +1,47 @@
+#ifndef EX3_COLUMNS_H
+#define EX3_COLUMNS_H
+
+// ------------------------------ includes -----------------------------
+
+#include <stdio.h>
+
+// ------------------------------ structures -----------------------------
+
+/**
+ * A table of int columns, the values of column i are columns[i][0 .. rows - 1]
+ */
+typedef struct
+{
+    char **names;
+    int **columns;
+    int columnsNum;
+    size_t rows;
+    size_t capacity;
+} Table;
+
+// ------------------------------ functions -----------------------------
+
+/**
+ * This function reads a CSV file whose first line holds the names of the columns and every other line holds one
+ * integer per column
+ * @param file the file to read
+ * @return the table or NULL if the file is not a valid table (the reason is printed to stderr)
+ */
+Table *readTable(FILE *file);
+
+/**
+ * This function finds the index of the column with the given name
+ * @param table the table
+ * @param name the name of the column, not necessarily null terminated
+ * @param len the length of the name
+ * @return the index of the column or -1 if there is no such column
+ */
+int findColumn(const Table *table, const char *name, size_t len);
+
+/**
+ * Frees a table
+ * @param table the table
+ */
+void freeTable(Table *table);
+
+#endif
@@ -0,0 +1,147 @@
+// ------------------------------ includes -----------------------------
+
+#include "exprGen.h"
+
+// -------------------------- const definitions -------------------------
+
+#define MAX_LITERAL_CHARS 2
+
+// ------------------------------ structures -----------------------------
+
+/**
+ * The buffer an expression is generated into, overflow is set once something didn't fit
+ */
+typedef struct
+{
+    char *buffer;
+    size_t len;
+    size_t capacity;
+    int overflow;
+} ExpressionWriter;
+
+// ------------------------------ functions -----------------------------
+
+/**
+ * This function appends a char to the expression
+ */
+void appendChar(ExpressionWriter *writer, char c)
+{
+    if (writer->len + 1 >= writer->capacity)
+    {
+        writer->overflow = 1;
+        return;
+    }
+    writer->buffer[writer->len++] = c;
+}
+
+/**
+ * This function appends a literal to the expression
+ */
+void appendLiteral(ExpressionWriter *writer, int value)
+{
+    if (value >= 10)
+    {
+        appendChar(writer, (char) ('0' + value / 10));
+    }
+    appendChar(writer, (char) ('0' + value % 10));
+}
+
+/**
+ * This function draws an operator with the weights of the options
+ */
+char pickOperator(const GeneratorOptions *options, unsigned int *seed)
+{
+    int i, total = 0;
+    for (i = 0; i < GENERATOR_OPERATORS_NUM; i++)
+    {
+        total += options->weights[i];
+    }
+    if (total <= 0)
+    {
+        return GENERATOR_OPERATORS[0];
+    }
+    int drawn = rand_r(seed) % total;
+    for (i = 0; drawn >= options->weights[i]; i++)
+    {
+        drawn -= options->weights[i];
+    }
+    return GENERATOR_OPERATORS[i];
+}
+
+void generateNode(ExpressionWriter *writer, const GeneratorOptions *options, unsigned int *seed, int operands,
+                  int depth);
+
+/**
+ * This function generates an operand of an operator, a compound operand is parenthesized at random while the
+ * nesting allows it
+ */
+void generateChild(ExpressionWriter *writer, const GeneratorOptions *options, unsigned int *seed, int operands,
+                   int depth)
+{
+    if (operands > 1 && depth > 0 && rand_r(seed) % 2)
+    {
+        appendChar(writer, '(');
+        generateNode(writer, options, seed, operands, depth - 1);
+        appendChar(writer, ')');
+        return;
+    }
+    generateNode(writer, options, seed, operands, depth);
+}
+
+/**
+ * This function generates a subexpression with the given number of literals
+ */
+void generateNode(ExpressionWriter *writer, const GeneratorOptions *options, unsigned int *seed, int operands,
+                  int depth)
+{
+    if (operands <= 1)
+    {
+        appendLiteral(writer, rand_r(seed) % (MAX_GENERATED_LITERAL + 1));
+        return;
+    }
+    char operator = pickOperator(options, seed);
+    if (operator == '/' || operator == '^')
+    {
+        generateChild(writer, options, seed, operands - 1, depth);
+        appendChar(writer, operator);
+        appendLiteral(writer, operator == '/' ? 1 + rand_r(seed) % MAX_GENERATED_LITERAL :
+                              rand_r(seed) % (MAX_GENERATED_EXPONENT + 1));
+        return;
+    }
+    int leftOperands = 1 + rand_r(seed) % (operands - 1);
+    generateChild(writer, options, seed, leftOperands, depth);
+    appendChar(writer, operator);
+    generateChild(writer, options, seed, operands - leftOperands, depth);
+}
+
+/**
+ * This function generates a random valid infix expression. The expression has exactly options->operands literals,
+ * parentheses nest at most options->depth deep and its operators are drawn with options->weights. The right operand
+ * of / is a literal that is not 0 and the right operand of ^ is a literal of at most MAX_GENERATED_EXPONENT.
+ * @param options the shape of the expression
+ * @param seed the state of the random numbers (rand_r)
+ * @param buffer container for the expression, it is null terminated and has no new line
+ * @param capacity the size of the buffer
+ * @return the length of the expression or 0 if it doesn't fit in the buffer
+ */
+size_t generateExpression(const GeneratorOptions *options, unsigned int *seed, char *buffer, size_t capacity)
+{
+    ExpressionWriter writer = {buffer, 0, capacity, 0};
+    generateNode(&writer, options, seed, options->operands, options->depth);
+    if (writer.overflow || capacity == 0)
+    {
+        return 0;
+    }
+    buffer[writer.len] = '\0';
+    return writer.len;
+}
+
+/**
+ * @return the size of a buffer that fits any expression generated with the given options
+ */
+size_t maxExpressionSize(const GeneratorOptions *options)
+{
+    // every literal is followed by an operator and every compound subexpression may be parenthesized
+    size_t operands = options->operands > 0 ? (size_t) options->operands : 1;
+    return operands * (MAX_LITERAL_CHARS + 1) + 2 * operands + 1;
+}
@@ -0,0 +1,55 @@
+#ifndef EX3_EXPRGEN_H
+#define EX3_EXPRGEN_H
+
+// ------------------------------ includes -----------------------------
+
+#include <stdlib.h>
+
+// -------------------------- const definitions -------------------------
+
+/**
+ * The operators the generator draws from, in the order of the weights of GeneratorOptions
+ */
+#define GENERATOR_OPERATORS "+-*/^"
+
+#define GENERATOR_OPERATORS_NUM 5
+
+/**
+ * The biggest literal the generator writes, divisors are never 0 and exponents are at most MAX_GENERATED_EXPONENT
+ */
+#define MAX_GENERATED_LITERAL 99
+
+#define MAX_GENERATED_EXPONENT 3
+
+// ------------------------------ structures -----------------------------
+
+/**
+ * The shape of generated expressions
+ */
+typedef struct
+{
+    int operands;
+    int depth;
+    int weights[GENERATOR_OPERATORS_NUM];
+} GeneratorOptions;
+
+// ------------------------------ functions -----------------------------
+
+/**
+ * This function generates a random valid infix expression. The expression has exactly options->operands literals,
+ * parentheses nest at most options->depth deep and its operators are drawn with options->weights. The right operand
+ * of / is a literal that is not 0 and the right operand of ^ is a literal of at most MAX_GENERATED_EXPONENT.
+ * @param options the shape of the expression
+ * @param seed the state of the random numbers (rand_r)
+ * @param buffer container for the expression, it is null terminated and has no new line
+ * @param capacity the size of the buffer
+ * @return the length of the expression or 0 if it doesn't fit in the buffer
+ */
+size_t generateExpression(const GeneratorOptions *options, unsigned int *seed, char *buffer, size_t capacity);
+
+/**
+ * @return the size of a buffer that fits any expression generated with the given options
+ */
+size_t maxExpressionSize(const GeneratorOptions *options);
+
+#endif
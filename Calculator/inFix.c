@@ -19,7 +19,7 @@
  * This function pops the top of the stack until it ends and and each time it adds the top of the stack to
  * the given array of objects
  */
-void appendFromStack(int counter, Stack *stack, MathObject *convert)
+int appendFromStack(int counter, Stack *stack, MathObject *convert)
 {
     char headData;
     while (!isEmptyStack(stack))
@@ -28,6 +28,7 @@ void appendFromStack(int counter, Stack *stack, MathObject *convert)
         convert[counter].type = headData;
         counter++;
     }
+    return counter;
 }
 
 /**
@@ -36,8 +37,7 @@ void appendFromStack(int counter, Stack *stack, MathObject *convert)
 char getTopStack(Stack *stack, char headData)
 {
     assert(!isEmptyStack(stack));
-    pop(stack, &headData);
-    push(stack, &headData);
+    peek(stack, &headData);
     return headData;
 }
 
@@ -100,6 +100,7 @@ int popTillLeftPar(Stack *stack, MathObject *convert, char type, int counter)
 
 /**
  * This function handles an operator in the progress of converting infix to post fix
+ * @return the length of the converted expression or -1 if the stack can't hold the operator
  */
 int handleOperator(int counter, Stack *stack, MathObject *convert, char headData, char currType)
 {
@@ -108,39 +109,35 @@ int handleOperator(int counter, Stack *stack, MathObject *convert, char headData
     {
         headData = getTopStack(stack, headData);
     }
-    if (isEmpty || headData == lPar)
-    {
-        push(stack, &currType);
-    }
-    else
+    if (!isEmpty && headData != lPar)
     {
         counter = popTillLeftPar(stack, convert, currType, counter);
-        push(stack, &currType);
     }
-    return counter;
+    return push(stack, &currType) == 0 ? counter : -1;
 }
 
 /**
-*This function  is given mathematical expression presented by infix and converts it to
-* mathematical expression presented by postfix and returns it
+* This function is given mathematical expression presented by infix and converts it to
+* mathematical expression presented by postfix into the given array
 * @param infix mathematical expression to be converted to Postfix expression
 * @param len length of the expression
-* @return the mathematical expression in postfix
+* @param converted container for the postfix expression, must hold at least len objects
+* @param stack an empty or reusable stack of chars for the operators
+* @return the length of the postfix expression or -1 if the stack can't hold the operators
 */
-MathObject *inToPost(MathObject *infix, int len)
+int convertToPostfix(const MathObject *infix, int len, MathObject *converted, Stack *stack)
 {
     int i, currValue, counter = 0;
-    Stack *stack = stackAlloc(sizeof(char));
-    MathObject *converted = (MathObject *) allocateMemory(MAX_LINE * sizeof(MathObject));
     char headData, currType;
     headData = 0;
+    clearStack(stack);
 
     for (i = 0; i < len; i++)
     {
         currType = infix[i].type;
         currValue = infix[i].value;
 
-        if (currType == operand)
+        if (currType == operand || currType == variable || currType == literal)
         {
             counter = appendOperand(counter, converted, currType, currValue);
 
@@ -148,12 +145,19 @@ MathObject *inToPost(MathObject *infix, int len)
         else if (currType != lPar && currType != rPar)
         {
             counter = handleOperator(counter, stack, converted, headData, currType);
+            if (counter < 0)
+            {
+                return -1;
+            }
         }
         else
         {
             if (currType == lPar)
             {
-                push(stack, &currType);
+                if (push(stack, &currType) != 0)
+                {
+                    return -1;
+                }
             }
             else
             {
@@ -161,7 +165,25 @@ MathObject *inToPost(MathObject *infix, int len)
             }
         }
     }
-    appendFromStack(counter, stack, converted);
+    return appendFromStack(counter, stack, converted);
+}
+
+/**
+*This function  is given mathematical expression presented by infix and converts it to
+* mathematical expression presented by postfix and returns it
+* @param infix mathematical expression to be converted to Postfix expression
+* @param len length of the expression
+* @return the mathematical expression in postfix
+*/
+MathObject *inToPost(MathObject *infix, int len)
+{
+    Stack *stack = stackAlloc(sizeof(char));
+    MathObject *converted = (MathObject *) allocateMemory((len > 0 ? len : 1) * sizeof(MathObject));
+    if (stack == NULL || convertToPostfix(infix, len, converted, stack) < 0)
+    {
+        fprintf(stderr, "The stack is out of memory\n");
+        exit(EXIT_FAILURE);
+    }
     freeStack(&stack);
     return converted;
-}
\ No newline at end of file
+}
\ No newline at end of file
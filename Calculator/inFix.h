@@ -21,12 +21,16 @@ typedef enum
     rPar = ')',
     lPar = '(',
     operand = 'p',
+    variable = 'v',
+    literal = 'l',
 } type;
 
 // ------------------------------ structures -----------------------------
 
 /**
-* Represents a mathematical object from a mathematical expression
+* Represents a mathematical object from a mathematical expression, the value of a variable is its index in the
+* variables the expression is evaluated with and the value of a literal, a number that is not a valid int, is the
+* offset of its text in the expression
 */
 typedef struct
 {
@@ -37,6 +41,17 @@ typedef struct
 // ------------------------------ includes -----------------------------
 
 
+/**
+ * This function is given mathematical expression presented by infix and converts it to
+ * mathematical expression presented by postfix into the given array
+ * @param infix mathematical expression to be converted to Postfix expression
+ * @param len length of the expression
+ * @param converted container for the postfix expression, must hold at least len objects
+ * @param stack an empty or reusable stack of chars for the operators
+ * @return the length of the postfix expression or -1 if the stack can't hold the operators
+ */
+int convertToPostfix(const MathObject *infix, int len, MathObject *converted, Stack *stack);
+
 /**
  *This function  is given mathematical expression presented by infix and converts it to
  * mathematical expression presented by postfix and returns it
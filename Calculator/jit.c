@@ -0,0 +1,370 @@
+// ------------------------------ includes -----------------------------
+
+#include <limits.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "jit.h"
+
+// -------------------------- const definitions -------------------------
+
+#define MAX_INSTRUCTION_BYTES 48
+
+#define FRAME_BYTES 96
+
+#define REG_EAX 0
+
+#define REG_EDX 2
+
+#define REG_EDI 7
+
+#define REX 0x40
+
+#define REX_R 0x04
+
+#define REX_B 0x01
+
+#define MOD_DIRECT 0xC0
+
+// ------------------------------ structures -----------------------------
+
+/**
+ * The machine code that is being written
+ */
+typedef struct
+{
+    unsigned char *code;
+    size_t len;
+} Emitter;
+
+/**
+ * A jump to the failure code, offset is the offset of its 32 bit displacement and status the failure it reports
+ */
+typedef struct
+{
+    size_t offset;
+    EvalStatus status;
+} FailJump;
+
+// ------------------------------ globals -----------------------------
+
+/**
+ * The registers of the operand stack, slot i of the stack lives in stackRegisters[i]
+ */
+const int stackRegisters[JIT_REGISTERS] = {8, 9, 10, 11, 1, 3, 12, 13, 14, 15};
+
+// ------------------------------ functions -----------------------------
+
+/**
+ * Appends a byte to the machine code
+ */
+void emitByte(Emitter *emitter, int byte)
+{
+    emitter->code[emitter->len++] = (unsigned char) byte;
+}
+
+/**
+ * Appends a 32 bit little endian value to the machine code
+ */
+void emitInt(Emitter *emitter, int value)
+{
+    unsigned int bits = (unsigned int) value;
+    emitByte(emitter, (int) (bits & 0xFF));
+    emitByte(emitter, (int) ((bits >> 8) & 0xFF));
+    emitByte(emitter, (int) ((bits >> 16) & 0xFF));
+    emitByte(emitter, (int) (bits >> 24));
+}
+
+/**
+ * Appends a register to register instruction, reg goes in the reg field of ModRM and rm in the rm field
+ */
+void emitRegisters(Emitter *emitter, int opcode, int reg, int rm)
+{
+    int rex = (reg >= 8 ? REX_R : 0) | (rm >= 8 ? REX_B : 0);
+    if (rex)
+    {
+        emitByte(emitter, REX | rex);
+    }
+    if (opcode > 0xFF)
+    {
+        emitByte(emitter, opcode >> 8);
+    }
+    emitByte(emitter, opcode & 0xFF);
+    emitByte(emitter, MOD_DIRECT | ((reg & 7) << 3) | (rm & 7));
+}
+
+/**
+ * Appends the prologue, the callee saved registers of the operand stack are saved
+ */
+void emitPrologue(Emitter *emitter)
+{
+    emitByte(emitter, 0x53);                       // push rbx
+    emitByte(emitter, 0x41), emitByte(emitter, 0x54); // push r12
+    emitByte(emitter, 0x41), emitByte(emitter, 0x55); // push r13
+    emitByte(emitter, 0x41), emitByte(emitter, 0x56); // push r14
+    emitByte(emitter, 0x41), emitByte(emitter, 0x57); // push r15
+}
+
+/**
+ * Appends the epilogue and returns eax
+ */
+void emitEpilogue(Emitter *emitter)
+{
+    emitByte(emitter, 0x41), emitByte(emitter, 0x5F); // pop r15
+    emitByte(emitter, 0x41), emitByte(emitter, 0x5E); // pop r14
+    emitByte(emitter, 0x41), emitByte(emitter, 0x5D); // pop r13
+    emitByte(emitter, 0x41), emitByte(emitter, 0x5C); // pop r12
+    emitByte(emitter, 0x5B);                       // pop rbx
+    emitByte(emitter, 0xC3);                       // ret
+}
+
+/**
+ * Appends a jump to the failure code that reports the given status, jcc is the second byte of the near jump opcode
+ * @param failJumps container for the jumps to the failure code
+ */
+void emitFailJump(Emitter *emitter, int jcc, EvalStatus status, FailJump *failJumps, int *failJumpsNum)
+{
+    emitByte(emitter, 0x0F), emitByte(emitter, jcc);
+    failJumps[*failJumpsNum].offset = emitter->len;
+    failJumps[(*failJumpsNum)++].status = status;
+    emitInt(emitter, 0);
+}
+
+/**
+ * Appends a division of the register dst by the register src into dst, a zero divisor and INT_MIN / -1, which
+ * traps in idiv, jump to the failure code
+ * @param failJumps container for the jumps to the failure code
+ */
+void emitDivision(Emitter *emitter, int dst, int src, FailJump *failJumps, int *failJumpsNum)
+{
+    size_t skip;
+    emitRegisters(emitter, 0x85, src, src);        // test src, src
+    emitFailJump(emitter, 0x84, EVAL_DIV_BY_ZERO, failJumps, failJumpsNum); // jz fail
+    emitRegisters(emitter, 0x83, 7, src);          // cmp src, -1
+    emitByte(emitter, 0xFF);
+    emitByte(emitter, 0x75);                       // jne divide
+    skip = emitter->len;
+    emitByte(emitter, 0);
+    emitRegisters(emitter, 0x81, 7, dst);          // cmp dst, INT_MIN
+    emitInt(emitter, INT_MIN);
+    emitFailJump(emitter, 0x84, EVAL_OVERFLOW, failJumps, failJumpsNum); // je fail
+    emitter->code[skip] = (unsigned char) (emitter->len - (skip + 1));
+    emitRegisters(emitter, 0x89, dst, REG_EAX);    // mov eax, dst
+    emitByte(emitter, 0x99);                       // cdq
+    emitRegisters(emitter, 0xF7, 7, src);          // idiv src
+    emitRegisters(emitter, 0x89, REG_EAX, dst);    // mov dst, eax
+}
+
+/**
+ * Finds if the given byte code can be compiled
+ */
+int isJitSupported(const ByteCode *byteCode)
+{
+    int i;
+#if !defined(__x86_64__)
+    return 0;
+#endif
+    if (byteCode->maxDepth > JIT_REGISTERS)
+    {
+        return 0;
+    }
+    for (i = 0; i < byteCode->length; i++)
+    {
+        if (byteCode->code[i] == OP_POW)
+        {
+            return 0;
+        }
+        if (byteCode->code[i] == OP_PUSH || byteCode->code[i] == OP_LOAD)
+        {
+            i++;
+        }
+    }
+    return 1;
+}
+
+/**
+ * This function writes the machine code of the given byte code
+ * @param failJumps scratch space for the jumps to the failure code, two per instruction
+ */
+void emitFunction(Emitter *emitter, const ByteCode *byteCode, FailJump *failJumps)
+{
+    static const EvalStatus failures[] = {EVAL_DIV_BY_ZERO, EVAL_OVERFLOW};
+    int depth = 0, failJumpsNum = 0, i, j;
+    const int *pc = byteCode->code;
+    emitPrologue(emitter);
+    for (;;)
+    {
+        int top = depth - 1;
+        switch (*pc++)
+        {
+            case OP_PUSH:
+                if (stackRegisters[depth] >= 8)
+                {
+                    emitByte(emitter, REX | REX_B);
+                }
+                emitByte(emitter, 0xB8 + (stackRegisters[depth] & 7)); // mov reg, imm32
+                emitInt(emitter, *pc++);
+                depth++;
+                break;
+            case OP_LOAD:
+                // mov reg, [rdi + index * 4]
+                if (stackRegisters[depth] >= 8)
+                {
+                    emitByte(emitter, REX | REX_R);
+                }
+                emitByte(emitter, 0x8B);
+                emitByte(emitter, 0x80 | ((stackRegisters[depth] & 7) << 3) | REG_EDI);
+                emitInt(emitter, *pc++ * (int) sizeof(int));
+                depth++;
+                break;
+            case OP_ADD:
+                emitRegisters(emitter, 0x01, stackRegisters[top], stackRegisters[top - 1]);
+                depth--;
+                break;
+            case OP_SUB:
+                emitRegisters(emitter, 0x29, stackRegisters[top], stackRegisters[top - 1]);
+                depth--;
+                break;
+            case OP_MUL:
+                emitRegisters(emitter, 0x0FAF, stackRegisters[top - 1], stackRegisters[top]);
+                depth--;
+                break;
+            case OP_DIV:
+                emitDivision(emitter, stackRegisters[top - 1], stackRegisters[top], failJumps, &failJumpsNum);
+                depth--;
+                break;
+            default:
+                emitRegisters(emitter, 0x89, stackRegisters[0], REG_EAX); // mov eax, result
+                emitEpilogue(emitter);
+                // the failure code of every status stores it in *failed and returns 0
+                for (j = 0; j < (int) (sizeof(failures) / sizeof(failures[0])); j++)
+                {
+                    for (i = 0; i < failJumpsNum; i++)
+                    {
+                        if (failJumps[i].status == failures[j])
+                        {
+                            int offset = (int) (emitter->len - (failJumps[i].offset + sizeof(int)));
+                            memcpy(emitter->code + failJumps[i].offset, &offset, sizeof(int));
+                        }
+                    }
+                    emitByte(emitter, 0xC7), emitByte(emitter, 0x06); // mov dword [rsi], status
+                    emitInt(emitter, failures[j]);
+                    emitRegisters(emitter, 0x31, REG_EAX, REG_EAX);     // xor eax, eax
+                    emitEpilogue(emitter);
+                }
+                return;
+        }
+    }
+}
+
+/**
+ * This function compiles byte code to x86-64 machine code. The operand stack lives in registers.
+ * @param byteCode the byte code
+ * @return the native code or NULL if the expression can't be compiled (not an x86-64 machine, the expression uses
+ * ^ or is deeper than JIT_REGISTERS) and must be evaluated by the VM
+ */
+JitCode *compileJit(const ByteCode *byteCode)
+{
+    if (byteCode == NULL || !isJitSupported(byteCode))
+    {
+        return NULL;
+    }
+    size_t pageSize = (size_t) sysconf(_SC_PAGESIZE);
+    size_t size = (size_t) byteCode->length * MAX_INSTRUCTION_BYTES + FRAME_BYTES;
+    size = (size + pageSize - 1) / pageSize * pageSize;
+    JitCode *jitCode = malloc(sizeof(JitCode));
+    FailJump *failJumps = malloc(2 * (size_t) byteCode->length * sizeof(FailJump));
+    void *pages = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (jitCode == NULL || failJumps == NULL || pages == MAP_FAILED)
+    {
+        free(jitCode);
+        free(failJumps);
+        if (pages != MAP_FAILED)
+        {
+            munmap(pages, size);
+        }
+        return NULL;
+    }
+
+    Emitter emitter = {(unsigned char *) pages, 0};
+    emitFunction(&emitter, byteCode, failJumps);
+    free(failJumps);
+    if (mprotect(pages, size, PROT_READ | PROT_EXEC) != 0)
+    {
+        munmap(pages, size);
+        free(jitCode);
+        return NULL;
+    }
+    jitCode->pages = pages;
+    jitCode->size = size;
+    *(void **) &jitCode->function = pages;
+    return jitCode;
+}
+
+/**
+ * This function evaluates native code
+ * @param jitCode the native code
+ * @param variables the values of the variables of the expression, may be NULL if it has none
+ * @param result container for the value of the expression
+ * @return EVAL_OK in success and the reason of the failure otherwise
+ */
+EvalStatus runJit(const JitCode *jitCode, const int *variables, int *result)
+{
+    int failed = 0;
+    *result = jitCode->function(variables, &failed);
+    return (EvalStatus) failed;
+}
+
+/**
+ * This function evaluates native code over many rows, variable i of row r is columns[i][r]
+ * @param jitCode the native code
+ * @param variablesNum the number of variables of the expression
+ * @param columns the columns of the variables, may be NULL if the expression has none
+ * @param rows the number of rows
+ * @param results container for the value of each row
+ * @param failed container that is set to the status of the evaluation of every row, EVAL_OK (0) or the reason of the
+ * failure
+ * @return EVAL_OK if all the rows were evaluated and the status of the first failed row if some rows failed
+ */
+EvalStatus runJitRows(const JitCode *jitCode, int variablesNum, const int *const *columns, size_t rows,
+                      int *results, char *failed)
+{
+    size_t r;
+    int i, rowFailed;
+    EvalStatus status = EVAL_OK;
+    int variables[BYTECODE_MAX_DEPTH];
+    int *row = variablesNum <= BYTECODE_MAX_DEPTH ? variables : malloc((size_t) variablesNum * sizeof(int));
+    if (row == NULL)
+    {
+        return EVAL_NO_MEMORY;
+    }
+    for (r = 0; r < rows; r++)
+    {
+        for (i = 0; i < variablesNum; i++)
+        {
+            row[i] = columns[i][r];
+        }
+        rowFailed = 0;
+        results[r] = jitCode->function(row, &rowFailed);
+        failed[r] = (char) rowFailed;
+        status = status == EVAL_OK ? (EvalStatus) rowFailed : status;
+    }
+    if (row != variables)
+    {
+        free(row);
+    }
+    return status;
+}
+
+/**
+ * Frees native code
+ * @param jitCode the native code
+ */
+void freeJit(JitCode *jitCode)
+{
+    if (jitCode != NULL)
+    {
+        munmap(jitCode->pages, jitCode->size);
+        free(jitCode);
+    }
+}
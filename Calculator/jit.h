@@ -0,0 +1,73 @@
+#ifndef EX3_JIT_H
+#define EX3_JIT_H
+
+// ------------------------------ includes -----------------------------
+
+#include <stdlib.h>
+#include "byteCode.h"
+
+// -------------------------- const definitions -------------------------
+
+/**
+ * The number of registers that hold the operand stack of compiled code, deeper expressions are not compiled
+ */
+#define JIT_REGISTERS 10
+
+// ------------------------------ structures -----------------------------
+
+/**
+ * A compiled expression, sets *failed to the reason of the failure and returns 0 if it divides by 0 or computes
+ * INT_MIN / -1
+ */
+typedef int (*JitFunction)(const int *variables, int *failed);
+
+/**
+ * Native code of an expression that lives in its own executable pages
+ */
+typedef struct
+{
+    JitFunction function;
+    void *pages;
+    size_t size;
+} JitCode;
+
+// ------------------------------ functions -----------------------------
+
+/**
+ * This function compiles byte code to x86-64 machine code. The operand stack lives in registers.
+ * @param byteCode the byte code
+ * @return the native code or NULL if the expression can't be compiled (not an x86-64 machine, the expression uses
+ * ^ or is deeper than JIT_REGISTERS) and must be evaluated by the VM
+ */
+JitCode *compileJit(const ByteCode *byteCode);
+
+/**
+ * This function evaluates native code
+ * @param jitCode the native code
+ * @param variables the values of the variables of the expression, may be NULL if it has none
+ * @param result container for the value of the expression
+ * @return EVAL_OK in success and the reason of the failure otherwise
+ */
+EvalStatus runJit(const JitCode *jitCode, const int *variables, int *result);
+
+/**
+ * This function evaluates native code over many rows, variable i of row r is columns[i][r]
+ * @param jitCode the native code
+ * @param variablesNum the number of variables of the expression
+ * @param columns the columns of the variables, may be NULL if the expression has none
+ * @param rows the number of rows
+ * @param results container for the value of each row
+ * @param failed container that is set to the status of the evaluation of every row, EVAL_OK (0) or the reason of the
+ * failure
+ * @return EVAL_OK if all the rows were evaluated and the status of the first failed row if some rows failed
+ */
+EvalStatus runJitRows(const JitCode *jitCode, int variablesNum, const int *const *columns, size_t rows,
+                      int *results, char *failed);
+
+/**
+ * Frees native code
+ * @param jitCode the native code
+ */
+void freeJit(JitCode *jitCode);
+
+#endif
@@ -0,0 +1,298 @@
+/**
+ * A load generator for the calculator server (calc -d). Every connection runs on its own thread and keeps a window
+ * of pipelined requests in flight, the latency of a request is the time from sending it to reading its response.
+ * Usage: loadgen <socket> [connections] [requests per connection] [pipeline depth]
+ */
+
+// ------------------------------ includes -----------------------------
+
+#define _GNU_SOURCE
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+#include "server.h"
+
+// -------------------------- const definitions -------------------------
+
+#define DEFAULT_CONNECTIONS 4
+
+#define DEFAULT_REQUESTS 100000
+
+#define DEFAULT_DEPTH 16
+
+#define EXPRESSIONS_NUM 64
+
+#define MAX_EXPRESSION_CHARS 64
+
+#define MAX_RESPONSE_SIZE 256
+
+#define ERROR_PREFIX "error: "
+
+// ------------------------------ structures -----------------------------
+
+/**
+ * A connection of the load generator and what it measured
+ */
+typedef struct
+{
+    const char *socketPath;
+    size_t requestsNum;
+    size_t receivedNum;
+    size_t depth;
+    unsigned int seed;
+    double *latencies;
+    size_t errorsNum;
+    int failed;
+    int started;
+    pthread_t thread;
+} Client;
+
+// ------------------------------ functions -----------------------------
+
+/**
+ * @return the current time of a monotonic clock in nanoseconds
+ */
+double nowNs()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+/**
+ * This function writes the whole buffer to the socket
+ * @return 0 in success and non zero otherwise
+ */
+int writeAll(int fd, const char *buffer, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t written = write(fd, buffer, len);
+        if (written < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (written <= 0)
+        {
+            return 1;
+        }
+        buffer += written;
+        len -= (size_t) written;
+    }
+    return 0;
+}
+
+/**
+ * This function reads exactly len bytes from the socket
+ * @return 0 in success and non zero otherwise
+ */
+int readAll(int fd, char *buffer, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t readNum = read(fd, buffer, len);
+        if (readNum < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (readNum <= 0)
+        {
+            return 1;
+        }
+        buffer += readNum;
+        len -= (size_t) readNum;
+    }
+    return 0;
+}
+
+/**
+ * This function connects to the server
+ * @return the socket or -1 if it can't connect
+ */
+int connectTo(const char *socketPath)
+{
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, socketPath, sizeof(address.sun_path) - 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd >= 0 && connect(fd, (struct sockaddr *) &address, sizeof(address)) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * This function generates a random request frame into the given buffer
+ * @return the length of the frame
+ */
+size_t generateRequest(char *frame, unsigned int *seed)
+{
+    char *text = frame + FRAME_HEADER_SIZE;
+    int len = snprintf(text, MAX_EXPRESSION_CHARS, "(%d+%d)*%d-%d/(%d+1)^%d", rand_r(seed) % 1000,
+                       rand_r(seed) % 1000, rand_r(seed) % 100, rand_r(seed) % 10000, rand_r(seed) % 50,
+                       rand_r(seed) % 3);
+    uint32_t header = htonl((uint32_t) len);
+    memcpy(frame, &header, FRAME_HEADER_SIZE);
+    return FRAME_HEADER_SIZE + (size_t) len;
+}
+
+/**
+ * The body of a client thread
+ */
+void *runClient(void *arg)
+{
+    Client *client = arg;
+    char frames[EXPRESSIONS_NUM][FRAME_HEADER_SIZE + MAX_EXPRESSION_CHARS];
+    size_t framesLen[EXPRESSIONS_NUM];
+    char response[MAX_RESPONSE_SIZE];
+    double *sentAt = malloc(client->requestsNum * sizeof(double));
+    size_t i, sentNum = 0, receivedNum = 0;
+    int fd = connectTo(client->socketPath);
+    if (fd < 0 || sentAt == NULL)
+    {
+        client->failed = 1;
+        client->receivedNum = 0;
+        free(sentAt);
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        return NULL;
+    }
+    for (i = 0; i < EXPRESSIONS_NUM; i++)
+    {
+        framesLen[i] = generateRequest(frames[i], &client->seed);
+    }
+
+    while (receivedNum < client->requestsNum && !client->failed)
+    {
+        while (sentNum < client->requestsNum && sentNum - receivedNum < client->depth)
+        {
+            sentAt[sentNum] = nowNs();
+            if (writeAll(fd, frames[sentNum % EXPRESSIONS_NUM], framesLen[sentNum % EXPRESSIONS_NUM]))
+            {
+                client->failed = 1;
+                break;
+            }
+            sentNum++;
+        }
+        uint32_t header;
+        if (client->failed || readAll(fd, (char *) &header, FRAME_HEADER_SIZE))
+        {
+            client->failed = 1;
+            break;
+        }
+        size_t len = ntohl(header);
+        if (len > sizeof(response) || readAll(fd, response, len))
+        {
+            client->failed = 1;
+            break;
+        }
+        client->latencies[receivedNum] = nowNs() - sentAt[receivedNum];
+        client->errorsNum += len >= strlen(ERROR_PREFIX) &&
+                             memcmp(response, ERROR_PREFIX, strlen(ERROR_PREFIX)) == 0;
+        receivedNum++;
+    }
+    client->receivedNum = receivedNum;
+    free(sentAt);
+    close(fd);
+    return NULL;
+}
+
+/**
+ * Compares two latencies for qsort
+ */
+int compareLatencies(const void *a, const void *b)
+{
+    double first = *(const double *) a, second = *(const double *) b;
+    return (first > second) - (first < second);
+}
+
+/**
+ * Runs the load generator and prints requests=, errors=, seconds=, requests_per_sec=, p50_us= and p99_us=
+ * @return EXIT_SUCCESS if every request was answered and EXIT_FAILURE otherwise
+ */
+int main(int argc, char **argv)
+{
+    size_t i, j, totalNum = 0, errorsNum = 0;
+    int failed = 0;
+    if (argc < 2 || argc > 5)
+    {
+        fprintf(stdout, "Usage: loadgen <socket> [connections] [requests per connection] [pipeline depth]\n");
+        return EXIT_FAILURE;
+    }
+    int clientsNum = argc > 2 ? atoi(argv[2]) : DEFAULT_CONNECTIONS;
+    long requestsNum = argc > 3 ? atol(argv[3]) : DEFAULT_REQUESTS;
+    long depth = argc > 4 ? atol(argv[4]) : DEFAULT_DEPTH;
+    if (clientsNum <= 0 || requestsNum <= 0 || depth <= 0)
+    {
+        fprintf(stderr, "Error: the connections, requests and depth must be positive\n");
+        return EXIT_FAILURE;
+    }
+
+    Client *clients = calloc((size_t) clientsNum, sizeof(Client));
+    double *latencies = malloc((size_t) clientsNum * (size_t) requestsNum * sizeof(double));
+    if (clients == NULL || latencies == NULL)
+    {
+        fprintf(stderr, "Error: out of memory\n");
+        free(clients);
+        free(latencies);
+        return EXIT_FAILURE;
+    }
+    double start = nowNs();
+    for (i = 0; i < (size_t) clientsNum; i++)
+    {
+        clients[i].socketPath = argv[1];
+        clients[i].requestsNum = (size_t) requestsNum;
+        clients[i].depth = (size_t) depth;
+        clients[i].seed = (unsigned int) i + 1;
+        clients[i].latencies = latencies + i * (size_t) requestsNum;
+        clients[i].started = pthread_create(&clients[i].thread, NULL, runClient, &clients[i]) == 0;
+        if (!clients[i].started)
+        {
+            clients[i].failed = 1;
+        }
+    }
+    for (i = 0; i < (size_t) clientsNum; i++)
+    {
+        if (clients[i].started)
+        {
+            pthread_join(clients[i].thread, NULL);
+        }
+    }
+    double seconds = (nowNs() - start) / 1e9;
+
+    // pack the measured latencies of every client together, a client that failed measured only what it received
+    for (i = 0; i < (size_t) clientsNum; i++)
+    {
+        for (j = 0; j < clients[i].receivedNum; j++)
+        {
+            latencies[totalNum++] = clients[i].latencies[j];
+        }
+        errorsNum += clients[i].errorsNum;
+        failed |= clients[i].failed;
+    }
+    qsort(latencies, totalNum, sizeof(double), compareLatencies);
+    printf("requests=%zu errors=%zu seconds=%.3f requests_per_sec=%.0f p50_us=%.2f p99_us=%.2f\n", totalNum,
+           errorsNum, seconds, totalNum / seconds, totalNum > 0 ? latencies[totalNum / 2] / 1000 : 0.0,
+           totalNum > 0 ? latencies[totalNum * 99 / 100] / 1000 : 0.0);
+    if (failed)
+    {
+        fprintf(stderr, "Error: some connections failed\n");
+    }
+    free(clients);
+    free(latencies);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,202 @@
+// ------------------------------ includes -----------------------------
+
+#include <stdlib.h>
+#include "inFix.h"
+#include "postFix.h"
+#include "optimizer.h"
+
+// -------------------------- const definitions -------------------------
+
+#define NO_CHILD (-1)
+
+// ------------------------------ structures -----------------------------
+
+/**
+ * A node of the expression tree, leaves have no children. Children always come before their parent.
+ */
+typedef struct
+{
+    MathObject object;
+    int left;
+    int right;
+} ExprNode;
+
+// ------------------------------ functions -----------------------------
+
+/**
+ * Finds if the given node is the constant with the given value
+ */
+int isConstant(const ExprNode *node, int value)
+{
+    return node->object.type == operand && node->object.value == value;
+}
+
+/**
+ * Finds if the given node is a leaf, a constant or a variable
+ */
+int isLeaf(const ExprNode *node)
+{
+    return node->left == NO_CHILD;
+}
+
+/**
+ * This function creates a multiplication node at the end of the nodes
+ * @return the index of the new node
+ */
+int appendProduct(ExprNode *nodes, int *nodesNum, int left, int right)
+{
+    ExprNode *node = &nodes[*nodesNum];
+    node->object.type = mul;
+    node->object.value = 0;
+    node->left = left;
+    node->right = right;
+    return (*nodesNum)++;
+}
+
+/**
+ * This function simplifies a single operator node whose children are already simplified. A node that simplifies
+ * to one of its children becomes a copy of that child.
+ */
+void simplifyNode(ExprNode *nodes, int *nodesNum, int i)
+{
+    ExprNode *node = &nodes[i];
+    const ExprNode *left = &nodes[node->left];
+    const ExprNode *right = &nodes[node->right];
+    char type = node->object.type;
+    int value;
+
+    // a constant division by 0 or INT_MIN / -1 is not folded, it fails when the expression is evaluated
+    if (left->object.type == operand && right->object.type == operand &&
+        getCheckedResult(right->object.value, left->object.value, type, &value) == EVAL_OK)
+    {
+        node->object.value = value;
+        node->object.type = operand;
+        node->left = node->right = NO_CHILD;
+    }
+    else if ((type == mul && isConstant(right, 1)) || (type == plus && isConstant(right, 0)) ||
+             (type == minus && isConstant(right, 0)) || (type == division && isConstant(right, 1)) ||
+             (type == power && isConstant(right, 1)))
+    {
+        *node = *left;
+    }
+    else if ((type == mul && isConstant(left, 1)) || (type == plus && isConstant(left, 0)))
+    {
+        *node = *right;
+    }
+    else if (type == power && right->object.type == operand && isLeaf(left) && right->object.value >= 0 &&
+             right->object.value <= MAX_REDUCED_EXPONENT)
+    {
+        int base = node->left;
+        switch (right->object.value)
+        {
+            case 0:
+                node->object.type = operand;
+                node->object.value = 1;
+                node->left = node->right = NO_CHILD;
+                break;
+            case 2:
+                node->object.type = mul;
+                node->right = base;
+                break;
+            case 3:
+                node->object.type = mul;
+                node->left = appendProduct(nodes, nodesNum, base, base);
+                node->right = base;
+                break;
+            default:
+                node->object.type = mul;
+                node->left = node->right = appendProduct(nodes, nodesNum, base, base);
+                break;
+        }
+    }
+}
+
+/**
+ * This function writes the subtree of the given node presented by postfix
+ * @param pending scratch stack, a negative entry -(i + 1) means the children of node i were already written
+ * @return the length of the written expression
+ */
+int emitPostfix(const ExprNode *nodes, int root, int *pending, MathObject *out)
+{
+    int top = 0, count = 0;
+    pending[top++] = root;
+    while (top > 0)
+    {
+        int entry = pending[--top];
+        if (entry < 0)
+        {
+            out[count++] = nodes[-entry - 1].object;
+        }
+        else if (isLeaf(&nodes[entry]))
+        {
+            out[count++] = nodes[entry].object;
+        }
+        else
+        {
+            pending[top++] = -entry - 1;
+            pending[top++] = nodes[entry].right;
+            pending[top++] = nodes[entry].left;
+        }
+    }
+    return count;
+}
+
+/**
+ * This function is given mathematical expression presented by postfix and simplifies it: constant subexpressions
+ * are folded, x*1, 1*x, x+0, 0+x, x-0, x/1 and x^1 are replaced by x, and a variable raised to a constant exponent
+ * of at most MAX_REDUCED_EXPONENT is replaced by multiplications. Divisions by a constant 0 are left for the
+ * evaluation to report.
+ * @param postfix mathematical expression presented by postfix
+ * @param len the length of the expression
+ * @param optimizedLen container for the length of the simplified expression
+ * @return the simplified expression presented by postfix or NULL if the expression is malformed or there is
+ * no memory
+ */
+MathObject *optimizePostfix(const MathObject *postfix, int len, int *optimizedLen)
+{
+    int i, depth = 0, nodesNum = len;
+    // every reduced power adds at most one node and turns three objects into at most seven
+    ExprNode *nodes = malloc((2 * (size_t) len + 1) * sizeof(ExprNode));
+    int *pending = malloc((3 * (size_t) len + 1) * sizeof(int));
+    MathObject *optimized = malloc((3 * (size_t) len + 1) * sizeof(MathObject));
+    if (len <= 0 || nodes == NULL || pending == NULL || optimized == NULL)
+    {
+        free(nodes);
+        free(pending);
+        free(optimized);
+        return NULL;
+    }
+
+    for (i = 0; i < len; i++)
+    {
+        nodes[i].object = postfix[i];
+        nodes[i].left = nodes[i].right = NO_CHILD;
+        if (postfix[i].type == operand || postfix[i].type == variable)
+        {
+            pending[depth++] = i;
+            continue;
+        }
+        if (depth < 2 || !(postfix[i].type == plus || postfix[i].type == minus || postfix[i].type == mul ||
+                           postfix[i].type == division || postfix[i].type == power))
+        {
+            depth = 0;
+            break;
+        }
+        nodes[i].right = pending[--depth];
+        nodes[i].left = pending[--depth];
+        pending[depth++] = i;
+        simplifyNode(nodes, &nodesNum, i);
+    }
+
+    if (depth != 1)
+    {
+        free(nodes);
+        free(pending);
+        free(optimized);
+        return NULL;
+    }
+    *optimizedLen = emitPostfix(nodes, len - 1, pending, optimized);
+    free(nodes);
+    free(pending);
+    return optimized;
+}
@@ -0,0 +1,30 @@
+#ifndef EX3_OPTIMIZER_H
+#define EX3_OPTIMIZER_H
+
+// ------------------------------ includes -----------------------------
+
+#include "inFix.h"
+
+// -------------------------- const definitions -------------------------
+
+/**
+ * The biggest constant exponent that is replaced by multiplications
+ */
+#define MAX_REDUCED_EXPONENT 4
+
+// ------------------------------ functions -----------------------------
+
+/**
+ * This function is given mathematical expression presented by postfix and simplifies it: constant subexpressions
+ * are folded, x*1, 1*x, x+0, 0+x, x-0, x/1 and x^1 are replaced by x, and a variable raised to a constant exponent
+ * of at most MAX_REDUCED_EXPONENT is replaced by multiplications. Divisions by a constant 0 are left for the
+ * evaluation to report.
+ * @param postfix mathematical expression presented by postfix
+ * @param len the length of the expression
+ * @param optimizedLen container for the length of the simplified expression
+ * @return the simplified expression presented by postfix or NULL if the expression is malformed or there is
+ * no memory
+ */
+MathObject *optimizePostfix(const MathObject *postfix, int len, int *optimizedLen);
+
+#endif
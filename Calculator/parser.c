@@ -0,0 +1,121 @@
+// ------------------------------ includes -----------------------------
+
+#include <limits.h>
+#include <stdio.h>
+#include "parser.h"
+
+// -------------------------- const definitions -------------------------
+
+#define END_OF_LINE '\n'
+#define EMPTY_STR '\0'
+
+// ------------------------------ functions -----------------------------
+
+/**
+ *Finds if the given char is operator
+ * @param type the type of the given char
+ * @return non-zero if true and false otherwise
+ */
+int isOperator(char type)
+{
+    return type == plus || type == minus || type == mul || type == division || type == power;
+}
+
+/**
+ * Finds if the given char can start the name of a variable
+ * @return non-zero if true and false otherwise
+ */
+int isVariableStart(char c)
+{
+    return ('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z') || c == '_';
+}
+
+/**
+ * This function parses a mathematical expression presented by infix into the given array in a single pass over its
+ * chars, without allocating. Numbers are accumulated digit by digit, a minus that starts the expression or follows an
+ * operator or a left parenthesis and is followed by a number negates the number, and any other char is skipped.
+ * @param buffer the expression, ends with a new line, with the end of the string or after len chars
+ * @param len the maximal number of chars to parse
+ * @param inPut container for the objects of the expression, must hold at least len objects
+ * @param parenthesisNum container for the number of parenthesis in the expression
+ * @param table the table whose columns the variables of the expression refer to, NULL if variables are not allowed
+ * @param literals non zero to keep the numbers that are not valid ints as literal objects, for the arithmetics that
+ * are wider than int
+ * @return the number of objects in the expression, PARSE_UNKNOWN_VARIABLE if it refers to an unknown variable
+ * or PARSE_OVERFLOW if one of its numbers is not a valid int and literals is 0
+ */
+int parseLine(const char *buffer, size_t len, MathObject *inPut, int *parenthesisNum, const Table *table,
+              int literals)
+{
+    const char *curr = buffer;
+    const char *end = buffer + len;
+    MathObject *token = inPut;
+    int counterPars = 0;
+    int expectOperand = 1;
+    int negative = 0;
+
+    while (curr < end && *curr != END_OF_LINE && *curr != EMPTY_STR)
+    {
+        char currType = *curr;
+        if ('0' <= currType && currType <= '9')
+        {
+            // the magnitude may reach INT_MAX + 1 only for a negative number, whose minus is right before it
+            unsigned int limit = (unsigned int) INT_MAX + (unsigned int) negative;
+            unsigned int magnitude = 0;
+            int offset = (int) (curr - buffer) - negative;
+            int tooLarge = 0;
+            while (curr < end && '0' <= *curr && *curr <= '9')
+            {
+                unsigned int digit = (unsigned int) (*curr++ - '0');
+                tooLarge |= magnitude > (limit - digit) / 10;
+                magnitude = magnitude * 10 + digit;
+            }
+            if (tooLarge && !literals)
+            {
+                return PARSE_OVERFLOW;
+            }
+            token->value = tooLarge ? offset : negative ? (int) (0u - magnitude) : (int) magnitude;
+            token->type = tooLarge ? literal : operand;
+            token++;
+            negative = 0;
+            expectOperand = 0;
+        }
+        else if (table != NULL && isVariableStart(currType))
+        {
+            const char *name = curr;
+            while (curr < end && (isVariableStart(*curr) || ('0' <= *curr && *curr <= '9')))
+            {
+                curr++;
+            }
+            token->value = findColumn(table, name, (size_t) (curr - name));
+            token->type = variable;
+            if (token->value < 0)
+            {
+                fprintf(stderr, "Error: unknown variable %.*s\n", (int) (curr - name), name);
+                return PARSE_UNKNOWN_VARIABLE;
+            }
+            token++;
+            expectOperand = 0;
+        }
+        else if (currType == minus && expectOperand && !negative && curr + 1 < end && '0' <= curr[1] &&
+                 curr[1] <= '9')
+        {
+            negative = 1;
+            curr++;
+        }
+        else if (isOperator(currType) || currType == lPar || currType == rPar)
+        {
+            token->type = currType;
+            token++;
+            counterPars += currType == lPar || currType == rPar;
+            expectOperand = currType != rPar;
+            curr++;
+        }
+        else
+        {
+            curr++;
+        }
+    }
+    *parenthesisNum = counterPars;
+    return (int) (token - inPut);
+}
@@ -0,0 +1,48 @@
+#ifndef EX3_PARSER_H
+#define EX3_PARSER_H
+
+// ------------------------------ includes -----------------------------
+
+#include <stdlib.h>
+#include "inFix.h"
+#include "columns.h"
+
+// -------------------------- const definitions -------------------------
+
+#define PARSE_UNKNOWN_VARIABLE (-1)
+
+#define PARSE_OVERFLOW (-2)
+
+// ------------------------------ functions -----------------------------
+
+/**
+ *Finds if the given char is operator
+ * @param type the type of the given char
+ * @return non-zero if true and false otherwise
+ */
+int isOperator(char type);
+
+/**
+ * Finds if the given char can start the name of a variable
+ * @return non-zero if true and false otherwise
+ */
+int isVariableStart(char c);
+
+/**
+ * This function parses a mathematical expression presented by infix into the given array in a single pass over its
+ * chars, without allocating. Numbers are accumulated digit by digit, a minus that starts the expression or follows an
+ * operator or a left parenthesis and is followed by a number negates the number, and any other char is skipped.
+ * @param buffer the expression, ends with a new line, with the end of the string or after len chars
+ * @param len the maximal number of chars to parse
+ * @param inPut container for the objects of the expression, must hold at least len objects
+ * @param parenthesisNum container for the number of parenthesis in the expression
+ * @param table the table whose columns the variables of the expression refer to, NULL if variables are not allowed
+ * @param literals non zero to keep the numbers that are not valid ints as literal objects, for the arithmetics that
+ * are wider than int
+ * @return the number of objects in the expression, PARSE_UNKNOWN_VARIABLE if it refers to an unknown variable
+ * or PARSE_OVERFLOW if one of its numbers is not a valid int and literals is 0
+ */
+int parseLine(const char *buffer, size_t len, MathObject *inPut, int *parenthesisNum, const Table *table,
+              int literals);
+
+#endif
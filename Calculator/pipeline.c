@@ -0,0 +1,412 @@
+// ------------------------------ includes -----------------------------
+
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "batch.h"
+#include "pipeline.h"
+
+// -------------------------- const definitions -------------------------
+
+#define JOB_SIZE (256 * 1024)
+
+#define SLOTS_PER_WORKER 4
+
+#define END_OF_LINE '\n'
+
+// ------------------------------ enum -----------------------------
+
+/**
+ * The state of a slot of the pipeline
+ */
+typedef enum
+{
+    SLOT_FREE,
+    SLOT_READ,
+    SLOT_DONE
+} SlotState;
+
+// ------------------------------ structures -----------------------------
+
+/**
+ * A batch of whole lines and, once evaluated, their output
+ */
+typedef struct
+{
+    const char *data;
+    size_t len;
+    int ownsData;
+    char *output;
+    size_t outputLen;
+    int failures;
+    SlotState state;
+} Job;
+
+/**
+ * The shared state of the reader, the workers and the writer. Job i lives in slots[i % slotsNum].
+ */
+typedef struct
+{
+    Job *slots;
+    size_t slotsNum;
+    size_t readNum;
+    size_t takenNum;
+    size_t writtenNum;
+    int readDone;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+
+    FILE *file;
+    char *carry;
+    size_t carryLen;
+    const char *map;
+    size_t mapSize;
+    size_t mapOffset;
+} Pipeline;
+
+/**
+ * A worker thread and its own buffers
+ */
+typedef struct
+{
+    Pipeline *pipeline;
+    Batch batch;
+    pthread_t thread;
+} Worker;
+
+// ------------------------------ functions -----------------------------
+
+/**
+ * This function cuts the next job out of the memory mapped input, jobs end right after a new line
+ * @return 0 if the input is exhausted and non zero otherwise
+ */
+int nextMappedJob(Pipeline *pipeline, Job *job)
+{
+    size_t start = pipeline->mapOffset;
+    size_t end = start + JOB_SIZE;
+    if (start >= pipeline->mapSize)
+    {
+        return 0;
+    }
+    if (end >= pipeline->mapSize)
+    {
+        end = pipeline->mapSize;
+    }
+    else
+    {
+        const char *newLine = memchr(pipeline->map + end, END_OF_LINE, pipeline->mapSize - end);
+        end = newLine == NULL ? pipeline->mapSize : (size_t) (newLine - pipeline->map) + 1;
+    }
+    job->data = pipeline->map + start;
+    job->len = end - start;
+    job->ownsData = 0;
+    pipeline->mapOffset = end;
+    return 1;
+}
+
+/**
+ * This function reads the next job from the input stream, the partial line at the end of a read is carried to
+ * the next job and a line that is longer than a job grows the job
+ * @return 0 if the input is exhausted and non zero otherwise
+ */
+int nextStreamJob(Pipeline *pipeline, Job *job)
+{
+    size_t capacity = JOB_SIZE + pipeline->carryLen;
+    size_t len = pipeline->carryLen, readNum;
+    char *data = malloc(capacity);
+    if (data == NULL)
+    {
+        return 0;
+    }
+    memcpy(data, pipeline->carry, pipeline->carryLen);
+    pipeline->carryLen = 0;
+    for (;;)
+    {
+        readNum = fread(data + len, 1, capacity - len, pipeline->file);
+        len += readNum;
+        if (readNum == 0)
+        {
+            break;
+        }
+        char *lastLine = memrchr(data, END_OF_LINE, len);
+        if (lastLine != NULL)
+        {
+            size_t carryLen = len - (size_t) (lastLine + 1 - data);
+            char *carry = realloc(pipeline->carry, carryLen + 1);
+            if (carry == NULL)
+            {
+                break;
+            }
+            memcpy(carry, lastLine + 1, carryLen);
+            pipeline->carry = carry;
+            pipeline->carryLen = carryLen;
+            len -= carryLen;
+            break;
+        }
+        if (len == capacity)
+        {
+            char *grown = realloc(data, 2 * capacity);
+            if (grown == NULL)
+            {
+                break;
+            }
+            data = grown;
+            capacity *= 2;
+        }
+    }
+    if (len == 0)
+    {
+        free(data);
+        return 0;
+    }
+    job->data = data;
+    job->len = len;
+    job->ownsData = 1;
+    return 1;
+}
+
+/**
+ * The reader thread, splits the input into jobs and hands them to the workers
+ */
+void *readJobs(void *arg)
+{
+    Pipeline *pipeline = (Pipeline *) arg;
+    Job job;
+    while (pipeline->map != NULL ? nextMappedJob(pipeline, &job) : nextStreamJob(pipeline, &job))
+    {
+        pthread_mutex_lock(&pipeline->lock);
+        while (pipeline->readNum - pipeline->writtenNum == pipeline->slotsNum)
+        {
+            pthread_cond_wait(&pipeline->changed, &pipeline->lock);
+        }
+        job.state = SLOT_READ;
+        pipeline->slots[pipeline->readNum % pipeline->slotsNum] = job;
+        pipeline->readNum++;
+        pthread_cond_broadcast(&pipeline->changed);
+        pthread_mutex_unlock(&pipeline->lock);
+    }
+    pthread_mutex_lock(&pipeline->lock);
+    pipeline->readDone = 1;
+    pthread_cond_broadcast(&pipeline->changed);
+    pthread_mutex_unlock(&pipeline->lock);
+    return NULL;
+}
+
+/**
+ * A worker thread, evaluates jobs with its own batch until the input is exhausted
+ */
+void *evaluateJobs(void *arg)
+{
+    Worker *worker = (Worker *) arg;
+    Pipeline *pipeline = worker->pipeline;
+    Batch *batch = &worker->batch;
+    pthread_mutex_lock(&pipeline->lock);
+    for (;;)
+    {
+        while (pipeline->takenNum == pipeline->readNum && !pipeline->readDone)
+        {
+            pthread_cond_wait(&pipeline->changed, &pipeline->lock);
+        }
+        if (pipeline->takenNum == pipeline->readNum)
+        {
+            break;
+        }
+        Job *job = &pipeline->slots[pipeline->takenNum % pipeline->slotsNum];
+        pipeline->takenNum++;
+        pthread_mutex_unlock(&pipeline->lock);
+
+        batch->outputLen = 0;
+        batch->failures = 0;
+        evaluateData(batch, job->data, job->len);
+        job->output = malloc(batch->outputLen + 1);
+        if (job->output != NULL)
+        {
+            memcpy(job->output, batch->output, batch->outputLen);
+            job->outputLen = batch->outputLen;
+            job->failures = batch->failures;
+        }
+        else
+        {
+            job->outputLen = 0;
+            job->failures = 1;
+        }
+
+        pthread_mutex_lock(&pipeline->lock);
+        job->state = SLOT_DONE;
+        pthread_cond_broadcast(&pipeline->changed);
+    }
+    pthread_mutex_unlock(&pipeline->lock);
+    return NULL;
+}
+
+/**
+ * The writer, prints the output of the jobs in the order they were read
+ * @return the number of lines that failed
+ */
+int writeJobs(Pipeline *pipeline)
+{
+    int failures = 0;
+    pthread_mutex_lock(&pipeline->lock);
+    for (;;)
+    {
+        Job *job = &pipeline->slots[pipeline->writtenNum % pipeline->slotsNum];
+        while ((pipeline->writtenNum == pipeline->readNum && !pipeline->readDone) ||
+               (pipeline->writtenNum < pipeline->readNum && job->state != SLOT_DONE))
+        {
+            pthread_cond_wait(&pipeline->changed, &pipeline->lock);
+        }
+        if (pipeline->writtenNum == pipeline->readNum)
+        {
+            break;
+        }
+        pthread_mutex_unlock(&pipeline->lock);
+
+        fwrite(job->output, 1, job->outputLen, stdout);
+        failures += job->failures;
+        free(job->output);
+        if (job->ownsData)
+        {
+            free((char *) job->data);
+        }
+
+        pthread_mutex_lock(&pipeline->lock);
+        job->state = SLOT_FREE;
+        pipeline->writtenNum++;
+        pthread_cond_broadcast(&pipeline->changed);
+    }
+    pthread_mutex_unlock(&pipeline->lock);
+    return failures;
+}
+
+/**
+ * This function opens the input of the pipeline, a file is memory mapped
+ * @return 0 in success and non zero otherwise
+ */
+int openInput(Pipeline *pipeline, const char *fileName)
+{
+    struct stat info;
+    if (fileName == NULL)
+    {
+        pipeline->file = stdin;
+        return 0;
+    }
+    int fd = open(fileName, O_RDONLY);
+    if (fd < 0 || fstat(fd, &info) != 0)
+    {
+        fprintf(stderr, "Error opening file: %s\n", fileName);
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        return 1;
+    }
+    pipeline->mapSize = (size_t) info.st_size;
+    if (pipeline->mapSize > 0)
+    {
+        pipeline->map = mmap(NULL, pipeline->mapSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (pipeline->map == MAP_FAILED)
+        {
+            pipeline->map = NULL;
+            pipeline->file = fdopen(fd, "r");
+            return pipeline->file == NULL;
+        }
+    }
+    else
+    {
+        pipeline->file = fdopen(fd, "r");
+        return pipeline->file == NULL;
+    }
+    close(fd);
+    return 0;
+}
+
+/**
+ * This function evaluates every line of the given file, or of the standard input if no file is given, like
+ * runBatch but on several threads: a reader thread splits the input into batches of lines, a pool of workers
+ * evaluates the batches and the calling thread writes their output in the original order.
+ * @param fileName the name of the file or NULL for the standard input
+ * @param workersNum the number of worker threads
+ * @param arithmetic the arithmetic the lines are evaluated with
+ * @return EXIT_SUCCESS if every line was evaluated and EXIT_FAILURE otherwise
+ */
+int runPipeline(const char *fileName, int workersNum, Arithmetic arithmetic)
+{
+    int i, failures, startedNum = 0;
+    pthread_t reader;
+    Pipeline pipeline;
+    memset(&pipeline, 0, sizeof(Pipeline));
+    if (openInput(&pipeline, fileName))
+    {
+        return EXIT_FAILURE;
+    }
+    pipeline.slotsNum = (size_t) workersNum * SLOTS_PER_WORKER;
+    pipeline.slots = calloc(pipeline.slotsNum, sizeof(Job));
+    Worker *workers = calloc((size_t) workersNum, sizeof(Worker));
+    int failed = pipeline.slots == NULL || workers == NULL;
+    for (i = 0; !failed && i < workersNum; i++)
+    {
+        workers[i].pipeline = &pipeline;
+        failed = initBatch(&workers[i].batch, NULL, arithmetic);
+    }
+    if (failed)
+    {
+        fprintf(stderr, "Error: out of memory\n");
+    }
+    else
+    {
+        pthread_mutex_init(&pipeline.lock, NULL);
+        pthread_cond_init(&pipeline.changed, NULL);
+        for (startedNum = 0; startedNum < workersNum; startedNum++)
+        {
+            if (pthread_create(&workers[startedNum].thread, NULL, evaluateJobs, &workers[startedNum]) != 0)
+            {
+                break;
+            }
+        }
+        if (startedNum > 0 && pthread_create(&reader, NULL, readJobs, &pipeline) == 0)
+        {
+            failures = writeJobs(&pipeline);
+            pthread_join(reader, NULL);
+        }
+        else
+        {
+            fprintf(stderr, "Error: can't start the pipeline threads\n");
+            failures = 1;
+            pthread_mutex_lock(&pipeline.lock);
+            pipeline.readDone = 1;
+            pthread_cond_broadcast(&pipeline.changed);
+            pthread_mutex_unlock(&pipeline.lock);
+        }
+        failed = failures != 0;
+        for (i = 0; i < startedNum; i++)
+        {
+            pthread_join(workers[i].thread, NULL);
+        }
+        pthread_mutex_destroy(&pipeline.lock);
+        pthread_cond_destroy(&pipeline.changed);
+    }
+    fflush(stdout);
+    for (i = 0; workers != NULL && i < workersNum; i++)
+    {
+        freeBatch(&workers[i].batch);
+    }
+    free(workers);
+    free(pipeline.slots);
+    free(pipeline.carry);
+    if (pipeline.map != NULL)
+    {
+        munmap((void *) pipeline.map, pipeline.mapSize);
+    }
+    if (pipeline.file != NULL && pipeline.file != stdin)
+    {
+        fclose(pipeline.file);
+    }
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,21 @@
+#ifndef EX3_PIPELINE_H
+#define EX3_PIPELINE_H
+
+// ------------------------------ includes -----------------------------
+
+#include "batch.h"
+
+// ------------------------------ functions -----------------------------
+
+/**
+ * This function evaluates every line of the given file, or of the standard input if no file is given, like
+ * runBatch but on several threads: a reader thread splits the input into batches of lines, a pool of workers
+ * evaluates the batches and the calling thread writes their output in the original order.
+ * @param fileName the name of the file or NULL for the standard input
+ * @param workersNum the number of worker threads
+ * @param arithmetic the arithmetic the lines are evaluated with
+ * @return EXIT_SUCCESS if every line was evaluated and EXIT_FAILURE otherwise
+ */
+int runPipeline(const char *fileName, int workersNum, Arithmetic arithmetic);
+
+#endif
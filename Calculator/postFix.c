@@ -1,12 +1,14 @@
 
 // ------------------------------ includes -----------------------------
 
+#include <limits.h>
 #include <math.h>
 #include <stdio.h>
 #include <memory.h>
 #include "stack.h"
 #include <assert.h>
 #include "inFix.h"
+#include "postFix.h"
 
 
 // ------------------------------ functions -----------------------------
@@ -45,44 +47,292 @@ int getResult(int operand1, int operand2, char operator)
 }
 
 /**
-* This function is given mathematical expression presented by postfix, evaluates it and returns the value
+ * Finds if the given type is a binary operator
+ */
+int isBinaryOperator(char type)
+{
+    return type == plus || type == minus || type == mul || type == division || type == power;
+}
+
+/**
+ * This function is given two operands and an operator and evaluates the expression operand2 operator operand1 like
+ * getResult, but fails instead of exiting or trapping
+ * @param operand1 the right operand
+ * @param operand2 the left operand
+ * @param operator an operator
+ * @param result container for the result of the expression
+ * @return EVAL_OK in success, EVAL_DIV_BY_ZERO for a division by 0, EVAL_OVERFLOW for INT_MIN / -1 and
+ * EVAL_MALFORMED if the operator is not a binary operator
+ */
+EvalStatus getCheckedResult(int operand1, int operand2, char operator, int *result)
+{
+    if (!isBinaryOperator(operator))
+    {
+        return EVAL_MALFORMED;
+    }
+    if (operator == division && operand1 == 0)
+    {
+        return EVAL_DIV_BY_ZERO;
+    }
+    if (operator == division && operand2 == INT_MIN && operand1 == -1)
+    {
+        return EVAL_OVERFLOW;
+    }
+    *result = getResult(operand1, operand2, operator);
+    return EVAL_OK;
+}
+
+/**
+* This function is given mathematical expression presented by postfix and evaluates it without exiting the
+* program on failure, it is safe to call from several threads with different stacks
 * @param postfix mathematical expression presented by postfix
 * @param len the length of the expression
-* @return The value pf the expression
+* @param stack a reusable stack of ints for the operands
+* @param result container for the value of the expression
+* @return EVAL_OK in success and the reason of the failure otherwise
 */
-int calculatePostfix(MathObject *postfix, int len)
+EvalStatus evaluatePostfix(const MathObject *postfix, int len, Stack *stack, int *result)
 {
-    if (len == 0)
-    {
-        fprintf(stderr, "Can't evaluate expression\n");
-        exit(EXIT_FAILURE);
-    }
     int i;
     char currType = 0;
-    int result, operand1, operand2, currValue;
-    operand1 = operand2 = 0;
-    Stack *stack = stackAlloc(sizeof(int));
+    int operand1, operand2, currValue;
+    EvalStatus status;
+    clearStack(stack);
 
     for (i = 0; i < len; i++)
     {
-        result = 0;
         currType = postfix[i].type;
         currValue = postfix[i].value;
         if (currType == operand)
         {
-            push(stack, &currValue);
+            if (push(stack, &currValue) != 0)
+            {
+                return EVAL_NO_MEMORY;
+            }
+            continue;
+        }
+        if (!isBinaryOperator(currType) || isEmptyStack(stack))
+        {
+            return EVAL_MALFORMED;
+        }
+        pop(stack, &operand1);
+        if (isEmptyStack(stack))
+        {
+            return EVAL_MALFORMED;
+        }
+        pop(stack, &operand2);
+        status = getCheckedResult(operand1, operand2, currType, &currValue);
+        if (status != EVAL_OK)
+        {
+            return status;
+        }
+        if (push(stack, &currValue) != 0)
+        {
+            return EVAL_NO_MEMORY;
+        }
+    }
+    if (isEmptyStack(stack))
+    {
+        return EVAL_MALFORMED;
+    }
+    pop(stack, result);
+    return isEmptyStack(stack) ? EVAL_OK : EVAL_MALFORMED;
+}
+
+/**
+ * This function raises base to the power of exponent by squaring, in 64 bits with overflow checks. A negative
+ * exponent truncates the result towards 0 like an integer division.
+ * @param base the base
+ * @param exponent the exponent
+ * @param result container for the power
+ * @return EVAL_OK in success, EVAL_OVERFLOW if the power doesn't fit in 64 bits and EVAL_DIV_BY_ZERO for 0 raised to
+ * a negative exponent
+ */
+EvalStatus getPower64(long long base, long long exponent, long long *result)
+{
+    long long power = 1;
+    if (exponent < 0)
+    {
+        if (base == 0)
+        {
+            return EVAL_DIV_BY_ZERO;
+        }
+        *result = base == 1 ? 1 : base == -1 ? (exponent % 2 == 0 ? 1 : -1) : 0;
+        return EVAL_OK;
+    }
+    while (exponent > 0)
+    {
+        if ((exponent & 1) && __builtin_mul_overflow(power, base, &power))
+        {
+            return EVAL_OVERFLOW;
+        }
+        exponent >>= 1;
+        if (exponent > 0 && __builtin_mul_overflow(base, base, &base))
+        {
+            return EVAL_OVERFLOW;
+        }
+    }
+    *result = power;
+    return EVAL_OK;
+}
+
+/**
+ * This function is given two operands and an operator and evaluates the expression operand2 operator operand1 in
+ * 64 bits with overflow checks
+ * @param operand1 the right operand
+ * @param operand2 the left operand
+ * @param operator an operator
+ * @param result container for the result of the expression
+ * @return EVAL_OK in success and the reason of the failure otherwise
+ */
+EvalStatus getResult64(long long operand1, long long operand2, char operator, long long *result)
+{
+    switch (operator)
+    {
+        case plus:
+            return __builtin_add_overflow(operand2, operand1, result) ? EVAL_OVERFLOW : EVAL_OK;
+        case minus:
+            return __builtin_sub_overflow(operand2, operand1, result) ? EVAL_OVERFLOW : EVAL_OK;
+        case mul:
+            return __builtin_mul_overflow(operand2, operand1, result) ? EVAL_OVERFLOW : EVAL_OK;
+        case division:
+            if (operand1 == 0)
+            {
+                return EVAL_DIV_BY_ZERO;
+            }
+            if (operand2 == LLONG_MIN && operand1 == -1)
+            {
+                return EVAL_OVERFLOW;
+            }
+            *result = operand2 / operand1;
+            return EVAL_OK;
+        case power:
+            return getPower64(operand2, operand1, result);
+        default:
+            return EVAL_MALFORMED;
+    }
+}
+
+/**
+* This function reads a decimal number, with an optional minus, in 64 bits
+* @param text the number
+* @param len the number of chars the number may span, it ends at the first char that is not a digit
+* @param result container for the number
+* @return EVAL_OK in success and EVAL_OVERFLOW if the number doesn't fit in 64 bits
+*/
+EvalStatus getLiteral64(const char *text, size_t len, long long *result)
+{
+    const char *end = text + len;
+    int negative = text < end && *text == minus;
+    // the magnitude may reach LLONG_MAX + 1 only for a negative number
+    unsigned long long limit = (unsigned long long) LLONG_MAX + (unsigned long long) negative;
+    unsigned long long magnitude = 0;
+    text += negative;
+    while (text < end && '0' <= *text && *text <= '9')
+    {
+        unsigned long long digit = (unsigned long long) (*text++ - '0');
+        if (magnitude > (limit - digit) / 10)
+        {
+            return EVAL_OVERFLOW;
         }
-        else
+        magnitude = magnitude * 10 + digit;
+    }
+    *result = negative ? (long long) (0ull - magnitude) : (long long) magnitude;
+    return EVAL_OK;
+}
+
+/**
+* This function is given mathematical expression presented by postfix and evaluates it in 64 bits, an expression
+* whose value or any intermediate value doesn't fit in 64 bits fails with EVAL_OVERFLOW
+* @param postfix mathematical expression presented by postfix
+* @param len the length of the expression
+* @param stack a reusable stack of long longs for the operands
+* @param text the text the expression was parsed from, its literals are read from it, NULL if it has no literals
+* @param textLen the length of the text
+* @param result container for the value of the expression
+* @return EVAL_OK in success and the reason of the failure otherwise
+*/
+EvalStatus evaluatePostfix64(const MathObject *postfix, int len, Stack *stack, const char *text, size_t textLen,
+                             long long *result)
+{
+    int i;
+    long long operand1, operand2, currValue;
+    EvalStatus status;
+    clearStack(stack);
+
+    for (i = 0; i < len; i++)
+    {
+        if (postfix[i].type == operand || postfix[i].type == literal)
         {
-            assert(!isEmptyStack(stack));
-            pop(stack, &operand1);
-            assert(!isEmptyStack(stack));
-            pop(stack, &operand2);
-            result = getResult(operand1, operand2, currType);
-            push(stack, &result);
+            currValue = postfix[i].value;
+            if (postfix[i].type == literal)
+            {
+                status = getLiteral64(text + currValue, textLen - (size_t) currValue, &currValue);
+                if (status != EVAL_OK)
+                {
+                    return status;
+                }
+            }
+            if (push(stack, &currValue) != 0)
+            {
+                return EVAL_NO_MEMORY;
+            }
+            continue;
+        }
+        if (isEmptyStack(stack))
+        {
+            return EVAL_MALFORMED;
+        }
+        pop(stack, &operand1);
+        if (isEmptyStack(stack))
+        {
+            return EVAL_MALFORMED;
+        }
+        pop(stack, &operand2);
+        status = getResult64(operand1, operand2, postfix[i].type, &currValue);
+        if (status != EVAL_OK)
+        {
+            return status;
+        }
+        if (push(stack, &currValue) != 0)
+        {
+            return EVAL_NO_MEMORY;
         }
     }
-    pop(stack, &result);
+    if (isEmptyStack(stack))
+    {
+        return EVAL_MALFORMED;
+    }
+    pop(stack, result);
+    return isEmptyStack(stack) ? EVAL_OK : EVAL_MALFORMED;
+}
+
+/**
+* This function is given mathematical expression presented by postfix, evaluates it and returns the value
+* @param postfix mathematical expression presented by postfix
+* @param len the length of the expression
+* @return The value pf the expression
+*/
+int calculatePostfix(MathObject *postfix, int len)
+{
+    int result = 0;
+    Stack *stack = stackAlloc(sizeof(int));
+    EvalStatus status = stack == NULL ? EVAL_NO_MEMORY : evaluatePostfix(postfix, len, stack, &result);
     freeStack(&stack);
+    if (status == EVAL_DIV_BY_ZERO)
+    {
+        fprintf(stderr, "Division by 0!");
+        exit(EXIT_FAILURE);
+    }
+    if (status == EVAL_OVERFLOW)
+    {
+        fprintf(stderr, "Overflow!");
+        exit(EXIT_FAILURE);
+    }
+    if (status != EVAL_OK)
+    {
+        fprintf(stderr, "Can't evaluate expression\n");
+        exit(EXIT_FAILURE);
+    }
     return result;
 }
@@ -9,8 +9,100 @@
 #include <errno.h>
 #include "stack.h"
 #include "inFix.h"
+
+// ------------------------------ enum -----------------------------
+
+/**
+ * The status of an evaluation
+ */
+typedef enum
+{
+    EVAL_OK = 0,
+    EVAL_DIV_BY_ZERO,
+    EVAL_NO_MEMORY,
+    EVAL_MALFORMED,
+    EVAL_OVERFLOW
+} EvalStatus;
+
 // ------------------------------ functions -----------------------------
 
+/**
+ * This function is given two operands and an operator and evaluates the expression operand2 operator operand1
+ * @param operand1 the right operand
+ * @param operand2 the left operand
+ * @param operator an operator, a division must not be by 0
+ * @return the result of the expression
+ */
+int getResult(int operand1, int operand2, char operator);
+
+/**
+ * This function is given two operands and an operator and evaluates the expression operand2 operator operand1 like
+ * getResult, but fails instead of exiting or trapping
+ * @param operand1 the right operand
+ * @param operand2 the left operand
+ * @param operator an operator
+ * @param result container for the result of the expression
+ * @return EVAL_OK in success, EVAL_DIV_BY_ZERO for a division by 0, EVAL_OVERFLOW for INT_MIN / -1 and
+ * EVAL_MALFORMED if the operator is not a binary operator
+ */
+EvalStatus getCheckedResult(int operand1, int operand2, char operator, int *result);
+
+/**
+ * This function raises base to the power of exponent by squaring, in 64 bits with overflow checks. A negative
+ * exponent truncates the result towards 0 like an integer division.
+ * @param base the base
+ * @param exponent the exponent
+ * @param result container for the power
+ * @return EVAL_OK in success, EVAL_OVERFLOW if the power doesn't fit in 64 bits and EVAL_DIV_BY_ZERO for 0 raised to
+ * a negative exponent
+ */
+EvalStatus getPower64(long long base, long long exponent, long long *result);
+
+/**
+ * This function is given two operands and an operator and evaluates the expression operand2 operator operand1 in
+ * 64 bits with overflow checks
+ * @param operand1 the right operand
+ * @param operand2 the left operand
+ * @param operator an operator
+ * @param result container for the result of the expression
+ * @return EVAL_OK in success and the reason of the failure otherwise
+ */
+EvalStatus getResult64(long long operand1, long long operand2, char operator, long long *result);
+
+/**
+ * This function reads a decimal number, with an optional minus, in 64 bits
+ * @param text the number
+ * @param len the number of chars the number may span, it ends at the first char that is not a digit
+ * @param result container for the number
+ * @return EVAL_OK in success and EVAL_OVERFLOW if the number doesn't fit in 64 bits
+ */
+EvalStatus getLiteral64(const char *text, size_t len, long long *result);
+
+/**
+ * This function is given mathematical expression presented by postfix and evaluates it in 64 bits, an expression
+ * whose value or any intermediate value doesn't fit in 64 bits fails with EVAL_OVERFLOW
+ * @param postfix mathematical expression presented by postfix
+ * @param len the length of the expression
+ * @param stack a reusable stack of long longs for the operands
+ * @param text the text the expression was parsed from, its literals are read from it, NULL if it has no literals
+ * @param textLen the length of the text
+ * @param result container for the value of the expression
+ * @return EVAL_OK in success and the reason of the failure otherwise
+ */
+EvalStatus evaluatePostfix64(const MathObject *postfix, int len, Stack *stack, const char *text, size_t textLen,
+                             long long *result);
+
+/**
+ * This function is given mathematical expression presented by postfix and evaluates it without exiting the
+ * program on failure, it is safe to call from several threads with different stacks
+ * @param postfix mathematical expression presented by postfix
+ * @param len the length of the expression
+ * @param stack a reusable stack of ints for the operands
+ * @param result container for the value of the expression
+ * @return EVAL_OK in success and the reason of the failure otherwise
+ */
+EvalStatus evaluatePostfix(const MathObject *postfix, int len, Stack *stack, int *result);
+
 /**
  * This function is given mathematical expression presented by postfix, evaluates it and returns the value
  * @param postfix mathematical expression presented by postfix
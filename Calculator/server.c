@@ -0,0 +1,766 @@
+// ------------------------------ includes -----------------------------
+
+#define _GNU_SOURCE
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "calc.h"
+#include "server.h"
+
+// -------------------------- const definitions -------------------------
+
+#define READ_SIZE (64 * 1024)
+
+#define MAX_BUFFERED (16 * 1024 * 1024)
+
+#define MAX_EVENTS 64
+
+#define LISTEN_BACKLOG 128
+
+#define MAX_RESPONSE_CHARS 64
+
+#define ERROR_PREFIX "error: "
+
+// ------------------------------ structures -----------------------------
+
+/**
+ * A client of the server. While a task of the connection is evaluated (busy) no other task of it is created, and no
+ * task is created while its output is not sent, so the responses keep the order of the requests. A client that has
+ * shut down its sending side (halfClosed) still gets the responses to its complete requests before it is closed.
+ */
+typedef struct Connection
+{
+    int fd;
+    uint32_t events;
+    char *input;
+    size_t inputLen;
+    size_t inputCapacity;
+    char *output;
+    size_t outputLen;
+    size_t outputSent;
+    int busy;
+    int halfClosed;
+    int closed;
+    int buried;
+    struct Connection *prev;
+    struct Connection *next;
+} Connection;
+
+/**
+ * The complete request frames of a connection and, once evaluated, their response frames
+ */
+typedef struct Task
+{
+    Connection *connection;
+    char *requests;
+    size_t requestsLen;
+    char *responses;
+    size_t responsesLen;
+    size_t responsesCapacity;
+    int failed;
+    struct Task *next;
+} Task;
+
+/**
+ * The state of the event loop and the queues it shares with the workers. The event loop wakes up when a worker
+ * writes to eventFd.
+ */
+typedef struct
+{
+    int listenFd;
+    int eventFd;
+    int signalFd;
+    int epollFd;
+    Connection *connections;
+    Connection *dead;
+
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+    Task *pendingHead;
+    Task *pendingTail;
+    Task *done;
+    int stopping;
+} Server;
+
+/**
+ * A worker thread and its own evaluation context
+ */
+typedef struct
+{
+    Server *server;
+    CalcContext *context;
+    pthread_t thread;
+} ServerWorker;
+
+// ------------------------------ functions -----------------------------
+
+/**
+ * @return the payload length in the header of a frame
+ */
+size_t readFrameHeader(const char *header)
+{
+    uint32_t len;
+    memcpy(&len, header, FRAME_HEADER_SIZE);
+    return ntohl(len);
+}
+
+/**
+ * This function appends a response frame to the responses of a task
+ */
+void appendResponse(Task *task, const char *payload, size_t len)
+{
+    uint32_t header = htonl((uint32_t) len);
+    size_t needed = task->responsesLen + FRAME_HEADER_SIZE + len;
+    if (needed > task->responsesCapacity)
+    {
+        size_t capacity = task->responsesCapacity > 0 ? task->responsesCapacity : READ_SIZE;
+        while (capacity < needed)
+        {
+            capacity *= 2;
+        }
+        char *grown = realloc(task->responses, capacity);
+        if (grown == NULL)
+        {
+            task->failed = 1;
+            return;
+        }
+        task->responses = grown;
+        task->responsesCapacity = capacity;
+    }
+    memcpy(task->responses + task->responsesLen, &header, FRAME_HEADER_SIZE);
+    memcpy(task->responses + task->responsesLen + FRAME_HEADER_SIZE, payload, len);
+    task->responsesLen = needed;
+}
+
+/**
+ * This function evaluates every request of a task
+ */
+void evaluateTask(CalcContext *context, Task *task)
+{
+    size_t offset = 0;
+    char response[MAX_RESPONSE_CHARS];
+    while (offset < task->requestsLen && !task->failed)
+    {
+        size_t len = readFrameHeader(task->requests + offset);
+        const char *text = task->requests + offset + FRAME_HEADER_SIZE;
+        CalcExpression *expression;
+        long long value;
+        CalcStatus status = calc_compile(context, text, len, &expression);
+        if (status == CALC_OK)
+        {
+            status = calc_eval(context, expression, &value);
+            calc_free(expression);
+        }
+        int responseLen = status == CALC_OK ? snprintf(response, sizeof(response), "%lld", value) :
+                          snprintf(response, sizeof(response), ERROR_PREFIX "%s", calc_strerror(status));
+        appendResponse(task, response, (size_t) responseLen);
+        offset += FRAME_HEADER_SIZE + len;
+    }
+}
+
+/**
+ * The body of a worker thread, it evaluates pending tasks and hands them back to the event loop
+ */
+void *serveTasks(void *arg)
+{
+    ServerWorker *worker = arg;
+    Server *server = worker->server;
+    uint64_t one = 1;
+    for (;;)
+    {
+        pthread_mutex_lock(&server->lock);
+        while (server->pendingHead == NULL && !server->stopping)
+        {
+            pthread_cond_wait(&server->ready, &server->lock);
+        }
+        Task *task = server->pendingHead;
+        if (task == NULL)
+        {
+            pthread_mutex_unlock(&server->lock);
+            return NULL;
+        }
+        server->pendingHead = task->next;
+        if (server->pendingHead == NULL)
+        {
+            server->pendingTail = NULL;
+        }
+        pthread_mutex_unlock(&server->lock);
+
+        evaluateTask(worker->context, task);
+
+        pthread_mutex_lock(&server->lock);
+        task->next = server->done;
+        server->done = task;
+        pthread_mutex_unlock(&server->lock);
+        if (write(server->eventFd, &one, sizeof(one)) < 0)
+        {
+            // the counter can't overflow, the event loop is already woken up
+        }
+    }
+}
+
+/**
+ * Frees a task
+ */
+void freeTask(Task *task)
+{
+    free(task->requests);
+    free(task->responses);
+    free(task);
+}
+
+/**
+ * This function closes the socket of a connection, the connection is freed once none of its tasks is evaluated
+ */
+void closeConnection(Server *server, Connection *connection)
+{
+    if (connection->closed)
+    {
+        return;
+    }
+    connection->closed = 1;
+    epoll_ctl(server->epollFd, EPOLL_CTL_DEL, connection->fd, NULL);
+    close(connection->fd);
+}
+
+/**
+ * This function moves a closed connection that has no task from the live connections to the dead ones, which are
+ * freed at the end of the iteration of the event loop
+ */
+void buryConnection(Server *server, Connection *connection)
+{
+    if (!connection->closed || connection->busy || connection->buried)
+    {
+        return;
+    }
+    connection->buried = 1;
+    if (connection->prev != NULL)
+    {
+        connection->prev->next = connection->next;
+    }
+    else
+    {
+        server->connections = connection->next;
+    }
+    if (connection->next != NULL)
+    {
+        connection->next->prev = connection->prev;
+    }
+    connection->next = server->dead;
+    server->dead = connection;
+}
+
+/**
+ * Frees a connection
+ */
+void freeConnection(Connection *connection)
+{
+    free(connection->input);
+    free(connection->output);
+    free(connection);
+}
+
+/**
+ * This function closes a half closed connection once nothing is left to do for it: none of its tasks is evaluated
+ * and all of its output is sent, so all of its complete requests were answered
+ */
+void closeIfDrained(Server *server, Connection *connection)
+{
+    if (connection->halfClosed && !connection->busy && connection->outputSent == connection->outputLen)
+    {
+        closeConnection(server, connection);
+    }
+}
+
+/**
+ * This function registers the events the connection waits for: input while its input buffer is not full and its
+ * client still sends, and output while it has unsent output
+ */
+void updateInterest(Server *server, Connection *connection)
+{
+    struct epoll_event event;
+    uint32_t events = (connection->inputLen < MAX_BUFFERED && !connection->halfClosed ? EPOLLIN : 0) |
+                      (connection->outputSent < connection->outputLen ? EPOLLOUT : 0);
+    if (connection->closed || events == connection->events)
+    {
+        return;
+    }
+    event.events = events;
+    event.data.ptr = connection;
+    epoll_ctl(server->epollFd, EPOLL_CTL_MOD, connection->fd, &event);
+    connection->events = events;
+}
+
+/**
+ * This function hands the complete request frames of a connection to the workers as a single task
+ */
+void dispatchConnection(Server *server, Connection *connection)
+{
+    size_t offset = 0;
+    if (connection->busy || connection->closed || connection->outputSent < connection->outputLen)
+    {
+        return;
+    }
+    while (connection->inputLen - offset >= FRAME_HEADER_SIZE)
+    {
+        size_t len = readFrameHeader(connection->input + offset);
+        if (len > MAX_REQUEST_SIZE)
+        {
+            closeConnection(server, connection);
+            return;
+        }
+        if (connection->inputLen - offset - FRAME_HEADER_SIZE < len)
+        {
+            break;
+        }
+        offset += FRAME_HEADER_SIZE + len;
+    }
+    if (offset == 0)
+    {
+        return;
+    }
+
+    // the task takes the input buffer, the connection keeps the partial frame at its end
+    size_t capacity = connection->inputCapacity;
+    Task *task = calloc(1, sizeof(Task));
+    char *input = malloc(capacity);
+    if (task == NULL || input == NULL)
+    {
+        free(task);
+        free(input);
+        closeConnection(server, connection);
+        return;
+    }
+    memcpy(input, connection->input + offset, connection->inputLen - offset);
+    task->connection = connection;
+    task->requests = connection->input;
+    task->requestsLen = offset;
+    connection->input = input;
+    connection->inputLen -= offset;
+    connection->busy = 1;
+
+    pthread_mutex_lock(&server->lock);
+    if (server->pendingTail != NULL)
+    {
+        server->pendingTail->next = task;
+    }
+    else
+    {
+        server->pendingHead = task;
+    }
+    server->pendingTail = task;
+    pthread_cond_signal(&server->ready);
+    pthread_mutex_unlock(&server->lock);
+    updateInterest(server, connection);
+}
+
+/**
+ * This function sends as much of the output of a connection as the socket takes, and once all of it is sent
+ * dispatches the requests that arrived meanwhile or closes a drained half closed connection
+ */
+void writeConnection(Server *server, Connection *connection)
+{
+    while (connection->outputSent < connection->outputLen)
+    {
+        ssize_t sent = send(connection->fd, connection->output + connection->outputSent,
+                            connection->outputLen - connection->outputSent, MSG_NOSIGNAL);
+        if (sent > 0)
+        {
+            connection->outputSent += (size_t) sent;
+        }
+        else if (sent < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        else if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            break;
+        }
+        else
+        {
+            closeConnection(server, connection);
+            return;
+        }
+    }
+    if (connection->outputSent == connection->outputLen)
+    {
+        connection->outputSent = connection->outputLen = 0;
+        dispatchConnection(server, connection);
+        closeIfDrained(server, connection);
+    }
+    updateInterest(server, connection);
+}
+
+/**
+ * This function reads what a connection has sent and dispatches its complete requests. The end of the input only
+ * marks the connection half closed, the requests before it are still answered.
+ */
+void readConnection(Server *server, Connection *connection)
+{
+    while (connection->inputLen < MAX_BUFFERED)
+    {
+        if (connection->inputCapacity - connection->inputLen < READ_SIZE)
+        {
+            char *grown = realloc(connection->input, 2 * connection->inputCapacity);
+            if (grown == NULL)
+            {
+                closeConnection(server, connection);
+                return;
+            }
+            connection->input = grown;
+            connection->inputCapacity *= 2;
+        }
+        ssize_t readNum = read(connection->fd, connection->input + connection->inputLen,
+                               connection->inputCapacity - connection->inputLen);
+        if (readNum > 0)
+        {
+            connection->inputLen += (size_t) readNum;
+        }
+        else if (readNum < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        else if (readNum < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            break;
+        }
+        else if (readNum == 0)
+        {
+            connection->halfClosed = 1;
+            break;
+        }
+        else
+        {
+            closeConnection(server, connection);
+            return;
+        }
+    }
+    dispatchConnection(server, connection);
+    closeIfDrained(server, connection);
+    updateInterest(server, connection);
+}
+
+/**
+ * This function accepts every pending connection
+ */
+void acceptConnections(Server *server)
+{
+    int fd;
+    while ((fd = accept4(server->listenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0)
+    {
+        struct epoll_event event;
+        Connection *connection = calloc(1, sizeof(Connection));
+        char *input = malloc(READ_SIZE);
+        if (connection == NULL || input == NULL)
+        {
+            free(connection);
+            free(input);
+            close(fd);
+            continue;
+        }
+        connection->fd = fd;
+        connection->input = input;
+        connection->inputCapacity = READ_SIZE;
+        connection->events = EPOLLIN;
+        event.events = EPOLLIN;
+        event.data.ptr = connection;
+        if (epoll_ctl(server->epollFd, EPOLL_CTL_ADD, fd, &event) != 0)
+        {
+            freeConnection(connection);
+            close(fd);
+            continue;
+        }
+        connection->next = server->connections;
+        if (server->connections != NULL)
+        {
+            server->connections->prev = connection;
+        }
+        server->connections = connection;
+    }
+}
+
+/**
+ * This function hands the evaluated tasks back to their connections
+ */
+void collectTasks(Server *server)
+{
+    uint64_t count;
+    if (read(server->eventFd, &count, sizeof(count)) < 0)
+    {
+        // another wake up already reset the counter
+    }
+    pthread_mutex_lock(&server->lock);
+    Task *task = server->done;
+    server->done = NULL;
+    pthread_mutex_unlock(&server->lock);
+
+    while (task != NULL)
+    {
+        Task *next = task->next;
+        Connection *connection = task->connection;
+        connection->busy = 0;
+        if (task->failed)
+        {
+            closeConnection(server, connection);
+        }
+        if (!connection->closed)
+        {
+            // no task is created while there is unsent output, so the responses replace the empty output
+            free(connection->output);
+            connection->output = task->responses;
+            connection->outputLen = task->responsesLen;
+            connection->outputSent = 0;
+            task->responses = NULL;
+            writeConnection(server, connection);
+        }
+        buryConnection(server, connection);
+        freeTask(task);
+        task = next;
+    }
+}
+
+/**
+ * This function creates the listening socket, a stale socket at the path is replaced but a socket that a running
+ * server listens on is not
+ * @return the socket or -1 if it can't be created (the reason is printed to stderr)
+ */
+int listenOn(const char *socketPath)
+{
+    struct sockaddr_un address;
+    struct stat info;
+    if (strlen(socketPath) >= sizeof(address.sun_path))
+    {
+        fprintf(stderr, "Error: the socket path is too long: %s\n", socketPath);
+        return -1;
+    }
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, socketPath);
+    if (stat(socketPath, &info) == 0 && S_ISSOCK(info.st_mode))
+    {
+        // the socket is stale only if nobody listens on it anymore
+        int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        int refused = probe >= 0 && connect(probe, (struct sockaddr *) &address, sizeof(address)) != 0 &&
+                      errno == ECONNREFUSED;
+        if (probe >= 0)
+        {
+            close(probe);
+        }
+        if (!refused)
+        {
+            fprintf(stderr, "Error listening on %s: address in use\n", socketPath);
+            return -1;
+        }
+        unlink(socketPath);
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0 || bind(fd, (struct sockaddr *) &address, sizeof(address)) != 0 || listen(fd, LISTEN_BACKLOG) != 0)
+    {
+        fprintf(stderr, "Error listening on %s: %s\n", socketPath, strerror(errno));
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * This function creates the descriptors of the event loop and registers them, SIGINT and SIGTERM are blocked and
+ * delivered through signalFd
+ * @return 0 in success and non zero otherwise
+ */
+int openServer(Server *server, const char *socketPath)
+{
+    struct epoll_event event;
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+    server->listenFd = listenOn(socketPath);
+    server->eventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    server->signalFd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    server->epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (server->listenFd < 0 || server->eventFd < 0 || server->signalFd < 0 || server->epollFd < 0)
+    {
+        return 1;
+    }
+    event.events = EPOLLIN;
+    event.data.ptr = &server->listenFd;
+    epoll_ctl(server->epollFd, EPOLL_CTL_ADD, server->listenFd, &event);
+    event.data.ptr = &server->eventFd;
+    epoll_ctl(server->epollFd, EPOLL_CTL_ADD, server->eventFd, &event);
+    event.data.ptr = &server->signalFd;
+    epoll_ctl(server->epollFd, EPOLL_CTL_ADD, server->signalFd, &event);
+    return 0;
+}
+
+/**
+ * This function multiplexes the connections until a signal arrives
+ */
+void runEventLoop(Server *server)
+{
+    struct epoll_event events[MAX_EVENTS];
+    int stopped = 0;
+    while (!stopped)
+    {
+        int i, eventsNum = epoll_wait(server->epollFd, events, MAX_EVENTS, -1);
+        if (eventsNum < 0 && errno != EINTR)
+        {
+            fprintf(stderr, "Error: %s\n", strerror(errno));
+            return;
+        }
+        for (i = 0; i < eventsNum; i++)
+        {
+            void *source = events[i].data.ptr;
+            if (source == &server->listenFd)
+            {
+                acceptConnections(server);
+            }
+            else if (source == &server->eventFd)
+            {
+                collectTasks(server);
+            }
+            else if (source == &server->signalFd)
+            {
+                stopped = 1;
+            }
+            else
+            {
+                Connection *connection = source;
+                if (connection->closed)
+                {
+                    // closed by an earlier event of this iteration
+                    continue;
+                }
+                if (events[i].events & (EPOLLHUP | EPOLLERR))
+                {
+                    // the client is gone in both directions, its responses can't be delivered
+                    closeConnection(server, connection);
+                }
+                else if (events[i].events & EPOLLIN)
+                {
+                    readConnection(server, connection);
+                }
+                if ((events[i].events & EPOLLOUT) && !connection->closed)
+                {
+                    writeConnection(server, connection);
+                }
+                buryConnection(server, connection);
+            }
+        }
+        while (server->dead != NULL)
+        {
+            Connection *next = server->dead->next;
+            freeConnection(server->dead);
+            server->dead = next;
+        }
+    }
+}
+
+/**
+ * This function stops the workers and frees everything the server still holds
+ */
+void closeServer(Server *server, ServerWorker *workers, int workersNum, const char *socketPath)
+{
+    int i;
+    pthread_mutex_lock(&server->lock);
+    server->stopping = 1;
+    pthread_cond_broadcast(&server->ready);
+    pthread_mutex_unlock(&server->lock);
+    for (i = 0; i < workersNum; i++)
+    {
+        pthread_join(workers[i].thread, NULL);
+        calc_context_destroy(workers[i].context);
+    }
+    while (server->done != NULL)
+    {
+        Task *next = server->done->next;
+        freeTask(server->done);
+        server->done = next;
+    }
+    while (server->connections != NULL)
+    {
+        Connection *next = server->connections->next;
+        closeConnection(server, server->connections);
+        freeConnection(server->connections);
+        server->connections = next;
+    }
+    int fds[] = {server->listenFd, server->eventFd, server->signalFd, server->epollFd};
+    for (i = 0; i < (int) (sizeof(fds) / sizeof(fds[0])); i++)
+    {
+        if (fds[i] >= 0)
+        {
+            close(fds[i]);
+        }
+    }
+    if (server->listenFd >= 0)
+    {
+        unlink(socketPath);
+    }
+    pthread_mutex_destroy(&server->lock);
+    pthread_cond_destroy(&server->ready);
+}
+
+/**
+ * This function runs the calculator as a server on a Unix domain socket until it gets SIGINT or SIGTERM.
+ * A single thread multiplexes the connections with epoll and a pool of workers evaluates the requests. Requests
+ * may be pipelined: the complete frames a connection has sent are evaluated together as one task and their
+ * responses are sent in the order of the requests.
+ * @param socketPath the path of the socket, a stale socket at this path is replaced
+ * @param workersNum the number of worker threads
+ * @return EXIT_SUCCESS if the server stopped because of a signal and EXIT_FAILURE otherwise
+ */
+int runServer(const char *socketPath, int workersNum)
+{
+    int i, startedNum = 0, failed;
+    Server server;
+    memset(&server, 0, sizeof(Server));
+    server.listenFd = server.eventFd = server.signalFd = server.epollFd = -1;
+    pthread_mutex_init(&server.lock, NULL);
+    pthread_cond_init(&server.ready, NULL);
+    ServerWorker *workers = calloc((size_t) workersNum, sizeof(ServerWorker));
+
+    failed = workers == NULL || openServer(&server, socketPath);
+    for (i = 0; !failed && i < workersNum; i++)
+    {
+        workers[i].server = &server;
+        failed = calc_context_create(NULL, &workers[i].context) != CALC_OK ||
+                 pthread_create(&workers[i].thread, NULL, serveTasks, &workers[i]) != 0;
+        if (failed)
+        {
+            calc_context_destroy(workers[i].context);
+        }
+        else
+        {
+            startedNum++;
+        }
+    }
+    if (failed)
+    {
+        fprintf(stderr, "Error: can't start the server\n");
+    }
+    else
+    {
+        runEventLoop(&server);
+    }
+    closeServer(&server, workers, startedNum, socketPath);
+    free(workers);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,31 @@
+#ifndef EX3_SERVER_H
+#define EX3_SERVER_H
+
+// -------------------------- const definitions -------------------------
+
+/**
+ * Requests and responses are frames: the length of the payload as a 4 byte big endian integer and the payload.
+ * The payload of a request is an expression, the payload of its response is the value of the expression or
+ * "error: " and the reason of the failure.
+ */
+#define FRAME_HEADER_SIZE 4
+
+/**
+ * The longest request payload the server accepts, a connection that sends a longer one is closed
+ */
+#define MAX_REQUEST_SIZE (1 << 20)
+
+// ------------------------------ functions -----------------------------
+
+/**
+ * This function runs the calculator as a server on a Unix domain socket until it gets SIGINT or SIGTERM.
+ * A single thread multiplexes the connections with epoll and a pool of workers evaluates the requests. Requests
+ * may be pipelined: the complete frames a connection has sent are evaluated together as one task and their
+ * responses are sent in the order of the requests.
+ * @param socketPath the path of the socket, a stale socket at this path is replaced
+ * @param workersNum the number of worker threads
+ * @return EXIT_SUCCESS if the server stopped because of a signal and EXIT_FAILURE otherwise
+ */
+int runServer(const char *socketPath, int workersNum);
+
+#endif
@@ -6,58 +6,97 @@
 Stack* stackAlloc(size_t elementSize)
 {
   Stack* stack = (Stack*)malloc(sizeof(Stack));
-  stack->_top = NULL;
+  if (stack == NULL)
+    {
+      return NULL;
+    }
+  stack->_data = malloc(STACK_INITIAL_CAPACITY * elementSize);
+  if (stack->_data == NULL)
+    {
+      free(stack);
+      return NULL;
+    }
+  stack->_size = 0;
+  stack->_capacity = STACK_INITIAL_CAPACITY;
   stack->_elementSize = elementSize;
+  stack->_fixed = 0;
   return stack;
 }
 
+void stackInit(Stack* stack, void *storage, size_t capacity, size_t elementSize)
+{
+  // the storage is not freed by the stack, a full stack refuses pushes like an out of memory one
+  stack->_data = storage;
+  stack->_size = 0;
+  stack->_capacity = capacity;
+  stack->_elementSize = elementSize;
+  stack->_fixed = 1;
+}
+
 void freeStack(Stack** stack)
 {
-  Node* p1;
-  Node* p2;
   if (!(*stack == NULL))
     {
-      p1= (*stack)->_top;
-      while(p1)
-	{
-	  p2= p1;
-	  p1= p1->_next;
-	  free(p2->_data);
-	  free(p2);
-	}
+      free((*stack)->_data);
       free(*stack);
       *stack = NULL;
     }
 }
 
-void push(Stack* stack, void *data)
+int push(Stack* stack, void *data)
 {
-  //you should check allocation success
-  Node* node = (Node*)malloc(sizeof(Node));
-  node->_data = malloc(stack->_elementSize);
-  memcpy(node->_data, data, stack->_elementSize);
-  node->_next = stack->_top;
-  stack->_top = node;
+  assert(stack != NULL);
+  if (stack->_size == stack->_capacity)
+    {
+      // geometric growth keeps push amortized O(1)
+      size_t capacity = stack->_capacity * 2;
+      void *grown = stack->_fixed ? NULL : realloc(stack->_data, capacity * stack->_elementSize);
+      if (grown == NULL)
+	{
+	  // the element is not pushed, the caller decides how to fail
+	  return -1;
+	}
+      stack->_data = grown;
+      stack->_capacity = capacity;
+    }
+  memcpy((char *)stack->_data + stack->_size * stack->_elementSize, data, stack->_elementSize);
+  stack->_size++;
+  return 0;
 }
 
 void pop(Stack* stack, void *headData)
 {
   assert(stack != NULL);
-  if(stack->_top == NULL)
+  if(stack->_size == 0)
+    {
+      fprintf(stderr, "The stack is empty\n");
+      return;
+    }
+
+  stack->_size--;
+  memcpy(headData, (char *)stack->_data + stack->_size * stack->_elementSize, stack->_elementSize);
+}
+
+void peek(Stack* stack, void *headData)
+{
+  assert(stack != NULL);
+  if(stack->_size == 0)
     {
       fprintf(stderr, "The stack is empty\n");
       return;
     }
 
-  Node *node = stack->_top;
-  memcpy(headData, node->_data,stack->_elementSize);
-  stack->_top = node->_next;
-  free(node->_data);
-  free(node);
+  memcpy(headData, (char *)stack->_data + (stack->_size - 1) * stack->_elementSize, stack->_elementSize);
+}
+
+void clearStack(Stack* stack)
+{
+  assert(stack != NULL);
+  stack->_size = 0;
 }
 
 int isEmptyStack(Stack* stack)
 {
   assert(stack != NULL);
-  return stack->_top == NULL;
+  return stack->_size == 0;
 }
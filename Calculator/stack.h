@@ -3,26 +3,31 @@
 
 #include <stdlib.h>
 
-typedef struct Node
-{
-  void * _data; // pointer to anything
-  struct Node * _next;
-} Node;
+#define STACK_INITIAL_CAPACITY 16
 
 typedef struct Stack
 {
-  Node * _top;
+  void * _data;           // contiguous storage, element i lives at _data + i * _elementSize
+  size_t _size;           // number of elements currently on the stack
+  size_t _capacity;       // number of elements _data can hold before growing
   size_t _elementSize;    // we need that for memcpy
+  int _fixed;             // non zero if _data belongs to the caller, such a stack never grows
 } Stack;
 
 Stack* stackAlloc(size_t elementSize);
 
+void stackInit(Stack* stack, void *storage, size_t capacity, size_t elementSize);
+
 void freeStack(Stack** stack);
 
-void push(Stack* stack, void *data);
+int push(Stack* stack, void *data);
 
 void pop(Stack* stack,void *headData);
 
+void peek(Stack* stack, void *headData);
+
+void clearStack(Stack* stack);
+
 int isEmptyStack(Stack* stack);
 
 #endif
@@ -0,0 +1,409 @@
+/**
+ * @file stackBench.c
+ *
+ * @brief Measures the cost of the stack used by inToPost and calculatePostfix.
+ *
+ * @section DESCRIPTION
+ * The binary is linked with -Wl,--wrap=malloc,--wrap=realloc so every heap allocation made by the stack
+ * and by the conversion code is counted.
+ * Output : time and allocations per expression for convertToPostfix + evaluatePostfix on reused stacks (the
+ * steady-state path), for a full inToPost + calculatePostfix round trip, which allocates its stacks and its postfix
+ * buffer on every call, and for re-running the compiled byte code, and the time of the VM and the
+ * JIT over random variable bindings. The JIT is checked against the VM on random expressions, up to past the depth
+ * the JIT compiles, with edge case operands, and any mismatch fails the run.
+ * Then it compares the double pow path of getResult with the 64 bit exponentiation by squaring of getPower64, and
+ * the int evaluation with the arbitrary precision evaluation of evaluatePostfixBig.
+ * The stages of the calculator over synthetic workloads are measured by calcBench.
+ */
+
+// ------------------------------ includes ------------------------------
+
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "stack.h"
+#include "inFix.h"
+#include "postFix.h"
+#include "byteCode.h"
+#include "jit.h"
+#include "bigInt.h"
+
+// -------------------------- const definitions -------------------------
+
+#define ROUNDS 1000000
+
+#define WARMUP_ROUNDS 16
+
+#define VARIABLES_NUM 5
+
+#define BINDINGS_NUM 4096
+
+#define JIT_EXPRESSIONS 4000
+
+#define JIT_ROWS 256
+
+#define JIT_MAX_LEAVES (JIT_REGISTERS + 4)
+
+// ------------------------------ globals -----------------------------
+
+static size_t allocations = 0;
+
+// ------------------------------ functions -----------------------------
+
+void *__real_malloc(size_t size);
+
+void *__real_realloc(void *pointer, size_t size);
+
+void *__wrap_malloc(size_t size)
+{
+    allocations++;
+    return __real_malloc(size);
+}
+
+void *__wrap_realloc(void *pointer, size_t size)
+{
+    allocations++;
+    return __real_realloc(pointer, size);
+}
+
+/**
+ * @return the current monotonic time in nanoseconds
+ */
+static double nowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/**
+ * Converts and evaluates the given infix expression with convertToPostfix and evaluatePostfix on existing stacks and
+ * an existing postfix buffer, the path the batch and server modes take for every line
+ * @return the value of the expression
+ */
+static int convertAndEvaluate(const MathObject *infix, int len, MathObject *postfix, Stack *operators,
+                              Stack *operands)
+{
+    int result = 0;
+    int postLen = convertToPostfix(infix, len, postfix, operators);
+    if (postLen < 0 || evaluatePostfix(postfix, postLen, operands, &result) != EVAL_OK)
+    {
+        exit(EXIT_FAILURE);
+    }
+    return result;
+}
+
+/**
+ * @return a random operand, an edge case of int arithmetic a third of the time
+ */
+static int randomOperand()
+{
+    static const int edgeOperands[] = {0, 1, -1, 2, -2, INT_MIN, INT_MIN + 1, INT_MAX, INT_MAX - 1};
+    switch (rand() % 3)
+    {
+        case 0:
+            return edgeOperands[rand() % (sizeof(edgeOperands) / sizeof(edgeOperands[0]))];
+        case 1:
+            return (int) (((unsigned int) rand() << 16) ^ (unsigned int) rand());
+        default:
+            return rand() % 21 - 10;
+    }
+}
+
+/**
+ * Appends a random postfix expression over VARIABLES_NUM variables with the given number of leaves. The right
+ * operand of an operator is usually the larger one so the operand stack of the expression gets deep.
+ * @return the new length of the expression
+ */
+static int appendRandomExpression(MathObject *postfix, int len, int leaves)
+{
+    static const char operators[] = {plus, minus, mul, division, division};
+    int leftLeaves;
+    if (leaves == 1)
+    {
+        postfix[len].type = rand() % 2 ? variable : operand;
+        postfix[len].value = postfix[len].type == variable ? rand() % VARIABLES_NUM : randomOperand();
+        return len + 1;
+    }
+    leftLeaves = rand() % 3 == 0 ? 1 + rand() % (leaves - 1) : 1;
+    len = appendRandomExpression(postfix, len, leftLeaves);
+    len = appendRandomExpression(postfix, len, leaves - leftLeaves);
+    postfix[len].type = operators[rand() % sizeof(operators)];
+    postfix[len].value = 0;
+    return len + 1;
+}
+
+/**
+ * Evaluates random expressions up to JIT_MAX_LEAVES deep over random bindings with the VM and the JIT, row by row
+ * (runByteCode, runJit) and over whole columns (runByteCodeBlock, runJitRows). The operands include 0, -1 and
+ * INT_MIN so the expressions divide by 0 and compute INT_MIN / -1, and expressions deeper than JIT_REGISTERS must be
+ * refused by the JIT. A run that doesn't cover all of these cases fails.
+ * @return the number of evaluations on which the JIT and the VM disagree
+ */
+static int checkJit()
+{
+    static MathObject postfix[2 * JIT_MAX_LEAVES];
+    static int values[VARIABLES_NUM][JIT_ROWS], vmResults[JIT_ROWS], jitResults[JIT_ROWS];
+    static char vmFailed[JIT_ROWS], jitFailed[JIT_ROWS];
+    const int *columns[VARIABLES_NUM];
+    int variables[VARIABLES_NUM];
+    int statuses[EVAL_OVERFLOW + 1] = {0};
+    int e, r, j, len, vmValue, jitValue, mismatches = 0, deepestCompiled = 0, deeperRefused = 0;
+    JitCode *jitCode;
+
+    postfix[0].type = operand;
+    postfix[0].value = 0;
+    ByteCode *probe = compileByteCode(postfix, 1);
+    jitCode = compileJit(probe);
+    freeJit(jitCode);
+    freeByteCode(probe);
+    if (jitCode == NULL)
+    {
+        printf("jit unavailable\n");
+        return 0;
+    }
+    srand(1);
+    for (j = 0; j < VARIABLES_NUM; j++)
+    {
+        columns[j] = values[j];
+    }
+    for (e = 0; e < JIT_EXPRESSIONS; e++)
+    {
+        len = appendRandomExpression(postfix, 0, 1 + rand() % JIT_MAX_LEAVES);
+        ByteCode *byteCode = compileByteCode(postfix, len);
+        jitCode = compileJit(byteCode);
+        if (jitCode == NULL)
+        {
+            deeperRefused += byteCode->maxDepth > JIT_REGISTERS;
+            mismatches += byteCode->maxDepth <= JIT_REGISTERS;
+            freeByteCode(byteCode);
+            continue;
+        }
+        deepestCompiled += byteCode->maxDepth == JIT_REGISTERS;
+        mismatches += byteCode->maxDepth > JIT_REGISTERS;
+        for (j = 0; j < VARIABLES_NUM; j++)
+        {
+            for (r = 0; r < JIT_ROWS; r++)
+            {
+                values[j][r] = randomOperand();
+            }
+        }
+        runByteCodeBlock(byteCode, columns, JIT_ROWS, vmResults, vmFailed);
+        runJitRows(jitCode, VARIABLES_NUM, columns, JIT_ROWS, jitResults, jitFailed);
+        for (r = 0; r < JIT_ROWS; r++)
+        {
+            for (j = 0; j < VARIABLES_NUM; j++)
+            {
+                variables[j] = values[j][r];
+            }
+            EvalStatus vmStatus = runByteCode(byteCode, variables, &vmValue);
+            EvalStatus jitStatus = runJit(jitCode, variables, &jitValue);
+            statuses[vmStatus]++;
+            if (vmStatus != jitStatus || (vmStatus == EVAL_OK && vmValue != jitValue))
+            {
+                mismatches++;
+            }
+            if (vmFailed[r] != (char) vmStatus || jitFailed[r] != (char) vmStatus ||
+                (vmStatus == EVAL_OK && (vmResults[r] != vmValue || jitResults[r] != vmValue)))
+            {
+                mismatches++;
+            }
+        }
+        freeJit(jitCode);
+        freeByteCode(byteCode);
+    }
+    printf("jit_check expressions=%d ok=%d div_by_zero=%d overflow=%d refused=%d mismatches=%d\n",
+           JIT_EXPRESSIONS, statuses[EVAL_OK], statuses[EVAL_DIV_BY_ZERO], statuses[EVAL_OVERFLOW], deeperRefused,
+           mismatches);
+    return mismatches + (statuses[EVAL_OK] == 0) + (statuses[EVAL_DIV_BY_ZERO] == 0) +
+           (statuses[EVAL_OVERFLOW] == 0) + (deepestCompiled == 0) + (deeperRefused == 0);
+}
+
+/**
+ * Times the VM and the JIT on (a + b) * (c - d) / (e + 1) - a * c over random bindings
+ * @return non zero if the measured loops were optimized away
+ */
+static int timeJit()
+{
+    MathObject postfix[] = {
+            {0, variable}, {1, variable}, {0, plus}, {2, variable}, {3, variable}, {0, minus}, {0, mul},
+            {4, variable}, {1, operand}, {0, plus}, {0, division}, {0, variable}, {2, variable}, {0, mul},
+            {0, minus}
+    };
+    static int bindings[BINDINGS_NUM][VARIABLES_NUM];
+    int i, j, vmValue, jitValue;
+    volatile int sink = 0;
+    ByteCode *byteCode = compileByteCode(postfix, sizeof(postfix) / sizeof(postfix[0]));
+    JitCode *jitCode = compileJit(byteCode);
+    if (jitCode == NULL)
+    {
+        freeByteCode(byteCode);
+        return 0;
+    }
+    srand(1);
+    for (i = 0; i < BINDINGS_NUM; i++)
+    {
+        for (j = 0; j < VARIABLES_NUM; j++)
+        {
+            bindings[i][j] = rand() % 2001 - 1000;
+        }
+    }
+
+    double start = nowNs();
+    for (i = 0; i < ROUNDS; i++)
+    {
+        runByteCode(byteCode, bindings[i % BINDINGS_NUM], &vmValue);
+        sink += vmValue;
+    }
+    double vmElapsed = nowNs() - start;
+    start = nowNs();
+    for (i = 0; i < ROUNDS; i++)
+    {
+        runJit(jitCode, bindings[i % BINDINGS_NUM], &jitValue);
+        sink += jitValue;
+    }
+    double jitElapsed = nowNs() - start;
+    printf("vm_eval ns_per_expr=%.2f\njit_eval ns_per_expr=%.2f\n", vmElapsed / ROUNDS, jitElapsed / ROUNDS);
+
+    freeJit(jitCode);
+    freeByteCode(byteCode);
+    return sink == 0;
+}
+
+/**
+ * Times ^ through getResult (double pow) and through getPower64 (exponentiation by squaring)
+ */
+static void comparePower()
+{
+    int i;
+    long long wideValue;
+    volatile long long sink = 0;
+    double start = nowNs();
+    for (i = 0; i < ROUNDS; i++)
+    {
+        sink += getResult(i % 20, 3 + i % 5, power);
+    }
+    double doubleElapsed = nowNs() - start;
+    start = nowNs();
+    for (i = 0; i < ROUNDS; i++)
+    {
+        getPower64(3 + i % 5, i % 20, &wideValue);
+        sink += wideValue;
+    }
+    double squaringElapsed = nowNs() - start;
+    printf("pow_double ns_per_op=%.2f\npow_squaring ns_per_op=%.2f\n", doubleElapsed / ROUNDS,
+           squaringElapsed / ROUNDS);
+}
+
+/**
+ * Times the int evaluation against the arbitrary precision evaluation of the same small expression, which must stay
+ * on its 64 bit fast path, and times a large power
+ */
+static void compareBig(const MathObject *postfix, int len)
+{
+    int i, value;
+    Number number;
+    volatile long long sink = 0;
+    Stack *stack = stackAlloc(sizeof(int));
+    Stack *numbers = stackAlloc(sizeof(Number));
+    double start = nowNs();
+    for (i = 0; i < ROUNDS; i++)
+    {
+        evaluatePostfix(postfix, len, stack, &value);
+        sink += value;
+    }
+    double intElapsed = nowNs() - start;
+    size_t before = allocations;
+    start = nowNs();
+    for (i = 0; i < ROUNDS; i++)
+    {
+        evaluatePostfixBig(postfix, len, numbers, NULL, 0, &number);
+        sink += number.small;
+        numberFree(&number);
+    }
+    double bigElapsed = nowNs() - start;
+    printf("int_eval ns_per_expr=%.2f\nbig_eval ns_per_expr=%.2f allocs_per_expr=%.3f\n", intElapsed / ROUNDS,
+           bigElapsed / ROUNDS, (double) (allocations - before) / ROUNDS);
+
+    // 7 ^ 20000
+    MathObject bigPower[] = {{7, operand}, {20000, operand}, {0, power}};
+    start = nowNs();
+    evaluatePostfixBig(bigPower, 3, numbers, NULL, 0, &number);
+    char *digits = bigToString(number.big);
+    double powerElapsed = nowNs() - start;
+    printf("big_pow_7_20000 us=%.2f digits=%zu\n", powerElapsed / 1000, digits == NULL ? 0 : strlen(digits));
+    free(digits);
+    numberFree(&number);
+    freeStack(&numbers);
+    freeStack(&stack);
+}
+
+int main()
+{
+    // (1 + 2) * (3 + 4) * (5 + 6) + 7 * 8
+    MathObject infix[] = {
+            {0, lPar}, {1, operand}, {0, plus}, {2, operand}, {0, rPar}, {0, mul},
+            {0, lPar}, {3, operand}, {0, plus}, {4, operand}, {0, rPar}, {0, mul},
+            {0, lPar}, {5, operand}, {0, plus}, {6, operand}, {0, rPar}, {0, plus},
+            {7, operand}, {0, mul}, {8, operand}
+    };
+    int len = sizeof(infix) / sizeof(infix[0]);
+    int postLen = len - 6;
+    int i;
+    volatile int sink = 0;
+
+    MathObject *postfix = inToPost(infix, len);
+    MathObject *reused = (MathObject *) malloc(len * sizeof(MathObject));
+    Stack *operators = stackAlloc(sizeof(char));
+    Stack *stack = stackAlloc(sizeof(int));
+    for (i = 0; i < WARMUP_ROUNDS; i++)
+    {
+        sink += convertAndEvaluate(infix, len, reused, operators, stack);
+    }
+
+    size_t before = allocations;
+    double start = nowNs();
+    for (i = 0; i < ROUNDS; i++)
+    {
+        sink += convertAndEvaluate(infix, len, reused, operators, stack);
+    }
+    double elapsed = nowNs() - start;
+    printf("stack_steady_state ns_per_expr=%.2f allocs_per_expr=%.3f\n", elapsed / ROUNDS,
+           (double) (allocations - before) / ROUNDS);
+
+    before = allocations;
+    start = nowNs();
+    for (i = 0; i < ROUNDS; i++)
+    {
+        MathObject *converted = inToPost(infix, len);
+        sink += calculatePostfix(converted, postLen);
+        free(converted);
+    }
+    elapsed = nowNs() - start;
+    printf("convert_and_eval ns_per_expr=%.2f allocs_per_expr=%.3f\n", elapsed / ROUNDS,
+           (double) (allocations - before) / ROUNDS);
+
+    ByteCode *byteCode = compileByteCode(postfix, postLen);
+    int value;
+    before = allocations;
+    start = nowNs();
+    for (i = 0; i < ROUNDS; i++)
+    {
+        runByteCode(byteCode, NULL, &value);
+        sink += value;
+    }
+    elapsed = nowNs() - start;
+    printf("bytecode_eval ns_per_expr=%.2f allocs_per_expr=%.3f\n", elapsed / ROUNDS,
+           (double) (allocations - before) / ROUNDS);
+
+    freeByteCode(byteCode);
+    freeStack(&stack);
+    freeStack(&operators);
+    free(reused);
+    int mismatches = checkJit() + timeJit();
+    comparePower();
+    compareBig(postfix, postLen);
+    free(postfix);
+    return (sink == 0) | (mismatches != 0);
+}
@@ -0,0 +1,168 @@
+/**
+ * @file testCalc.c
+ *
+ * @brief Checks the public API of libcalc.a (calc.h).
+ *
+ * @section DESCRIPTION
+ * Every case compiles an expression and, if it compiles, evaluates it, and compares the status of the first step
+ * that fails, or the value, with the expected one. The contexts and the expressions are allocated through a counting
+ * allocator, and every allocation must be released by the end.
+ * Output : one line per failed case, the exit status is non zero if any case failed.
+ */
+
+// ------------------------------ includes ------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "calc.h"
+
+// ------------------------------ structures -----------------------------
+
+/**
+ * An expression and the expected outcome of compiling and evaluating it, value is only checked with CALC_OK
+ */
+typedef struct
+{
+    const char *text;
+    CalcStatus status;
+    long long value;
+} Case;
+
+// ------------------------------ globals -----------------------------
+
+static const Case CASES[] = {
+        {"1+2",                        CALC_OK,              3},
+        {"(1+2)*3",                    CALC_OK,              9},
+        {"2^10",                       CALC_OK,              1024},
+        {"-3*-2",                      CALC_OK,              6},
+        {"7/2",                        CALC_OK,              3},
+        {"-7/2",                       CALC_OK,              -3},
+        {"((((5))))",                  CALC_OK,              5},
+        {"2147483647*2147483647",      CALC_OK,              4611686014132420609LL},
+        {"-2147483648/-1",             CALC_OK,              2147483648LL},
+        {"7/0",                        CALC_ERR_DIV_BY_ZERO, 0},
+        {"2147483647^3",               CALC_ERR_OVERFLOW,    0},
+        {"2147483648",                 CALC_ERR_RANGE,       0},
+        {"1+2)",                       CALC_ERR_SYNTAX,      0},
+        {"(1+2",                       CALC_ERR_SYNTAX,      0},
+        {")1+2(",                      CALC_ERR_SYNTAX,      0},
+        {"(1+2))*(3",                  CALC_ERR_SYNTAX,      0},
+        {"1+",                         CALC_ERR_SYNTAX,      0},
+        {"1 2",                        CALC_ERR_SYNTAX,      0},
+        {"()",                         CALC_ERR_SYNTAX,      0},
+        {"",                           CALC_ERR_SYNTAX,      0},
+};
+
+/**
+ * The number of blocks the counting allocator handed out and didn't get back
+ */
+static long liveBlocks = 0;
+
+// ------------------------------ functions -----------------------------
+
+/**
+ * The allocate of the counting allocator
+ */
+static void *countingAllocate(void *opaque, size_t size)
+{
+    (void) opaque;
+    void *pointer = malloc(size);
+    liveBlocks += pointer != NULL;
+    return pointer;
+}
+
+/**
+ * The release of the counting allocator
+ */
+static void countingRelease(void *opaque, void *pointer)
+{
+    (void) opaque;
+    liveBlocks -= pointer != NULL;
+    free(pointer);
+}
+
+/**
+ * This function compiles and evaluates the expression of the given case
+ * @return 0 if the outcome is the expected one and 1 otherwise
+ */
+static int runCase(CalcContext *context, const Case *test)
+{
+    CalcExpression *expression = NULL;
+    long long value = 0;
+    CalcStatus status = calc_compile(context, test->text, strlen(test->text), &expression);
+    if (status == CALC_OK)
+    {
+        status = calc_eval(context, expression, &value);
+        calc_free(expression);
+    }
+    else if (expression != NULL)
+    {
+        printf("\"%s\": a failed compilation returned an expression\n", test->text);
+        return 1;
+    }
+    if (status != test->status || (status == CALC_OK && value != test->value))
+    {
+        printf("\"%s\": got %s (%lld), expected %s (%lld)\n", test->text, calc_strerror(status), value,
+               calc_strerror(test->status), test->value);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * This function checks the arguments that the functions of the library reject
+ * @return the number of failed checks
+ */
+static int checkArguments(CalcContext *context)
+{
+    CalcAllocator incomplete = {countingAllocate, NULL, NULL};
+    CalcExpression *expression;
+    CalcContext *other;
+    long long value;
+    int failed = 0;
+    failed += calc_context_create(&incomplete, &other) != CALC_ERR_ARGUMENT;
+    failed += calc_context_create(NULL, NULL) != CALC_ERR_ARGUMENT;
+    failed += calc_compile(NULL, "1", 1, &expression) != CALC_ERR_ARGUMENT;
+    failed += calc_compile(context, NULL, 1, &expression) != CALC_ERR_ARGUMENT;
+    failed += calc_compile(context, "1", 1, NULL) != CALC_ERR_ARGUMENT;
+    failed += calc_eval(context, NULL, &value) != CALC_ERR_ARGUMENT;
+    failed += strcmp(calc_strerror(CALC_ERR_SYNTAX), "malformed expression") != 0;
+    calc_free(NULL);
+    calc_context_destroy(NULL);
+    if (failed)
+    {
+        printf("%d argument checks failed\n", failed);
+    }
+    return failed;
+}
+
+/**
+ * Runs the cases with a counting allocator
+ * @return 0 if every case passed and 1 otherwise
+ */
+int main()
+{
+    CalcAllocator allocator = {countingAllocate, countingRelease, NULL};
+    CalcContext *context;
+    size_t i;
+    int failed = 0;
+    if (calc_context_create(&allocator, &context) != CALC_OK)
+    {
+        printf("Error: can't create a context\n");
+        return 1;
+    }
+    for (i = 0; i < sizeof(CASES) / sizeof(CASES[0]); i++)
+    {
+        failed += runCase(context, &CASES[i]);
+    }
+    failed += checkArguments(context);
+    calc_context_destroy(context);
+    if (liveBlocks != 0)
+    {
+        printf("%ld blocks were not released\n", liveBlocks);
+        failed++;
+    }
+    printf("%zu cases, %d failed\n", sizeof(CASES) / sizeof(CASES[0]), failed);
+    return failed != 0;
+}
@@ -12,6 +12,7 @@
  * Process: Parsing the coordinates of the atoms in the given files and by that calculates the protein's
  * Center of mass, Radius of gyration and The maximum distance within the protein.
  * Output : prints the result of the analysis.
+ * Build  : gcc AnalyzeProtein.c -lm -pthread (-DDMAX_BRUTE_FORCE for the all pairs Dmax baseline)
  */
 
 // ------------------------------ includes ------------------------------
@@ -21,6 +22,18 @@
 #include <stdlib.h>
 #include <memory.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define DMAX_X86
+#include <immintrin.h>
+#endif
 
 // -------------------------- const definitions -------------------------
 
@@ -28,233 +41,3395 @@
 
 #define NUM_OF_COORD 3
 
-#define MAX_LINES 20000
-
 #define NUM_OF_COORDS 3
 
 #define ATOM_FLAG "ATOM  "
 
+#define HETATM_FLAG "HETATM"
+
+#define END_MODEL_FLAG "ENDMDL"
+
 #define WORD_LEN 6
 
 #define MIN_LINE_LEN 60
 
-#define FLAG_LEN 7
-
 #define LEN_OF_COORD 8
 
+#define FIRST_COORD_OFFSET 30
+
+#define POINT_OFFSET 4
+
+#define COORD_SCALE 1000.0f
+
+#define NOT_MAPPED (-2)
+
+#define MAP_WINDOW_SIZE ((size_t) 1 << 23)
+
+#define MALFORMED_FILE (-3)
+
+#define ERROR_LEN 256
+
+#define JOBS_FLAG "-j"
+
+#define STREAM_FLAG "-s"
+
+#define MODEL_FLAG "-m"
+
+#define CACHE_FLAG "-c"
+
+#define CACHE_SUFFIX ".apc"
+
+#define CACHE_TEMP_SUFFIX ".XXXXXX"
+
+#define CACHE_MAGIC "APCACHE"
+
+#define CACHE_MAGIC_LEN 8
+
+#define CACHE_VERSION 2
+
+#define CACHE_HEADER_SIZE 128
+
+#define HASH_OFFSET 0xcbf29ce484222325ULL
+
+#define HASH_PRIME 0x100000001b3ULL
+
+#define FRAME_FREE 0
+
+#define FRAME_READ 1
+
+#define FRAME_ANALYZED 2
+
+#define FRAMES_PER_THREAD 2
+
 #define FAILURE 1
 
+#define ATOMS_ALIGNMENT 64
+
+#define INITIAL_ATOMS_CAPACITY 1024
+
+#define HULL_MIN_ATOMS 64
+
+#define HULL_INITIAL_CAPACITY 16
+
+#define HULL_EPSILON 1e-9
+
+#define HULL_WORK_DIVISOR 4
+
+#define DMAX_BLOCK_ATOMS 32
+
+#define DMAX_TILE_ATOMS 2048
+
+#define DMAX_MIN_PAIRS_PER_THREAD (1 << 22)
+
+#define MAX_KERNEL_THREADS 64
+
+#define CONTACTS_FLAG "-r"
+
+#define CLASH_DISTANCE 0.9f
+
+#define GRID_CELLS_PER_ATOM 2
+
+#define CONTACTS_MIN_ATOMS_PER_THREAD (1 << 14)
+
+#define CONTACT_MAP_FLAG "-n"
+
+#define INITIAL_PAIRS_CAPACITY 1024
+
+#define RMSD_FLAG "-x"
+
+#define RMSD_MAGIC "APRMSD"
+
+#define RMSD_MAGIC_LEN 8
+
+#define RMSD_TILE_BYTES ((size_t) 1 << 20)
+
+#define RMSD_MIN_WORK_PER_THREAD (1 << 22)
+
+#define QCP_MAX_ITERATIONS 50
+
+#define QCP_PRECISION 1e-11
+
+#define HISTOGRAM_FLAG "-p"
+
+#define HISTOGRAM_MAX_BINS (1 << 24)
+
+#define SELECT_FLAG "-a"
+
+#define SELECT_MAX_VALUES 16
+
+#define SELECT_SEPARATORS " \t"
+
+#define ATOM_NAME_OFFSET 12
+
+#define ATOM_NAME_LEN 4
+
+#define RESIDUE_NAME_OFFSET 17
+
+#define RESIDUE_NAME_LEN 3
+
+#define CHAIN_OFFSET 21
+
+#define RESIDUE_NUMBER_OFFSET 22
+
+#define RESIDUE_NUMBER_LEN 4
+
+// ------------------------------ structures -----------------------------
+
+/**
+ * The coordinates of the atoms of a protein as a structure of arrays: atom i is (x[i], y[i], z[i]). Every array
+ * is aligned to ATOMS_ALIGNMENT bytes and its capacity is a multiple of ATOMS_ALIGNMENT / sizeof(float) floats, so
+ * kernels can run over whole vectors of coordinates.
+ */
+typedef struct
+{
+    float *x;
+    float *y;
+    float *z;
+    size_t size;
+    size_t capacity;
+} Atoms;
+
+/**
+ * A compiled selection of atoms: an atom is selected if it matches every field that has values, and a field matches
+ * if it is one of its values (chains, atom names, residue names) or in one of its ranges (residue numbers). HETATM
+ * records are selected only with hetatm. text is the selection as it was given, "" for none.
+ */
+typedef struct
+{
+    const char *text;
+    int hetatm;
+    size_t chainsNum;
+    char chains[SELECT_MAX_VALUES];
+    size_t namesNum;
+    char names[SELECT_MAX_VALUES][ATOM_NAME_LEN + 1];
+    size_t residueNamesNum;
+    char residueNames[SELECT_MAX_VALUES][RESIDUE_NAME_LEN + 1];
+    size_t rangesNum;
+    long ranges[SELECT_MAX_VALUES][2];
+} Selection;
+
+/**
+ * The options of a run: with threadsNum > 0 the files are analyzed on that many threads, a streaming run computes
+ * Cg and Rg while reading without keeping the atoms, and no Dmax, a per model run analyzes every model (MODEL ..
+ * ENDMDL) of a file on its own, the models are analyzed on the threads, a cached run reads and writes the atoms of
+ * the files in binary caches, with a cutoff > 0 the contacts of the atoms are counted too (and with contactMap the
+ * neighbors of every atom and the pairs in contact are kept) and with a binWidth > 0
+ * the histogram of the distances of all the pairs of atoms, P(r), is calculated with Dmax. With an rmsdMatrix
+ * the files are not analyzed, the RMSD of every pair of them is written to that file instead. Only the atoms of the
+ * selection are read.
+ */
+typedef struct
+{
+    int threadsNum;
+    int streaming;
+    int perModel;
+    int cache;
+    float cutoff;
+    int contactMap;
+    float binWidth;
+    const char *rmsdMatrix;
+    Selection selection;
+} Options;
+
+/**
+ * The header of the binary cache of the atoms of a PDB file (the file name and CACHE_SUFFIX). It takes the first
+ * CACHE_HEADER_SIZE bytes of the cache and is followed by the x, y and z of the atoms as three arrays of stride
+ * floats each. The cache is valid as long as the size of the source is the same and either its modification time or
+ * the hash of its content is the same, and the atoms were selected with the same selection (the hash of its text).
+ * The size, modification time and hash are taken while the atoms are parsed, so a source that changes after it is
+ * parsed makes the cache stale. The numbers are in the byte order of the machine that wrote the cache.
+ */
+typedef struct
+{
+    char magic[CACHE_MAGIC_LEN];
+    uint32_t version;
+    uint32_t headerSize;
+    uint64_t numOfAtoms;
+    uint64_t stride;
+    uint64_t sourceSize;
+    int64_t sourceModifiedSec;
+    int64_t sourceModifiedNsec;
+    uint64_t sourceHash;
+    uint64_t selectionHash;
+} CacheHeader;
+
+/**
+ * Two atoms in contact by their indices in the order they were read, first < second
+ */
+typedef struct
+{
+    size_t first;
+    size_t second;
+    float squaredDistance;
+} ContactPair;
+
+/**
+ * The contacts of a set of atoms: the pairs closer than the cutoff, the most neighbors (atoms in contact) of an atom
+ * and the clashes, pairs closer than CLASH_DISTANCE. With a contact map neighbors[i] is the number of neighbors of
+ * atom i and pairs are the pairsNum pairs in contact sorted by their atoms, otherwise both are NULL.
+ */
+typedef struct
+{
+    size_t contacts;
+    size_t maxNeighbors;
+    size_t clashes;
+    size_t *neighbors;
+    ContactPair *pairs;
+    size_t pairsNum;
+    size_t pairsCapacity;
+} Contacts;
+
+/**
+ * A uniform grid over the atoms with cells of at least the cutoff on every side, so the atoms in contact with an atom
+ * are in its cell or in the 26 cells around it. The atoms of cell c are cellAtoms[cellStart[c] .. cellStart[c + 1]).
+ */
+typedef struct
+{
+    float origin[NUM_OF_COORDS];
+    float cellSize;
+    size_t dims[NUM_OF_COORDS];
+    size_t cellsNum;
+    size_t *cellStart;
+    size_t *cellAtoms;
+} SpatialGrid;
+
+/**
+ * The cells firstCell .. lastCell - 1 of the grid that one thread of the contacts counts, with what it found. With a
+ * contact map the task writes the neighbors of the atoms of its cells to the shared neighbors of its contacts and
+ * keeps the pairs it found in pairs of its own, failed is set if there was no memory for them.
+ */
+typedef struct
+{
+    const Atoms *atoms;
+    const SpatialGrid *grid;
+    float cutoff;
+    size_t firstCell;
+    size_t lastCell;
+    Contacts contacts;
+    int failed;
+    pthread_t thread;
+    int started;
+} ContactsTask;
+
+/**
+ * The histogram of the distances between the pairs of atoms, P(r): counts[b] is the number of pairs whose distance is
+ * in [b * binWidth, (b + 1) * binWidth)
+ */
+typedef struct
+{
+    float binWidth;
+    size_t binsNum;
+    uint64_t *counts;
+} PairHistogram;
+
+/**
+ * The all vs all RMSD of structures with the same number of atoms, every structure is centered and squares is the
+ * sum of its squared coordinates. The pairs are compared in tiles of tileSize x tileSize structures, so the structures
+ * of a tile stay in the cache, the workers take the next tile of the upper triangle. matrix is filesNum x filesNum.
+ */
+typedef struct
+{
+    const Atoms *structures;
+    const double *squares;
+    size_t filesNum;
+    size_t tileSize;
+    size_t tilesPerSide;
+    size_t next;
+    double *matrix;
+    pthread_mutex_t lock;
+} RmsdPool;
+
+/**
+ * The header of an RMSD matrix file, it is followed by the filesNum x filesNum RMSDs as doubles, row by row in the
+ * order of the files. The numbers are in the byte order of the machine that wrote the file.
+ */
+typedef struct
+{
+    char magic[RMSD_MAGIC_LEN];
+    uint64_t filesNum;
+    uint64_t numOfAtoms;
+} RmsdHeader;
+
+/**
+ * The analysis of one file: its results if result is 0, and the reason of the failure if result is FAILURE. done is
+ * set once the analysis is complete.
+ */
+typedef struct
+{
+    const char *fileName;
+    const Options *options;
+    size_t numOfAtoms;
+    float cg[NUM_OF_COORDS];
+    float rg;
+    float dMax;
+    Contacts contacts;
+    PairHistogram histogram;
+    int result;
+    char error[ERROR_LEN];
+    int done;
+} Analysis;
+
+/**
+ * The files of a parallel run, the workers take the next file to analyze and signal analyzed when they are done
+ * with it
+ */
+typedef struct
+{
+    Analysis *analyses;
+    size_t analysesNum;
+    size_t next;
+    pthread_mutex_t lock;
+    pthread_cond_t analyzed;
+} AnalysisPool;
+
+/**
+ * A kernel of the brute force Dmax, the largest squared distance between atom row and the atoms begin .. end - 1
+ */
+typedef float (*RowKernel)(const Atoms *atoms, size_t row, size_t begin, size_t end);
+
+/**
+ * A kernel of P(r), it adds the distances between atom row and the atoms begin .. end - 1 to counts, a histogram
+ * with the bins of histogram, and returns the largest squared distance
+ */
+typedef float (*HistogramKernel)(const Atoms *atoms, size_t row, size_t begin, size_t end,
+                                 const PairHistogram *histogram, uint64_t *counts);
+
+/**
+ * The rows firstRow .. lastRow - 1 of the triangle of pairs that one thread of the brute force Dmax compares, max is
+ * the largest squared distance it found. With a histogram the distances are added to counts too, the task's own
+ * histogram or the one of the first task.
+ */
+typedef struct
+{
+    const Atoms *atoms;
+    RowKernel kernel;
+    HistogramKernel histogramKernel;
+    const PairHistogram *histogram;
+    uint64_t *counts;
+    size_t firstRow;
+    size_t lastRow;
+    float max;
+    pthread_t thread;
+    int started;
+} DmaxTask;
+
+/**
+ * The running center of mass of the atoms read so far and the sum of their squared distances from it, in double
+ */
+typedef struct
+{
+    size_t count;
+    double mean[NUM_OF_COORDS];
+    double sumOfSquares;
+} Moments;
+
+/**
+ * What a cache of a source file is checked against: the status of the file and the hash of its content as they were
+ * when its atoms were parsed. It is valid only if the file was mapped and did not change while it was parsed.
+ */
+typedef struct
+{
+    struct stat status;
+    uint64_t hash;
+    int valid;
+} SourceStamp;
+
+/**
+ * Where the parsers put the atoms they read: they are appended to atoms and added to moments, either may be NULL. If
+ * endModel is not NULL it is called at every ENDMDL record and may replace atoms and moments. Only the atoms of the
+ * selection are read, every ATOM record if it is NULL. If stamp is not NULL it is filled with the stamp of the
+ * source file for its cache.
+ */
+typedef struct AtomSink
+{
+    Atoms *atoms;
+    Moments *moments;
+    int (*endModel)(struct AtomSink *sink);
+    void *context;
+    const Selection *selection;
+    SourceStamp *stamp;
+} AtomSink;
+
+/**
+ * A model of a trajectory in one of the buffers of the trajectory, with its results once state is FRAME_ANALYZED
+ */
+typedef struct
+{
+    Atoms atoms;
+    Moments moments;
+    long model;
+    float cg[NUM_OF_COORDS];
+    float rg;
+    float dMax;
+    int state;
+} Frame;
+
+/**
+ * A file that is analyzed model by model. The models are read into a ring of framesNum frames: model i is read into
+ * frame i % framesNum once model i - framesNum is printed, the workers analyze the models that were read in order
+ * and the models are printed in order as soon as they are analyzed.
+ */
+typedef struct
+{
+    const char *fileName;
+    const Options *options;
+    Frame *frames;
+    size_t framesNum;
+    long readNum;
+    long analyzedNext;
+    long printedNum;
+    int finished;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+} Trajectory;
+
+/**
+ * A growable array of indices
+ */
+typedef struct
+{
+    size_t *indices;
+    size_t size;
+    size_t capacity;
+} Indices;
+
+/**
+ * A triangle of the convex hull, its vertices are counter clockwise seen from outside and its normal points out.
+ * outside holds the atoms that are outside of it and not yet in the hull.
+ */
+typedef struct
+{
+    size_t vertices[3];
+    double normal[NUM_OF_COORDS];
+    double offset;
+    size_t *outside;
+    size_t outsideNum;
+    size_t outsideCapacity;
+    int alive;
+} HullFace;
+
+/**
+ * A convex hull under construction, the atoms closer than epsilon to the outside of a face are inside. work counts
+ * the faces tested so far and the construction gives up past maxWork.
+ */
+typedef struct
+{
+    const Atoms *atoms;
+    HullFace *faces;
+    size_t facesNum;
+    size_t facesCapacity;
+    double epsilon;
+    size_t work;
+    size_t maxWork;
+} Hull;
+
 // ------------------------------ functions -----------------------------
 
 /**
- * This function is given a single ATOM line and an array and converts the coordinates of the given atom from the
- * given text to floats and places them in the given array.
+ *This function allocates an array of the given number of floats aligned to ATOMS_ALIGNMENT bytes
  *
- * @param atom - an array it will contains the three coordinates of the given "atom"
- * @param textLine - string (line) , which contains the relevant information to analyze the atom
+ * @param capacity - The number of floats, a multiple of ATOMS_ALIGNMENT / sizeof(float)
+ * @return The array or NULL if there is no memory
  */
-void createCoordinates(float *atom, char *textLine)
+float *allocateCoordinates(size_t capacity)
 {
-    int j, k;
-    float curFloatCoord;
-    char *coord = NULL;
-    char curCoord[LEN_OF_COORD + 1];
-    errno = 0;
-    for (j = 0, k = 0; j < NUM_OF_COORDS; j++, k += LEN_OF_COORD)
-    {
-        strncpy(curCoord, textLine + (30 + k), 8);
-        curFloatCoord = strtof(curCoord, &coord);
-        if (curFloatCoord == 0 && (errno != 0 || coord == curCoord))// the conversion failed
-        {
-            fprintf(stderr, "Error in coordinate conversion %s!\n", curCoord);
-            exit(EXIT_FAILURE);
-        }
-        atom[j] = strtof(curCoord, (char **) coord);
-    }
+    return (float *) aligned_alloc(ATOMS_ALIGNMENT, capacity * sizeof(float));
 }
 
 /**
- *This function is given pointer to an array(2D) and changes it's content, for every  i between 0 to MAX_LINES
- * atoms[i] = [x , y , z] which x,y,z are the coordinates of the atoms i.
+ *This function frees the coordinates of the given atoms
  *
- * @param myFile - The file which contains the text to be analyzed
- * @param atoms - 2D array which contains the coordinates of each atom
- * @return The number of atoms that were read from the given file
+ * @param atoms - The atoms
  */
-int createAtoms(FILE *myFile, float atoms[MAX_LINES][NUM_OF_COORD])
+void freeAtoms(Atoms *atoms)
 {
-    char textLine[LEN_OF_LINE];
-    char curWord[FLAG_LEN];
-    int numOfAtoms = 0;
-    while (!feof(myFile))
-    {
-        fgets(textLine, LEN_OF_LINE, myFile);
-        strncpy(curWord, textLine, WORD_LEN);
-        size_t lineLen = strlen(textLine);
-        if (strcmp(curWord, ATOM_FLAG) == 0)
-        {
-            if (lineLen <= MIN_LINE_LEN)
-            {
-                fprintf(stderr, "ATOM line is too short %zu characters\n", lineLen);
-                exit(EXIT_FAILURE);
-            }
-            createCoordinates(atoms[numOfAtoms], textLine);
-            numOfAtoms++;
-            if (numOfAtoms >= MAX_LINES)
-            {
-                break;
-            }
-        }
-    }
-    return numOfAtoms;
+    free(atoms->x);
+    free(atoms->y);
+    free(atoms->z);
+    atoms->x = atoms->y = atoms->z = NULL;
+    atoms->size = atoms->capacity = 0;
 }
 
 /**
- *This function calculates the Center of mass of the protein base on the given arguments
+ *This function doubles the capacity of the given atoms (the first growth allocates INITIAL_ATOMS_CAPACITY atoms).
  *
- * @param numOfAtoms - The number of atoms that appears in the file
- * @param atoms - 2D array which contains the coordinates of each atom
- * @param cg - Three coordinates of the Center of mass
+ * @param atoms - The atoms
+ * @return if successful returns 0 and FAILURE if there is no memory, the atoms are kept either way
  */
-void createCg(int numOfAtoms, float atoms[MAX_LINES][NUM_OF_COORD], float cg[NUM_OF_COORDS])
+int growAtoms(Atoms *atoms)
 {
-    int i, j;
-    float sumOfCoordinates = 0;
-    for (j = 0; j < NUM_OF_COORD; j++)
+    size_t capacity = atoms->capacity == 0 ? INITIAL_ATOMS_CAPACITY : 2 * atoms->capacity;
+    float *x = allocateCoordinates(capacity);
+    float *y = allocateCoordinates(capacity);
+    float *z = allocateCoordinates(capacity);
+    if (x == NULL || y == NULL || z == NULL)
     {
-        for (i = 0; i < numOfAtoms; i++)
-        {
-            sumOfCoordinates += atoms[i][j];
-        }
-        cg[j] = (sumOfCoordinates / numOfAtoms);
-        sumOfCoordinates = 0;
+        free(x);
+        free(y);
+        free(z);
+        return FAILURE;
     }
+    if (atoms->size > 0)
+    {
+        memcpy(x, atoms->x, atoms->size * sizeof(float));
+        memcpy(y, atoms->y, atoms->size * sizeof(float));
+        memcpy(z, atoms->z, atoms->size * sizeof(float));
+    }
+    free(atoms->x);
+    free(atoms->y);
+    free(atoms->z);
+    atoms->x = x;
+    atoms->y = y;
+    atoms->z = z;
+    atoms->capacity = capacity;
+    return 0;
 }
 
 /**
- *This function is given the number of atoms in the protein, an array that contains the atoms coordinates and the
- * three coordinates of the Center of mass, and base on the given arguments calculates the The Radius of gyration.
+ *This function appends an atom to the given atoms
  *
- * @param numOfAtoms - The number of atoms that appears in the file
- * @param atoms - 2D array which contains the coordinates of each atom
- * @param cg - Three coordinates of the Center of mass
- * @return The Radius of gyration
+ * @param atoms - The atoms
+ * @param coordinates - The three coordinates of the atom
+ * @return if successful returns 0 and FAILURE if there is no memory
  */
-float getRg(int numOfAtoms, float atoms[MAX_LINES][NUM_OF_COORDS], float *cg)
+int appendAtom(Atoms *atoms, const float coordinates[NUM_OF_COORDS])
 {
-    int i, j;
-    float curSum = 0;
-    for (i = 0; i < numOfAtoms; i++)
+    if (atoms->size == atoms->capacity && growAtoms(atoms) == FAILURE)
     {
-        for (j = 0; j < NUM_OF_COORDS; j++)
-        {
-            curSum += powf(cg[j] - atoms[i][j], 2);
-        }
+        return FAILURE;
     }
-    curSum = sqrtf(curSum / numOfAtoms); // numOfAtom != 0
-    return curSum;
+    atoms->x[atoms->size] = coordinates[0];
+    atoms->y[atoms->size] = coordinates[1];
+    atoms->z[atoms->size] = coordinates[2];
+    atoms->size++;
+    return 0;
 }
 
 /**
- *This function is given an array(2D) that contain the coordinates of each atom and number of atoms in the protein
- * and calculates the maximum distance of all the atoms in the protein and returns it.
+ *This function adds an atom to the running moments with Welford's update: the mean moves by its share of the
+ * distance of the atom from it, and the sum of squared distances from the mean grows by the product of the distances
+ * from the old and the new mean, so there is no cancellation between large sums.
  *
- * @param atoms - 2D array which contains the coordinates of each atom
- * @param numOfAtoms - The number of atoms that appears in the file
- * @return The maximum distance within the protein : the max distance of all the atoms in the protein
+ * @param moments - The moments
+ * @param coordinates - The three coordinates of the atom
  */
-float getDmax(float atoms[MAX_LINES][NUM_OF_COORDS], int numOfAtoms)
+void addMoments(Moments *moments, const float coordinates[NUM_OF_COORDS])
 {
-    int i, j, k;
-    float curSum = 0, max = 0, curMax = 0;
-    for (i = 0; i < numOfAtoms; i++)
+    int j;
+    moments->count++;
+    for (j = 0; j < NUM_OF_COORDS; j++)
     {
-        for (k = 1; k < numOfAtoms; k++)
-        {
-            for (j = 0; j < NUM_OF_COORDS; j++)
-            {
-                curSum += powf(atoms[i][j] - atoms[k][j], 2);
-            }
-            curMax = sqrtf(curSum);
-            if (curMax > max)
-            {
-                max = curMax;
-            }
-            curSum = 0;
-        }
+        double delta = coordinates[j] - moments->mean[j];
+        moments->mean[j] += delta / (double) moments->count;
+        moments->sumOfSquares += delta * (coordinates[j] - moments->mean[j]);
     }
-    return max;
 }
 
 /**
- *This function prints the output of the analysis.
+ *This function calculates the Center of mass and the Radius of gyration of the atoms in the given moments
  *
- * @param fileName - The name of the file which is being analyzed
- * @param numOfAtoms - The number of atoms that appears in the file
+ * @param moments - The moments of at least one atom
  * @param cg - Three coordinates of the Center of mass
- * @param rg - The Radius of gyration
- * @param dMax - The maximum distance within the protein : the max distance of all the atoms in the protein
+ * @param rg - Container for the Radius of gyration
  */
-void printOutput(const char *fileName, int numOfAtoms, const float *cg, float rg, float dMax)
+void getMomentsResults(const Moments *moments, float cg[NUM_OF_COORDS], float *rg)
 {
-    printf("PDB file %s, %d atoms were read\n", fileName, numOfAtoms);
-    printf("Cg = %.3f %.3f %.3f\n", cg[0], cg[1], cg[2]);
-    printf("Rg = %.3f\n", rg);
-    printf("Dmax = %.3f\n", dMax);
+    cg[0] = (float) moments->mean[0];
+    cg[1] = (float) moments->mean[1];
+    cg[2] = (float) moments->mean[2];
+    *rg = (float) sqrt(moments->sumOfSquares / (double) moments->count);
 }
 
 /**
- *This function is given a file (which contains text), the function reads the file and performs mathematical
- * manipulations on the text in order to analyze it.
+ *This function stores an atom that was read in the atoms and the moments of the given sink
  *
- * @param myFile - The file which contains the text to be analyzed
- * @param fileName - The name of the file which is being analyzed
- * @return if successful returns 0 and int != 0 otherwise
+ * @param sink - The sink
+ * @param coordinates - The three coordinates of the atom
+ * @return if successful returns 0 and FAILURE if there is no memory
  */
-int analyzeInput(const FILE *myFile, char *fileName)
+int storeAtom(AtomSink *sink, const float coordinates[NUM_OF_COORDS])
 {
-    float atoms[MAX_LINES][NUM_OF_COORD];
-    int numOfAtoms = createAtoms((FILE *) myFile, atoms);
-    if (numOfAtoms == 0)
+    if (sink->moments != NULL)
     {
-        fprintf(stderr, "Error - 0 atoms were found in the file %s\n", fileName);
-        return FAILURE;
+        addMoments(sink->moments, coordinates);
     }
-    float cg[NUM_OF_COORD];
-    createCg(numOfAtoms, atoms, cg);
-    float rg = getRg(numOfAtoms, atoms, cg);
-    float dMax = getDmax(atoms, numOfAtoms);
-    printOutput(fileName, numOfAtoms, cg, rg, dMax);
-    fclose((FILE *) myFile);
-    return 0;
+    return sink->atoms != NULL ? appendAtom(sink->atoms, coordinates) : 0;
 }
 
+/**
+ *This function appends an index to the given indices
+ *
+ * @return if successful returns 0 and FAILURE if there is no memory
+ */
+int appendIndex(Indices *indices, size_t index)
+{
+    if (indices->size == indices->capacity)
+    {
+        size_t capacity = indices->capacity == 0 ? HULL_INITIAL_CAPACITY : 2 * indices->capacity;
+        size_t *grown = (size_t *) realloc(indices->indices, capacity * sizeof(size_t));
+        if (grown == NULL)
+        {
+            return FAILURE;
+        }
+        indices->indices = grown;
+        indices->capacity = capacity;
+    }
+    indices->indices[indices->size++] = index;
+    return 0;
+}
 
 /**
- *Runs the AnalyzeProtein program
+ *This function converts a coordinate field in the fixed format of PDB files (%8.3f) to a float. The digits form an
+ * integer below 2^24 that is exact as a float, so dividing it by COORD_SCALE rounds once and gives exactly what
+ * strtof gives.
  *
- * @return if successful returns 0 and 1 otherwise
+ * @param field - The LEN_OF_COORD characters of the coordinate
+ * @param coordinate - Container for the coordinate
+ * @return if successful returns 0 and FAILURE if the field is not in the fixed format
  */
-int main(int argc, char **argv)
+int decodeCoordinate(const char *field, float *coordinate)
 {
-    if (argc <= 1) // Too few arguments
+    int i = 0, negative = 0;
+    long value = 0;
+    while (i < POINT_OFFSET && field[i] == ' ')
+    {
+        i++;
+    }
+    if (i < POINT_OFFSET && field[i] == '-')
+    {
+        negative = 1;
+        i++;
+    }
+    if (i == POINT_OFFSET || field[POINT_OFFSET] != '.') // no integer digits or not 3 decimals
     {
-        fprintf(stdout, "Usage: AnalyzeProtein <pdb1> <pdb2> ...\n");
         return FAILURE;
     }
-    for (int i = 1; i < argc; ++i)
+    for (; i < LEN_OF_COORD; i++)
     {
-        FILE *myFile = fopen(argv[i], "r");
-        if (myFile == NULL)
+        unsigned int digit = (unsigned int) (field[i] - '0');
+        if (i == POINT_OFFSET)
         {
-            fprintf(stderr, "Error opening file: %s\n", argv[i]);
-            return FAILURE;
+            continue;
         }
-        int result = analyzeInput(myFile, argv[i]);
-        if (result == FAILURE) // failed to analyze the file
+        if (digit > 9)
         {
             return FAILURE;
         }
+        value = value * 10 + digit;
     }
+    *coordinate = (negative ? -(float) value : (float) value) / COORD_SCALE;
     return 0;
 }
+
+/**
+ * This function is given a single ATOM line and an array and converts the coordinates of the given atom from the
+ * given text to floats and places them in the given array. Coordinates that are not in the fixed format are
+ * converted with strtof.
+ *
+ * @param atom - an array it will contains the three coordinates of the given "atom"
+ * @param textLine - string (line) , which contains the relevant information to analyze the atom, it need not be
+ * null terminated
+ * @param error - Container of ERROR_LEN characters for the reason of a failure
+ * @return if successful returns 0 and FAILURE if a coordinate is not a number
+ */
+int createCoordinates(float *atom, const char *textLine, char *error)
+{
+    int j, k;
+    float curFloatCoord;
+    char *coord = NULL;
+    char curCoord[LEN_OF_COORD + 1] = {0};
+    for (j = 0, k = 0; j < NUM_OF_COORDS; j++, k += LEN_OF_COORD)
+    {
+        if (decodeCoordinate(textLine + FIRST_COORD_OFFSET + k, &atom[j]) == 0)
+        {
+            continue;
+        }
+        errno = 0;
+        memcpy(curCoord, textLine + FIRST_COORD_OFFSET + k, LEN_OF_COORD);
+        curFloatCoord = strtof(curCoord, &coord);
+        if (curFloatCoord == 0 && (errno != 0 || coord == curCoord))// the conversion failed
+        {
+            snprintf(error, ERROR_LEN, "Error in coordinate conversion %s!", curCoord);
+            return FAILURE;
+        }
+        atom[j] = curFloatCoord;
+    }
+    return 0;
+}
+
+/**
+ *This function copies a value of a selection into the given buffer, if it fits
+ *
+ * @param value - The value, it need not be null terminated
+ * @param len - The length of the value
+ * @param buffer - Container of maxLen + 1 characters for the value
+ * @return if successful returns 0 and FAILURE if the value is empty or longer than maxLen
+ */
+int copyValue(const char *value, size_t len, char *buffer, size_t maxLen)
+{
+    if (len == 0 || len > maxLen)
+    {
+        return FAILURE;
+    }
+    memcpy(buffer, value, len);
+    buffer[len] = '\0';
+    return 0;
+}
+
+/**
+ *This function compiles a term of a selection, a key and its values separated by commas, into the selection
+ *
+ * @param key - The key of the term, it need not be null terminated
+ * @param keyLen - The length of the key
+ * @param values - The values of the term, it need not be null terminated
+ * @param valuesLen - The length of the values
+ * @param selection - The selection
+ * @return if successful returns 0 and FAILURE if the term is invalid
+ */
+int compileTerm(const char *key, size_t keyLen, const char *values, size_t valuesLen, Selection *selection)
+{
+    const char *end = values + valuesLen;
+    while (values <= end)
+    {
+        const char *comma = (const char *) memchr(values, ',', (size_t) (end - values));
+        const char *valueEnd = comma == NULL ? end : comma;
+        size_t len = (size_t) (valueEnd - values);
+        if (keyLen == 5 && memcmp(key, "chain", keyLen) == 0 && len == 1 && selection->chainsNum < SELECT_MAX_VALUES)
+        {
+            selection->chains[selection->chainsNum++] = values[0];
+        }
+        else if (keyLen == 4 && memcmp(key, "name", keyLen) == 0 && selection->namesNum < SELECT_MAX_VALUES &&
+                 copyValue(values, len, selection->names[selection->namesNum], ATOM_NAME_LEN) == 0)
+        {
+            selection->namesNum++;
+        }
+        else if (keyLen == 4 && memcmp(key, "resn", keyLen) == 0 && selection->residueNamesNum < SELECT_MAX_VALUES &&
+                 copyValue(values, len, selection->residueNames[selection->residueNamesNum], RESIDUE_NAME_LEN) == 0)
+        {
+            selection->residueNamesNum++;
+        }
+        else if (keyLen == 4 && memcmp(key, "resi", keyLen) == 0 && selection->rangesNum < SELECT_MAX_VALUES)
+        {
+            // N or N-M, the numbers may be negative
+            char number[RESIDUE_NUMBER_LEN + 1 + RESIDUE_NUMBER_LEN + 1] = {0};
+            char *numberEnd;
+            long *range = selection->ranges[selection->rangesNum];
+            if (copyValue(values, len, number, sizeof(number) - 1) == FAILURE)
+            {
+                return FAILURE;
+            }
+            range[0] = strtol(number, &numberEnd, 10);
+            range[1] = range[0];
+            if (numberEnd != number && *numberEnd == '-')
+            {
+                char *rangeEnd = numberEnd + 1;
+                range[1] = strtol(rangeEnd, &numberEnd, 10);
+                numberEnd = numberEnd == rangeEnd ? number : numberEnd;
+            }
+            if (numberEnd == number || *numberEnd != '\0' || range[0] > range[1])
+            {
+                return FAILURE;
+            }
+            selection->rangesNum++;
+        }
+        else
+        {
+            return FAILURE;
+        }
+        values = valueEnd + 1;
+    }
+    return 0;
+}
+
+/**
+ *This function compiles a selection of atoms. A selection is terms separated by spaces that an atom must all match:
+ * chain=A,B (the chain is one of the values), resi=1-50,60 (the residue number is in one of the ranges),
+ * resn=ALA,GLY (residue names), name=CA,CB (atom names) and hetatm (HETATM records are read too). A key that is
+ * repeated adds to its values. The empty selection is every ATOM record.
+ *
+ * @param text - The selection, it is kept by the selection
+ * @param selection - Container for the compiled selection
+ * @return if successful returns 0 and FAILURE if the selection is invalid
+ */
+int compileSelection(const char *text, Selection *selection)
+{
+    memset(selection, 0, sizeof(Selection));
+    selection->text = text;
+    while (*text != '\0')
+    {
+        text += strspn(text, SELECT_SEPARATORS);
+        size_t termLen = strcspn(text, SELECT_SEPARATORS);
+        const char *equals = (const char *) memchr(text, '=', termLen);
+        if (termLen == 0)
+        {
+            break;
+        }
+        if (termLen == 6 && memcmp(text, "hetatm", termLen) == 0)
+        {
+            selection->hetatm = 1;
+        }
+        else if (equals == NULL ||
+                 compileTerm(text, (size_t) (equals - text), equals + 1, termLen - (size_t) (equals - text) - 1,
+                             selection) == FAILURE)
+        {
+            return FAILURE;
+        }
+        text += termLen;
+    }
+    return 0;
+}
+
+/**
+ *This function checks if a fixed column field of a PDB line, without its spaces, is one of the given names
+ *
+ * @param field - The field
+ * @param fieldLen - The length of the field
+ * @param names - The names, null terminated
+ * @param maxLen - The size of a name with its null
+ * @param namesNum - The number of names
+ * @return 1 if it is one of the names and 0 otherwise
+ */
+int matchName(const char *field, size_t fieldLen, const char *names, size_t maxLen, size_t namesNum)
+{
+    size_t i;
+    while (fieldLen > 0 && field[0] == ' ')
+    {
+        field++;
+        fieldLen--;
+    }
+    while (fieldLen > 0 && field[fieldLen - 1] == ' ')
+    {
+        fieldLen--;
+    }
+    for (i = 0; i < namesNum; i++)
+    {
+        const char *name = names + i * maxLen;
+        if (strlen(name) == fieldLen && memcmp(name, field, fieldLen) == 0)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ *This function checks if the atom of an ATOM or HETATM line is in the given selection, from the fixed columns of the
+ * line so that nothing is converted for the atoms that are not selected
+ *
+ * @param selection - The selection
+ * @param textLine - The line, it has at least MIN_LINE_LEN characters
+ * @return 1 if the atom is selected and 0 otherwise
+ */
+int selectAtom(const Selection *selection, const char *textLine)
+{
+    size_t i;
+    if (selection->chainsNum > 0 && memchr(selection->chains, textLine[CHAIN_OFFSET], selection->chainsNum) == NULL)
+    {
+        return 0;
+    }
+    if (selection->namesNum > 0 && !matchName(textLine + ATOM_NAME_OFFSET, ATOM_NAME_LEN, selection->names[0],
+                                              ATOM_NAME_LEN + 1, selection->namesNum))
+    {
+        return 0;
+    }
+    if (selection->residueNamesNum > 0 &&
+        !matchName(textLine + RESIDUE_NAME_OFFSET, RESIDUE_NAME_LEN, selection->residueNames[0], RESIDUE_NAME_LEN + 1,
+                   selection->residueNamesNum))
+    {
+        return 0;
+    }
+    if (selection->rangesNum == 0)
+    {
+        return 1;
+    }
+    char number[RESIDUE_NUMBER_LEN + 1] = {0};
+    char *numberEnd;
+    memcpy(number, textLine + RESIDUE_NUMBER_OFFSET, RESIDUE_NUMBER_LEN);
+    long residue = strtol(number, &numberEnd, 10);
+    for (i = 0; i < selection->rangesNum && numberEnd != number; i++)
+    {
+        if (residue >= selection->ranges[i][0] && residue <= selection->ranges[i][1])
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ *This function is given a line of a PDB file and stores the atom of an ATOM line (or a HETATM line if the selection
+ * has hetatm) in the given sink if it is selected, or ends the model of an ENDMDL line. Other lines are ignored.
+ *
+ * @param textLine - The line, it need not be null terminated
+ * @param lineLen - The length of the line with its new line
+ * @param sink - The sink
+ * @param error - Container of ERROR_LEN characters for the reason of a failure
+ * @return 1 if an atom was stored, 0 if not, -1 if there is no memory and MALFORMED_FILE if the ATOM line is malformed
+ */
+int parseLine(const char *textLine, size_t lineLen, AtomSink *sink, char *error)
+{
+    float coordinates[NUM_OF_COORDS];
+    int hetatm = sink->selection != NULL && sink->selection->hetatm && lineLen >= WORD_LEN &&
+                 memcmp(textLine, HETATM_FLAG, WORD_LEN) == 0;
+    if (hetatm || (lineLen >= WORD_LEN && memcmp(textLine, ATOM_FLAG, WORD_LEN) == 0))
+    {
+        if (lineLen <= MIN_LINE_LEN)
+        {
+            snprintf(error, ERROR_LEN, "%s line is too short %zu characters", hetatm ? "HETATM" : "ATOM", lineLen);
+            return MALFORMED_FILE;
+        }
+        if (sink->selection != NULL && !selectAtom(sink->selection, textLine))
+        {
+            return 0;
+        }
+        if (createCoordinates(coordinates, textLine, error) == FAILURE)
+        {
+            return MALFORMED_FILE;
+        }
+        return storeAtom(sink, coordinates) == FAILURE ? -1 : 1;
+    }
+    if (sink->endModel != NULL && lineLen >= WORD_LEN && memcmp(textLine, END_MODEL_FLAG, WORD_LEN) == 0)
+    {
+        return sink->endModel(sink) == FAILURE ? -1 : 0;
+    }
+    return 0;
+}
+
+/**
+ *This function reads the coordinates of every ATOM line of the given file into the given atoms, the atoms grow as
+ * needed so there is no limit to their number.
+ *
+ * @param myFile - The file which contains the text to be analyzed
+ * @param sink - Where the atoms of the file are stored
+ * @param error - Container of ERROR_LEN characters for the reason of a failure
+ * @return The number of atoms that were read from the given file, -1 if there is no memory and MALFORMED_FILE if an
+ * ATOM line is malformed
+ */
+long createAtoms(FILE *myFile, AtomSink *sink, char *error)
+{
+    char textLine[LEN_OF_LINE];
+    long numOfAtoms = 0;
+    while (fgets(textLine, LEN_OF_LINE, myFile) != NULL)
+    {
+        int stored = parseLine(textLine, strlen(textLine), sink, error);
+        if (stored < 0)
+        {
+            return stored;
+        }
+        numOfAtoms += stored;
+    }
+    return numOfAtoms;
+}
+
+/**
+ *This function reads the coordinates of every ATOM line of the given text, like createAtoms. The columns of a PDB
+ * line are fixed so only the line breaks are searched for (memchr) and the coordinates are read in place.
+ *
+ * @param text - The text of a PDB file, it need not be null terminated
+ * @param len - The length of the text
+ * @param sink - Where the atoms of the text are stored
+ * @param error - Container of ERROR_LEN characters for the reason of a failure
+ * @return The number of atoms that were read from the given text, -1 if there is no memory and MALFORMED_FILE if an
+ * ATOM line is malformed
+ */
+long parseAtoms(const char *text, size_t len, AtomSink *sink, char *error)
+{
+    const char *end = text + len;
+    long numOfAtoms = 0;
+    while (text < end)
+    {
+        const char *newLine = (const char *) memchr(text, '\n', (size_t) (end - text));
+        const char *lineEnd = newLine == NULL ? end : newLine;
+        size_t lineLen = (size_t) (lineEnd - text) + (newLine != NULL); // like fgets, the new line is counted
+        int stored = parseLine(text, lineLen, sink, error);
+        if (stored < 0)
+        {
+            return stored;
+        }
+        numOfAtoms += stored;
+        text = lineEnd + 1;
+    }
+    return numOfAtoms;
+}
+
+/**
+ *This function continues a hash with the given text 8 bytes at a time (FNV-1a on words), fast enough to check a
+ * source file. A text hashed in parts has the hash of the whole text if every part but the last is a multiple of 8
+ * bytes long.
+ *
+ * @param hash - The hash of the text before the given one
+ * @param text - The text
+ * @param len - The length of the text
+ * @return The hash of the text
+ */
+uint64_t extendHash(uint64_t hash, const char *text, size_t len)
+{
+    uint64_t word;
+    size_t i;
+    for (i = 0; i + sizeof(word) <= len; i += sizeof(word))
+    {
+        memcpy(&word, text + i, sizeof(word));
+        hash = (hash ^ word) * HASH_PRIME;
+    }
+    for (; i < len; i++)
+    {
+        hash = (hash ^ (unsigned char) text[i]) * HASH_PRIME;
+    }
+    return hash;
+}
+
+/**
+ *This function hashes the given text, see extendHash
+ *
+ * @param text - The text
+ * @param len - The length of the text
+ * @return The hash of the text
+ */
+uint64_t hashText(const char *text, size_t len)
+{
+    return extendHash(HASH_OFFSET, text, len);
+}
+
+/**
+ *This function reads the atoms of the given file by mapping it to memory and parsing it with parseAtoms. The file
+ * is parsed in windows of whole lines and the pages of every window are released after it, so a file that is only
+ * streamed through the moments does not stay in memory. The stamp of the sink, if any, gets the status of the file
+ * and the hash of the bytes as they were parsed, and is valid only if the file did not change while it was parsed.
+ *
+ * @param myFile - The file which contains the text to be analyzed
+ * @param sink - Where the atoms of the file are stored
+ * @param error - Container of ERROR_LEN characters for the reason of a failure
+ * @return The number of atoms that were read from the given file, -1 if there is no memory, MALFORMED_FILE if an
+ * ATOM line is malformed and NOT_MAPPED if the file can't be mapped (a pipe for example) and should be read with
+ * createAtoms
+ */
+long mapAtoms(FILE *myFile, AtomSink *sink, char *error)
+{
+    struct stat status;
+    int fd = fileno(myFile);
+    if (sink->stamp != NULL)
+    {
+        sink->stamp->valid = 0;
+    }
+    if (fstat(fd, &status) != 0 || !S_ISREG(status.st_mode) || status.st_size == 0)
+    {
+        return NOT_MAPPED;
+    }
+    size_t len = (size_t) status.st_size;
+    void *text = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (text == MAP_FAILED)
+    {
+        return NOT_MAPPED;
+    }
+    madvise(text, len, MADV_SEQUENTIAL);
+    const char *begin = (const char *) text, *end = begin + len;
+    size_t pageSize = (size_t) sysconf(_SC_PAGESIZE), released = 0, hashed = 0;
+    uint64_t hash = HASH_OFFSET;
+    long numOfAtoms = 0;
+    while (begin < end && numOfAtoms >= 0)
+    {
+        const char *windowEnd = (size_t) (end - begin) > MAP_WINDOW_SIZE ? begin + MAP_WINDOW_SIZE : end;
+        while (windowEnd < end && windowEnd > begin && windowEnd[-1] != '\n')
+        {
+            windowEnd--;
+        }
+        windowEnd = windowEnd == begin ? end : windowEnd; // a line longer than a window
+        long windowAtoms = parseAtoms(begin, (size_t) (windowEnd - begin), sink, error);
+        numOfAtoms = windowAtoms < 0 ? windowAtoms : numOfAtoms + windowAtoms;
+        if (sink->stamp != NULL)
+        {
+            // the parsed words are hashed before their pages are released, the rest of the text at the end
+            size_t words = windowEnd == end ? len : (size_t) (windowEnd - (const char *) text) / 8 * 8;
+            hash = extendHash(hash, (const char *) text + hashed, words - hashed);
+            hashed = words;
+        }
+        size_t parsed = (size_t) (windowEnd - (const char *) text) / pageSize * pageSize;
+        madvise((char *) text + released, parsed - released, MADV_DONTNEED);
+        released = parsed;
+        begin = windowEnd;
+    }
+    munmap(text, len);
+    if (sink->stamp != NULL)
+    {
+        struct stat after;
+        sink->stamp->status = status;
+        sink->stamp->hash = hash;
+        sink->stamp->valid = numOfAtoms >= 0 && fstat(fd, &after) == 0 && after.st_size == status.st_size &&
+                             after.st_mtim.tv_sec == status.st_mtim.tv_sec &&
+                             after.st_mtim.tv_nsec == status.st_mtim.tv_nsec;
+    }
+    return numOfAtoms;
+}
+
+/**
+ *This function opens the given file and reads its atoms into the given sink, with mapAtoms or with createAtoms if
+ * the file can't be mapped
+ *
+ * @param fileName - The name of the file
+ * @param sink - Where the atoms of the file are stored
+ * @param error - Container of ERROR_LEN characters for the reason of a failure
+ * @return The number of atoms that were read from the given file or a negative number if it failed, the reason is
+ * in error
+ */
+long readAtoms(const char *fileName, AtomSink *sink, char *error)
+{
+    FILE *myFile = fopen(fileName, "r");
+    if (myFile == NULL)
+    {
+        snprintf(error, ERROR_LEN, "Error opening file: %s", fileName);
+        return -1;
+    }
+    long numOfAtoms = mapAtoms(myFile, sink, error);
+    if (numOfAtoms == NOT_MAPPED)
+    {
+        numOfAtoms = createAtoms(myFile, sink, error);
+    }
+    fclose(myFile);
+    if (numOfAtoms == -1)
+    {
+        snprintf(error, ERROR_LEN, "Error - out of memory while reading the file %s", fileName);
+    }
+    return numOfAtoms;
+}
+
+/**
+ *This function hashes the content of the given file
+ *
+ * @param fileName - The name of the file
+ * @param status - The status of the file
+ * @param hash - Container for the hash
+ * @return if successful returns 0 and FAILURE if the file can't be mapped
+ */
+int hashFile(const char *fileName, const struct stat *status, uint64_t *hash)
+{
+    int fd = open(fileName, O_RDONLY);
+    if (fd < 0)
+    {
+        return FAILURE;
+    }
+    size_t len = (size_t) status->st_size;
+    void *text = len > 0 ? mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+    close(fd);
+    if (text == MAP_FAILED)
+    {
+        return FAILURE;
+    }
+    *hash = hashText((const char *) text, len);
+    if (text != NULL)
+    {
+        munmap(text, len);
+    }
+    return 0;
+}
+
+/**
+ *This function maps the cache of the given file if it is valid, its atoms are used in place
+ *
+ * @param fileName - The name of the source file
+ * @param atoms - Container for the atoms of the cache, they must not grow or be freed
+ * @param mapping - Container for the mapping of the cache, to unmap with munmap after the atoms are used
+ * @param mappingLen - Container for the length of the mapping
+ * @return if the cache is valid returns 0 and FAILURE if it is missing, stale or corrupt
+ */
+int loadCache(const char *fileName, const Selection *selection, Atoms *atoms, void **mapping, size_t *mappingLen)
+{
+    char cachePath[PATH_MAX];
+    struct stat source, status;
+    if (snprintf(cachePath, PATH_MAX, "%s%s", fileName, CACHE_SUFFIX) >= PATH_MAX || stat(fileName, &source) != 0)
+    {
+        return FAILURE;
+    }
+    int fd = open(cachePath, O_RDONLY);
+    if (fd < 0)
+    {
+        return FAILURE;
+    }
+    if (fstat(fd, &status) != 0 || (size_t) status.st_size < CACHE_HEADER_SIZE)
+    {
+        close(fd);
+        return FAILURE;
+    }
+    size_t len = (size_t) status.st_size;
+    void *cache = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (cache == MAP_FAILED)
+    {
+        return FAILURE;
+    }
+    const CacheHeader *header = (const CacheHeader *) cache;
+    uint64_t hash;
+    int valid = memcmp(header->magic, CACHE_MAGIC, CACHE_MAGIC_LEN) == 0 && header->version == CACHE_VERSION &&
+                header->headerSize == CACHE_HEADER_SIZE && header->stride >= header->numOfAtoms &&
+                header->stride % (ATOMS_ALIGNMENT / sizeof(float)) == 0 &&
+                header->stride <= (len - CACHE_HEADER_SIZE) / (NUM_OF_COORDS * sizeof(float)) &&
+                header->sourceSize == (uint64_t) source.st_size &&
+                header->selectionHash == hashText(selection->text, strlen(selection->text));
+    if (valid && (header->sourceModifiedSec != (int64_t) source.st_mtim.tv_sec ||
+                  header->sourceModifiedNsec != (int64_t) source.st_mtim.tv_nsec))
+    {
+        // the source was touched, it is still the same if its content is
+        valid = hashFile(fileName, &source, &hash) == 0 && hash == header->sourceHash;
+    }
+    if (!valid)
+    {
+        munmap(cache, len);
+        return FAILURE;
+    }
+    float *coordinates = (float *) ((char *) cache + CACHE_HEADER_SIZE);
+    atoms->x = coordinates;
+    atoms->y = coordinates + header->stride;
+    atoms->z = coordinates + 2 * header->stride;
+    atoms->size = (size_t) header->numOfAtoms;
+    atoms->capacity = (size_t) header->stride;
+    *mapping = cache;
+    *mappingLen = len;
+    return 0;
+}
+
+/**
+ *This function writes the cache of the given file, the cache is written to a temporary file that replaces the cache
+ * once it is complete. Failing to write the cache is not an error of the analysis so it fails silently.
+ *
+ * @param fileName - The name of the source file
+ * @param stamp - The stamp of the source file taken when its atoms were parsed, no cache is written if it is invalid
+ * @param atoms - The atoms of the source file
+ */
+void writeCache(const char *fileName, const Selection *selection, const SourceStamp *stamp, const Atoms *atoms)
+{
+    char cachePath[PATH_MAX], tempPath[PATH_MAX];
+    const struct stat *source = &stamp->status;
+    CacheHeader header;
+    char headerBlock[CACHE_HEADER_SIZE] = {0};
+    const float padding[ATOMS_ALIGNMENT / sizeof(float)] = {0};
+    size_t perVector = ATOMS_ALIGNMENT / sizeof(float), j;
+    size_t stride = (atoms->size + perVector - 1) / perVector * perVector;
+    if (!stamp->valid || snprintf(cachePath, PATH_MAX, "%s%s", fileName, CACHE_SUFFIX) >= PATH_MAX ||
+        snprintf(tempPath, PATH_MAX, "%s%s", cachePath, CACHE_TEMP_SUFFIX) >= PATH_MAX)
+    {
+        return;
+    }
+    memcpy(header.magic, CACHE_MAGIC, CACHE_MAGIC_LEN);
+    header.version = CACHE_VERSION;
+    header.headerSize = CACHE_HEADER_SIZE;
+    header.numOfAtoms = atoms->size;
+    header.stride = stride;
+    header.sourceSize = (uint64_t) source->st_size;
+    header.sourceModifiedSec = (int64_t) source->st_mtim.tv_sec;
+    header.sourceModifiedNsec = (int64_t) source->st_mtim.tv_nsec;
+    header.sourceHash = stamp->hash;
+    header.selectionHash = hashText(selection->text, strlen(selection->text));
+    memcpy(headerBlock, &header, sizeof(header));
+
+    int fd = mkstemp(tempPath);
+    if (fd < 0)
+    {
+        return;
+    }
+    fchmod(fd, source->st_mode & (S_IRWXU | S_IRWXG | S_IRWXO)); // mkstemp makes it private
+    FILE *cache = fdopen(fd, "wb");
+    int failed = cache == NULL || fwrite(headerBlock, 1, CACHE_HEADER_SIZE, cache) != CACHE_HEADER_SIZE;
+    const float *arrays[NUM_OF_COORDS] = {atoms->x, atoms->y, atoms->z};
+    for (j = 0; j < NUM_OF_COORDS && !failed; j++)
+    {
+        failed = fwrite(arrays[j], sizeof(float), atoms->size, cache) != atoms->size ||
+                 fwrite(padding, sizeof(float), stride - atoms->size, cache) != stride - atoms->size;
+    }
+    failed |= cache == NULL ? close(fd) != 0 : fclose(cache) != 0;
+    if (failed || rename(tempPath, cachePath) != 0)
+    {
+        unlink(tempPath);
+    }
+}
+
+/**
+ *This function sums the given coordinates in double, a float sum drifts by whole Angstroms over a million atoms
+ *
+ * @param coordinates - The coordinates
+ * @param numOfAtoms - The number of coordinates
+ * @return The sum of the coordinates
+ */
+double sumCoordinates(const float *coordinates, size_t numOfAtoms)
+{
+    size_t i;
+    double sumOfCoordinates = 0;
+    for (i = 0; i < numOfAtoms; i++)
+    {
+        sumOfCoordinates += coordinates[i];
+    }
+    return sumOfCoordinates;
+}
+
+/**
+ *This function calculates the Center of mass of the protein base on the given arguments
+ *
+ * @param atoms - The coordinates of the atoms, there is at least one
+ * @param cg - Three coordinates of the Center of mass
+ */
+void createCg(const Atoms *atoms, float cg[NUM_OF_COORDS])
+{
+    cg[0] = (float) (sumCoordinates(atoms->x, atoms->size) / (double) atoms->size);
+    cg[1] = (float) (sumCoordinates(atoms->y, atoms->size) / (double) atoms->size);
+    cg[2] = (float) (sumCoordinates(atoms->z, atoms->size) / (double) atoms->size);
+}
+
+/**
+ *This function is given the atoms of the protein and the three coordinates of the Center of mass, and base on the
+ * given arguments calculates the The Radius of gyration. The squared distances are summed in double, as in Moments.
+ *
+ * @param atoms - The coordinates of the atoms, there is at least one
+ * @param cg - Three coordinates of the Center of mass
+ * @return The Radius of gyration
+ */
+float getRg(const Atoms *atoms, const float *cg)
+{
+    size_t i;
+    double curSum = 0;
+    for (i = 0; i < atoms->size; i++)
+    {
+        double dx = (double) cg[0] - atoms->x[i], dy = (double) cg[1] - atoms->y[i], dz = (double) cg[2] - atoms->z[i];
+        curSum += dx * dx + dy * dy + dz * dz;
+    }
+    return (float) sqrt(curSum / (double) atoms->size); // numOfAtom != 0
+}
+
+/**
+ *This function calculates the largest squared distance between atom row and the atoms begin .. end - 1
+ *
+ * @param atoms - The coordinates of the atoms
+ * @return The largest squared distance, 0 if there are no atoms in the range
+ */
+float maxSquaredDistance(const Atoms *atoms, size_t row, size_t begin, size_t end)
+{
+    size_t k;
+    float max = 0;
+    for (k = begin; k < end; k++)
+    {
+        float dx = atoms->x[row] - atoms->x[k], dy = atoms->y[row] - atoms->y[k], dz = atoms->z[row] - atoms->z[k];
+        float curSum = dx * dx + dy * dy + dz * dz;
+        if (curSum > max)
+        {
+            max = curSum;
+        }
+    }
+    return max;
+}
+
+#ifdef DMAX_X86
+
+/**
+ *This function is maxSquaredDistance with eight atoms per AVX2 vector
+ */
+__attribute__((target("avx2"))) float maxSquaredDistanceAvx2(const Atoms *atoms, size_t row, size_t begin, size_t end)
+{
+    float lanes[8];
+    size_t k, j;
+    __m256 x = _mm256_set1_ps(atoms->x[row]), y = _mm256_set1_ps(atoms->y[row]), z = _mm256_set1_ps(atoms->z[row]);
+    __m256 max = _mm256_setzero_ps();
+    for (k = begin; k + 8 <= end; k += 8)
+    {
+        __m256 dx = _mm256_sub_ps(x, _mm256_loadu_ps(atoms->x + k));
+        __m256 dy = _mm256_sub_ps(y, _mm256_loadu_ps(atoms->y + k));
+        __m256 dz = _mm256_sub_ps(z, _mm256_loadu_ps(atoms->z + k));
+        __m256 curSum = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)),
+                                      _mm256_mul_ps(dz, dz));
+        max = _mm256_max_ps(max, curSum);
+    }
+    _mm256_storeu_ps(lanes, max);
+    float result = maxSquaredDistance(atoms, row, k, end);
+    for (j = 0; j < 8; j++)
+    {
+        result = lanes[j] > result ? lanes[j] : result;
+    }
+    return result;
+}
+
+/**
+ *This function is maxSquaredDistance with sixteen atoms per AVX-512 vector
+ */
+__attribute__((target("avx512f"))) float maxSquaredDistanceAvx512(const Atoms *atoms, size_t row, size_t begin,
+                                                                  size_t end)
+{
+    size_t k;
+    __m512 x = _mm512_set1_ps(atoms->x[row]), y = _mm512_set1_ps(atoms->y[row]), z = _mm512_set1_ps(atoms->z[row]);
+    __m512 max = _mm512_setzero_ps();
+    for (k = begin; k + 16 <= end; k += 16)
+    {
+        __m512 dx = _mm512_sub_ps(x, _mm512_loadu_ps(atoms->x + k));
+        __m512 dy = _mm512_sub_ps(y, _mm512_loadu_ps(atoms->y + k));
+        __m512 dz = _mm512_sub_ps(z, _mm512_loadu_ps(atoms->z + k));
+        __m512 curSum = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(dx, dx), _mm512_mul_ps(dy, dy)),
+                                      _mm512_mul_ps(dz, dz));
+        max = _mm512_max_ps(max, curSum);
+    }
+    float result = maxSquaredDistance(atoms, row, k, end);
+    float vectorMax = _mm512_reduce_max_ps(max);
+    return vectorMax > result ? vectorMax : result;
+}
+
+#endif
+
+/**
+ *This function adds the distances between atom row and the atoms begin .. end - 1 to a histogram
+ *
+ * @param atoms - The coordinates of the atoms
+ * @param histogram - The bins of the histogram, a distance past the last bin is counted in the last bin
+ * @param counts - The counts of the histogram
+ * @return The largest squared distance, 0 if there are no atoms in the range
+ */
+float histogramRow(const Atoms *atoms, size_t row, size_t begin, size_t end, const PairHistogram *histogram,
+                   uint64_t *counts)
+{
+    size_t k;
+    float max = 0, inverseWidth = 1 / histogram->binWidth;
+    for (k = begin; k < end; k++)
+    {
+        float dx = atoms->x[row] - atoms->x[k], dy = atoms->y[row] - atoms->y[k], dz = atoms->z[row] - atoms->z[k];
+        float curSum = dx * dx + dy * dy + dz * dz;
+        size_t bin = (size_t) (sqrtf(curSum) * inverseWidth);
+        counts[bin < histogram->binsNum ? bin : histogram->binsNum - 1]++;
+        max = curSum > max ? curSum : max;
+    }
+    return max;
+}
+
+#ifdef DMAX_X86
+
+/**
+ *This function is histogramRow with eight atoms per AVX2 vector, the bins are found in the vector and counted one
+ * by one
+ */
+__attribute__((target("avx2"))) float histogramRowAvx2(const Atoms *atoms, size_t row, size_t begin, size_t end,
+                                                       const PairHistogram *histogram, uint64_t *counts)
+{
+    float lanes[8];
+    int32_t bins[8];
+    size_t k, j;
+    __m256 x = _mm256_set1_ps(atoms->x[row]), y = _mm256_set1_ps(atoms->y[row]), z = _mm256_set1_ps(atoms->z[row]);
+    __m256 max = _mm256_setzero_ps(), inverseWidth = _mm256_set1_ps(1 / histogram->binWidth);
+    __m256i lastBin = _mm256_set1_epi32((int32_t) histogram->binsNum - 1);
+    for (k = begin; k + 8 <= end; k += 8)
+    {
+        __m256 dx = _mm256_sub_ps(x, _mm256_loadu_ps(atoms->x + k));
+        __m256 dy = _mm256_sub_ps(y, _mm256_loadu_ps(atoms->y + k));
+        __m256 dz = _mm256_sub_ps(z, _mm256_loadu_ps(atoms->z + k));
+        __m256 curSum = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)),
+                                      _mm256_mul_ps(dz, dz));
+        max = _mm256_max_ps(max, curSum);
+        __m256i bin = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_sqrt_ps(curSum), inverseWidth));
+        _mm256_storeu_si256((__m256i *) bins, _mm256_min_epi32(bin, lastBin));
+        for (j = 0; j < 8; j++)
+        {
+            counts[bins[j]]++;
+        }
+    }
+    _mm256_storeu_ps(lanes, max);
+    float result = histogramRow(atoms, row, k, end, histogram, counts);
+    for (j = 0; j < 8; j++)
+    {
+        result = lanes[j] > result ? lanes[j] : result;
+    }
+    return result;
+}
+
+/**
+ *This function is histogramRow with sixteen atoms per AVX-512 vector. AVX-512 has FMA, the products are not fused
+ * into the sums so that the bins are the same as the bins of the other kernels.
+ */
+__attribute__((target("avx512f"), optimize("fp-contract=off"))) float histogramRowAvx512(
+        const Atoms *atoms, size_t row, size_t begin, size_t end, const PairHistogram *histogram, uint64_t *counts)
+{
+    int32_t bins[16];
+    size_t k, j;
+    __m512 x = _mm512_set1_ps(atoms->x[row]), y = _mm512_set1_ps(atoms->y[row]), z = _mm512_set1_ps(atoms->z[row]);
+    __m512 max = _mm512_setzero_ps(), inverseWidth = _mm512_set1_ps(1 / histogram->binWidth);
+    __m512i lastBin = _mm512_set1_epi32((int32_t) histogram->binsNum - 1);
+    for (k = begin; k + 16 <= end; k += 16)
+    {
+        __m512 dx = _mm512_sub_ps(x, _mm512_loadu_ps(atoms->x + k));
+        __m512 dy = _mm512_sub_ps(y, _mm512_loadu_ps(atoms->y + k));
+        __m512 dz = _mm512_sub_ps(z, _mm512_loadu_ps(atoms->z + k));
+        __m512 curSum = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(dx, dx), _mm512_mul_ps(dy, dy)),
+                                      _mm512_mul_ps(dz, dz));
+        max = _mm512_max_ps(max, curSum);
+        __m512i bin = _mm512_cvttps_epi32(_mm512_mul_ps(_mm512_sqrt_ps(curSum), inverseWidth));
+        _mm512_storeu_si512(bins, _mm512_min_epi32(bin, lastBin));
+        for (j = 0; j < 16; j++)
+        {
+            counts[bins[j]]++;
+        }
+    }
+    float result = histogramRow(atoms, row, k, end, histogram, counts);
+    float vectorMax = _mm512_reduce_max_ps(max);
+    return vectorMax > result ? vectorMax : result;
+}
+
+#endif
+
+/**
+ *This function picks the fastest histogramRow kernel the CPU supports
+ */
+HistogramKernel selectHistogramKernel()
+{
+#ifdef DMAX_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+    {
+        return histogramRowAvx512;
+    }
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return histogramRowAvx2;
+    }
+#endif
+    return histogramRow;
+}
+
+/**
+ *This function picks the fastest maxSquaredDistance kernel the CPU supports
+ */
+RowKernel selectRowKernel()
+{
+#ifdef DMAX_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+    {
+        return maxSquaredDistanceAvx512;
+    }
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return maxSquaredDistanceAvx2;
+    }
+#endif
+    return maxSquaredDistance;
+}
+
+/**
+ *This function runs a task of the brute force Dmax: the pairs (i, k) with i in its rows and k > i. The rows are
+ * taken DMAX_BLOCK_ATOMS at a time and every tile of DMAX_TILE_ATOMS atoms is compared to the whole block while it
+ * is in the cache.
+ *
+ * @param arg - The DmaxTask, its max is set to the largest squared distance it found
+ * @return NULL
+ */
+void *runDmaxTask(void *arg)
+{
+    DmaxTask *task = (DmaxTask *) arg;
+    size_t block, tile, i, numOfAtoms = task->atoms->size;
+    for (block = task->firstRow; block < task->lastRow; block += DMAX_BLOCK_ATOMS)
+    {
+        size_t blockEnd = block + DMAX_BLOCK_ATOMS < task->lastRow ? block + DMAX_BLOCK_ATOMS : task->lastRow;
+        for (tile = block + 1; tile < numOfAtoms; tile += DMAX_TILE_ATOMS)
+        {
+            size_t tileEnd = tile + DMAX_TILE_ATOMS < numOfAtoms ? tile + DMAX_TILE_ATOMS : numOfAtoms;
+            for (i = block; i < blockEnd; i++)
+            {
+                size_t begin = i + 1 > tile ? i + 1 : tile;
+                if (begin < tileEnd)
+                {
+                    float curMax = task->histogram == NULL ? task->kernel(task->atoms, i, begin, tileEnd) :
+                                   task->histogramKernel(task->atoms, i, begin, tileEnd, task->histogram,
+                                                         task->counts);
+                    task->max = curMax > task->max ? curMax : task->max;
+                }
+            }
+        }
+    }
+    return NULL;
+}
+
+/**
+ *This function chooses the number of threads for a parallel kernel: one per CPU, as long as every thread gets at
+ * least minWork of the work, and at most MAX_KERNEL_THREADS
+ *
+ * @param work - The amount of work
+ * @param minWork - The least work that is worth a thread
+ * @return The number of threads, at least 1
+ */
+size_t getThreadsNum(size_t work, size_t minWork)
+{
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t threadsNum = work / minWork + 1;
+    threadsNum = cpus > 0 && (size_t) cpus < threadsNum ? (size_t) cpus : threadsNum;
+    return threadsNum < MAX_KERNEL_THREADS ? threadsNum : MAX_KERNEL_THREADS;
+}
+
+/**
+ *This function calculates the maximum distance between the given atoms by comparing every pair of atoms. The
+ * triangle of pairs is split between up to one thread per CPU so that every thread compares about the same number
+ * of pairs, and the squared distances are compared with the widest vectors the CPU supports. With a histogram the
+ * distances of the pairs are counted too, every thread counts in a histogram of its own (or in the given one if
+ * there is no memory for it and it runs after the first task) and they are added up at the end.
+ *
+ * @param atoms - The coordinates of the atoms
+ * @param histogram - The histogram of the distances with its bins set and its counts zeroed, or NULL
+ * @return The maximum distance between the atoms
+ */
+float getDmaxBruteForce(const Atoms *atoms, const PairHistogram *histogram)
+{
+    DmaxTask tasks[MAX_KERNEL_THREADS];
+    size_t t, bin, row = 0, pairsBefore = 0, numOfAtoms = atoms->size;
+    size_t pairs = numOfAtoms > 1 ? numOfAtoms * (numOfAtoms - 1) / 2 : 0;
+    size_t threadsNum = getThreadsNum(pairs, DMAX_MIN_PAIRS_PER_THREAD);
+    RowKernel kernel = selectRowKernel();
+    HistogramKernel histogramKernel = selectHistogramKernel();
+    float max = 0;
+    for (t = 0; t < threadsNum; t++)
+    {
+        // row i has numOfAtoms - 1 - i pairs, take rows until the share of this task is reached
+        size_t share = pairs / threadsNum * (t + 1) + (t + 1 == threadsNum ? pairs % threadsNum : 0);
+        tasks[t].atoms = atoms;
+        tasks[t].kernel = kernel;
+        tasks[t].histogramKernel = histogramKernel;
+        tasks[t].histogram = histogram;
+        tasks[t].counts = histogram == NULL ? NULL : histogram->counts;
+        if (histogram != NULL && t > 0)
+        {
+            uint64_t *counts = (uint64_t *) calloc(histogram->binsNum, sizeof(uint64_t));
+            tasks[t].counts = counts == NULL ? histogram->counts : counts;
+        }
+        tasks[t].firstRow = row;
+        tasks[t].max = 0;
+        while (row < numOfAtoms && pairsBefore < share)
+        {
+            pairsBefore += numOfAtoms - 1 - row;
+            row++;
+        }
+        tasks[t].lastRow = t + 1 == threadsNum ? numOfAtoms : row;
+        tasks[t].started = t > 0 && (histogram == NULL || tasks[t].counts != histogram->counts) &&
+                           pthread_create(&tasks[t].thread, NULL, runDmaxTask, &tasks[t]) == 0;
+    }
+    for (t = 0; t < threadsNum; t++)
+    {
+        if (tasks[t].started)
+        {
+            pthread_join(tasks[t].thread, NULL);
+        }
+        else
+        {
+            runDmaxTask(&tasks[t]); // the first task and the ones whose thread could not start
+        }
+        max = tasks[t].max > max ? tasks[t].max : max;
+        if (histogram != NULL && tasks[t].counts != histogram->counts)
+        {
+            for (bin = 0; bin < histogram->binsNum; bin++)
+            {
+                histogram->counts[bin] += tasks[t].counts[bin];
+            }
+            free(tasks[t].counts);
+        }
+    }
+    // sqrtf is monotonic so the root of the maximal square is the maximal distance
+    return sqrtf(max);
+}
+
+/**
+ *This function copies the coordinates of atom i to the given point
+ */
+void getPoint(const Atoms *atoms, size_t i, double point[NUM_OF_COORDS])
+{
+    point[0] = atoms->x[i];
+    point[1] = atoms->y[i];
+    point[2] = atoms->z[i];
+}
+
+/**
+ *This function calculates the signed distance of atom i from the plane of the given face, positive outside the hull
+ */
+double getFaceDistance(const Hull *hull, const HullFace *face, size_t i)
+{
+    double point[NUM_OF_COORDS];
+    getPoint(hull->atoms, i, point);
+    return face->normal[0] * point[0] + face->normal[1] * point[1] + face->normal[2] * point[2] - face->offset;
+}
+
+/**
+ *This function adds atom i to the atoms that are outside the given face
+ *
+ * @return if successful returns 0 and FAILURE if there is no memory
+ */
+int addOutside(HullFace *face, size_t i)
+{
+    if (face->outsideNum == face->outsideCapacity)
+    {
+        size_t capacity = face->outsideCapacity == 0 ? HULL_INITIAL_CAPACITY : 2 * face->outsideCapacity;
+        size_t *grown = (size_t *) realloc(face->outside, capacity * sizeof(size_t));
+        if (grown == NULL)
+        {
+            return FAILURE;
+        }
+        face->outside = grown;
+        face->outsideCapacity = capacity;
+    }
+    face->outside[face->outsideNum++] = i;
+    return 0;
+}
+
+/**
+ *This function adds the face a, b, c to the hull, its normal points to the side from which a, b, c are counter
+ * clockwise. The faces of the hull may move.
+ *
+ * @return if successful returns 0 and FAILURE if there is no memory
+ */
+int addFace(Hull *hull, size_t a, size_t b, size_t c)
+{
+    double pointA[NUM_OF_COORDS], pointB[NUM_OF_COORDS], pointC[NUM_OF_COORDS], u[NUM_OF_COORDS], v[NUM_OF_COORDS];
+    int j;
+    if (hull->facesNum == hull->facesCapacity)
+    {
+        size_t capacity = hull->facesCapacity == 0 ? HULL_INITIAL_CAPACITY : 2 * hull->facesCapacity;
+        HullFace *grown = (HullFace *) realloc(hull->faces, capacity * sizeof(HullFace));
+        if (grown == NULL)
+        {
+            return FAILURE;
+        }
+        hull->faces = grown;
+        hull->facesCapacity = capacity;
+    }
+    HullFace *face = &hull->faces[hull->facesNum++];
+    memset(face, 0, sizeof(HullFace));
+    face->vertices[0] = a;
+    face->vertices[1] = b;
+    face->vertices[2] = c;
+    face->alive = 1;
+    getPoint(hull->atoms, a, pointA);
+    getPoint(hull->atoms, b, pointB);
+    getPoint(hull->atoms, c, pointC);
+    for (j = 0; j < NUM_OF_COORDS; j++)
+    {
+        u[j] = pointB[j] - pointA[j];
+        v[j] = pointC[j] - pointA[j];
+    }
+    face->normal[0] = u[1] * v[2] - u[2] * v[1];
+    face->normal[1] = u[2] * v[0] - u[0] * v[2];
+    face->normal[2] = u[0] * v[1] - u[1] * v[0];
+    double norm = sqrt(face->normal[0] * face->normal[0] + face->normal[1] * face->normal[1] +
+                       face->normal[2] * face->normal[2]);
+    for (j = 0; j < NUM_OF_COORDS && norm > 0; j++)
+    {
+        face->normal[j] /= norm;
+    }
+    face->offset = face->normal[0] * pointA[0] + face->normal[1] * pointA[1] + face->normal[2] * pointA[2];
+    return 0;
+}
+
+/**
+ *This function frees the faces of the hull
+ */
+void freeHull(Hull *hull)
+{
+    size_t f;
+    for (f = 0; f < hull->facesNum; f++)
+    {
+        free(hull->faces[f].outside);
+    }
+    free(hull->faces);
+    hull->faces = NULL;
+    hull->facesNum = hull->facesCapacity = 0;
+}
+
+/**
+ *This function finds the four atoms of the initial tetrahedron of the hull: the farthest pair of the extreme atoms
+ * along the axes, the atom farthest from their line and the atom farthest from the plane of the three.
+ *
+ * @param simplex - Container for the indices of the four atoms
+ * @return if successful returns 0 and FAILURE if the atoms are flat (coplanar, collinear or all equal)
+ */
+int findSimplex(const Hull *hull, size_t simplex[4])
+{
+    const Atoms *atoms = hull->atoms;
+    size_t extremes[2 * NUM_OF_COORDS] = {0}, i, k;
+    double p0[NUM_OF_COORDS], p1[NUM_OF_COORDS], p2[NUM_OF_COORDS], point[NUM_OF_COORDS];
+    double best = 0;
+    int j;
+    for (i = 1; i < atoms->size; i++)
+    {
+        getPoint(atoms, i, point);
+        for (j = 0; j < NUM_OF_COORDS; j++)
+        {
+            double minimum[NUM_OF_COORDS], maximum[NUM_OF_COORDS];
+            getPoint(atoms, extremes[2 * j], minimum);
+            getPoint(atoms, extremes[2 * j + 1], maximum);
+            extremes[2 * j] = point[j] < minimum[j] ? i : extremes[2 * j];
+            extremes[2 * j + 1] = point[j] > maximum[j] ? i : extremes[2 * j + 1];
+        }
+    }
+    for (i = 0; i < 2 * NUM_OF_COORDS; i++)
+    {
+        for (k = i + 1; k < 2 * NUM_OF_COORDS; k++)
+        {
+            getPoint(atoms, extremes[i], p0);
+            getPoint(atoms, extremes[k], p1);
+            double distance = (p0[0] - p1[0]) * (p0[0] - p1[0]) + (p0[1] - p1[1]) * (p0[1] - p1[1]) +
+                              (p0[2] - p1[2]) * (p0[2] - p1[2]);
+            if (distance > best)
+            {
+                best = distance;
+                simplex[0] = extremes[i];
+                simplex[1] = extremes[k];
+            }
+        }
+    }
+    if (best <= hull->epsilon * hull->epsilon)
+    {
+        return FAILURE;
+    }
+
+    // the atom farthest from the line of the first two
+    getPoint(atoms, simplex[0], p0);
+    getPoint(atoms, simplex[1], p1);
+    best = 0;
+    for (i = 0; i < atoms->size; i++)
+    {
+        double d[NUM_OF_COORDS], cross[NUM_OF_COORDS];
+        getPoint(atoms, i, point);
+        for (j = 0; j < NUM_OF_COORDS; j++)
+        {
+            d[j] = point[j] - p0[j];
+            p2[j] = p1[j] - p0[j];
+        }
+        cross[0] = d[1] * p2[2] - d[2] * p2[1];
+        cross[1] = d[2] * p2[0] - d[0] * p2[2];
+        cross[2] = d[0] * p2[1] - d[1] * p2[0];
+        double distance = (cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]) /
+                          (p2[0] * p2[0] + p2[1] * p2[1] + p2[2] * p2[2]);
+        if (distance > best)
+        {
+            best = distance;
+            simplex[2] = i;
+        }
+    }
+    if (best <= hull->epsilon * hull->epsilon)
+    {
+        return FAILURE;
+    }
+
+    // the atom farthest from the plane of the first three
+    HullFace plane;
+    Hull scratch = {atoms, &plane, 0, 1, hull->epsilon, 0, 0};
+    addFace(&scratch, simplex[0], simplex[1], simplex[2]);
+    best = 0;
+    for (i = 0; i < atoms->size; i++)
+    {
+        double distance = fabs(getFaceDistance(&scratch, &plane, i));
+        if (distance > best)
+        {
+            best = distance;
+            simplex[3] = i;
+        }
+    }
+    return best <= hull->epsilon ? FAILURE : 0;
+}
+
+/**
+ *This function builds the initial tetrahedron of the hull with outward normals and distributes the atoms to the
+ * faces they are outside of
+ *
+ * @return if successful returns 0 and FAILURE if the atoms are flat or there is no memory
+ */
+int initHull(Hull *hull)
+{
+    static const int FACES[4][4] = {{0, 1, 2, 3}, {0, 3, 1, 2}, {0, 2, 3, 1}, {1, 3, 2, 0}};
+    size_t simplex[4], i, f;
+    if (findSimplex(hull, simplex) == FAILURE)
+    {
+        return FAILURE;
+    }
+    for (f = 0; f < 4; f++)
+    {
+        if (addFace(hull, simplex[FACES[f][0]], simplex[FACES[f][1]], simplex[FACES[f][2]]) == FAILURE)
+        {
+            return FAILURE;
+        }
+        HullFace *face = &hull->faces[f];
+        if (getFaceDistance(hull, face, simplex[FACES[f][3]]) > 0)
+        {
+            // the opposite vertex must be inside, flip the face
+            size_t swap = face->vertices[1];
+            face->vertices[1] = face->vertices[2];
+            face->vertices[2] = swap;
+            face->normal[0] = -face->normal[0];
+            face->normal[1] = -face->normal[1];
+            face->normal[2] = -face->normal[2];
+            face->offset = -face->offset;
+        }
+    }
+    for (i = 0; i < hull->atoms->size; i++)
+    {
+        for (f = 0; f < 4; f++)
+        {
+            if (getFaceDistance(hull, &hull->faces[f], i) > hull->epsilon)
+            {
+                if (addOutside(&hull->faces[f], i) == FAILURE)
+                {
+                    return FAILURE;
+                }
+                break;
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ *This function adds the atom that is farthest outside of face f to the hull: every face it sees is replaced by a
+ * cone of faces from the horizon to the atom, and the atoms outside the removed faces move to the new faces or are
+ * dropped if they are inside the hull now.
+ *
+ * @param visible - Reusable container for the indices of the visible faces
+ * @param horizon - Reusable container for the edges of the horizon, two vertices per edge
+ * @return if successful returns 0 and FAILURE if there is no memory or the hull exceeded its work
+ */
+int expandHull(Hull *hull, size_t f, Indices *visible, Indices *horizon)
+{
+    size_t i, k, g, apex = hull->faces[f].outside[0];
+    double best = getFaceDistance(hull, &hull->faces[f], apex);
+    for (i = 1; i < hull->faces[f].outsideNum; i++)
+    {
+        double distance = getFaceDistance(hull, &hull->faces[f], hull->faces[f].outside[i]);
+        if (distance > best)
+        {
+            best = distance;
+            apex = hull->faces[f].outside[i];
+        }
+    }
+
+    visible->size = horizon->size = 0;
+    hull->work += hull->facesNum;
+    if (hull->work > hull->maxWork)
+    {
+        return FAILURE;
+    }
+    for (g = 0; g < hull->facesNum; g++)
+    {
+        if (hull->faces[g].alive && getFaceDistance(hull, &hull->faces[g], apex) > hull->epsilon &&
+            appendIndex(visible, g) == FAILURE)
+        {
+            return FAILURE;
+        }
+    }
+    // an edge of a visible face is on the horizon if the face on its other side is not visible
+    for (i = 0; i < visible->size; i++)
+    {
+        const size_t *vertices = hull->faces[visible->indices[i]].vertices;
+        int e, onHorizon;
+        for (e = 0; e < 3; e++)
+        {
+            size_t a = vertices[e], b = vertices[(e + 1) % 3];
+            onHorizon = 1;
+            for (k = 0; k < visible->size && onHorizon; k++)
+            {
+                const size_t *other = hull->faces[visible->indices[k]].vertices;
+                onHorizon = !((other[0] == b && other[1] == a) || (other[1] == b && other[2] == a) ||
+                              (other[2] == b && other[0] == a));
+            }
+            if (onHorizon && (appendIndex(horizon, a) == FAILURE || appendIndex(horizon, b) == FAILURE))
+            {
+                return FAILURE;
+            }
+        }
+    }
+
+    size_t firstNew = hull->facesNum;
+    for (i = 0; i < horizon->size; i += 2)
+    {
+        if (addFace(hull, horizon->indices[i], horizon->indices[i + 1], apex) == FAILURE)
+        {
+            return FAILURE;
+        }
+    }
+    for (i = 0; i < visible->size; i++)
+    {
+        HullFace *face = &hull->faces[visible->indices[i]];
+        for (k = 0; k < face->outsideNum; k++)
+        {
+            size_t atom = face->outside[k];
+            for (g = firstNew; g < hull->facesNum && atom != apex; g++)
+            {
+                if (getFaceDistance(hull, &hull->faces[g], atom) > hull->epsilon)
+                {
+                    if (addOutside(&hull->faces[g], atom) == FAILURE)
+                    {
+                        return FAILURE;
+                    }
+                    break;
+                }
+            }
+        }
+        free(face->outside);
+        face->outside = NULL;
+        face->outsideNum = face->outsideCapacity = 0;
+        face->alive = 0;
+    }
+    return 0;
+}
+
+/**
+ *This function collects the vertices of the convex hull of the given atoms (quickhull)
+ *
+ * @param atoms - The coordinates of the atoms
+ * @param vertices - Container for the coordinates of the vertices of the hull
+ * @return if successful returns 0 and FAILURE if the atoms are flat, most of them are on the hull or there is no
+ * memory
+ */
+int getHullVertices(const Atoms *atoms, Atoms *vertices)
+{
+    size_t i, f;
+    float extent = 0;
+    float coordinates[NUM_OF_COORDS];
+    Indices visible = {NULL, 0, 0}, horizon = {NULL, 0, 0};
+    for (i = 0; i < atoms->size; i++)
+    {
+        extent = fmaxf(extent, fmaxf(fabsf(atoms->x[i]), fmaxf(fabsf(atoms->y[i]), fabsf(atoms->z[i]))));
+    }
+    // when most atoms are on the hull comparing all pairs is cheaper, give up once the hull costs as much
+    size_t maxWork = atoms->size / HULL_WORK_DIVISOR * (atoms->size - 1) / 2;
+    Hull hull = {atoms, NULL, 0, 0, (extent > 0 ? extent : 1) * HULL_EPSILON, 0, maxWork};
+    int result = initHull(&hull);
+    for (f = 0; f < hull.facesNum && result == 0; f++)
+    {
+        if (hull.faces[f].alive && hull.faces[f].outsideNum > 0)
+        {
+            result = expandHull(&hull, f, &visible, &horizon);
+        }
+    }
+    char *isVertex = result == 0 ? (char *) calloc(atoms->size, sizeof(char)) : NULL;
+    result = isVertex == NULL ? FAILURE : result;
+    for (f = 0; f < hull.facesNum && result == 0; f++)
+    {
+        for (i = 0; i < 3 && hull.faces[f].alive && result == 0; i++)
+        {
+            size_t vertex = hull.faces[f].vertices[i];
+            if (!isVertex[vertex])
+            {
+                isVertex[vertex] = 1;
+                coordinates[0] = atoms->x[vertex];
+                coordinates[1] = atoms->y[vertex];
+                coordinates[2] = atoms->z[vertex];
+                result = appendAtom(vertices, coordinates);
+            }
+        }
+    }
+    free(isVertex);
+    free(visible.indices);
+    free(horizon.indices);
+    freeHull(&hull);
+    return result;
+}
+
+/**
+ *This function is given the atoms of the protein and calculates the maximum distance of all the atoms in the protein
+ * and returns it. The farthest pair of atoms are vertices of the convex hull of the atoms, so above HULL_MIN_ATOMS
+ * atoms only the vertices of the hull are compared. Flat structures and structures with most atoms on the hull fall
+ * back to comparing every pair, and so does every structure when compiled with -DDMAX_BRUTE_FORCE (the baseline).
+ *
+ * @param atoms - The coordinates of the atoms
+ * @return The maximum distance within the protein : the max distance of all the atoms in the protein
+ */
+float getDmax(const Atoms *atoms)
+{
+#ifdef DMAX_BRUTE_FORCE
+    return getDmaxBruteForce(atoms, NULL);
+#else
+    Atoms vertices = {NULL, NULL, NULL, 0, 0};
+    if (atoms->size < HULL_MIN_ATOMS || getHullVertices(atoms, &vertices) == FAILURE)
+    {
+        freeAtoms(&vertices);
+        return getDmaxBruteForce(atoms, NULL);
+    }
+    float dMax = getDmaxBruteForce(&vertices, NULL);
+    freeAtoms(&vertices);
+    return dMax;
+#endif
+}
+
+/**
+ *This function calculates the maximum distance between the given atoms and the histogram of the distances of all
+ * their pairs, P(r), in one pass over the pairs. The histogram has enough bins for the diagonal of the box around
+ * the atoms, and is cut after the bin of Dmax.
+ *
+ * @param atoms - The atoms, there is at least one
+ * @param binWidth - The width of a bin, positive
+ * @param histogram - Container for the histogram, its counts are to free
+ * @param dMax - Container for the maximum distance
+ * @return if successful returns 0 and FAILURE if the histogram is too large for the memory or HISTOGRAM_MAX_BINS
+ */
+int getPairHistogram(const Atoms *atoms, float binWidth, PairHistogram *histogram, float *dMax)
+{
+    double minimum[NUM_OF_COORDS] = {atoms->x[0], atoms->y[0], atoms->z[0]};
+    double maximum[NUM_OF_COORDS] = {atoms->x[0], atoms->y[0], atoms->z[0]};
+    double diagonal = 0;
+    size_t i;
+    int j;
+    for (i = 1; i < atoms->size; i++)
+    {
+        const double coordinates[NUM_OF_COORDS] = {atoms->x[i], atoms->y[i], atoms->z[i]};
+        for (j = 0; j < NUM_OF_COORDS; j++)
+        {
+            minimum[j] = coordinates[j] < minimum[j] ? coordinates[j] : minimum[j];
+            maximum[j] = coordinates[j] > maximum[j] ? coordinates[j] : maximum[j];
+        }
+    }
+    for (j = 0; j < NUM_OF_COORDS; j++)
+    {
+        diagonal += (maximum[j] - minimum[j]) * (maximum[j] - minimum[j]);
+    }
+    double binsNum = sqrt(diagonal) / binWidth + 2; // a bin for the rounding of the distances of the floats
+    histogram->binWidth = binWidth;
+    histogram->counts = NULL;
+    if (binsNum > HISTOGRAM_MAX_BINS)
+    {
+        return FAILURE;
+    }
+    histogram->binsNum = (size_t) binsNum;
+    histogram->counts = (uint64_t *) calloc(histogram->binsNum, sizeof(uint64_t));
+    if (histogram->counts == NULL)
+    {
+        return FAILURE;
+    }
+    *dMax = getDmaxBruteForce(atoms, histogram);
+    size_t lastBin = (size_t) (*dMax * (1 / binWidth));
+    histogram->binsNum = lastBin < histogram->binsNum ? lastBin + 1 : histogram->binsNum;
+    return 0;
+}
+
+/**
+ *This function calculates the cell of the given atom in the grid
+ *
+ * @param cell - Container for the three indices of the cell
+ */
+void getCell(const SpatialGrid *grid, const Atoms *atoms, size_t i, size_t cell[NUM_OF_COORDS])
+{
+    const float coordinates[NUM_OF_COORDS] = {atoms->x[i], atoms->y[i], atoms->z[i]};
+    int j;
+    for (j = 0; j < NUM_OF_COORDS; j++)
+    {
+        size_t index = (size_t) ((coordinates[j] - grid->origin[j]) / grid->cellSize);
+        cell[j] = index < grid->dims[j] ? index : grid->dims[j] - 1;
+    }
+}
+
+/**
+ *This function builds a grid over the given atoms with cells of at least cutoff on every side. The cells grow when
+ * the atoms are sparse so that there are at most GRID_CELLS_PER_ATOM cells per atom, and the atoms are sorted by
+ * cell with a counting sort.
+ *
+ * @param atoms - The atoms, there is at least one
+ * @param cutoff - The smallest size of a cell, positive
+ * @param grid - Container for the grid, to free with freeGrid
+ * @return if successful returns 0 and FAILURE if there is no memory
+ */
+int buildGrid(const Atoms *atoms, float cutoff, SpatialGrid *grid)
+{
+    float minimum[NUM_OF_COORDS] = {atoms->x[0], atoms->y[0], atoms->z[0]};
+    float maximum[NUM_OF_COORDS] = {atoms->x[0], atoms->y[0], atoms->z[0]};
+    size_t i, cell[NUM_OF_COORDS], maxCells = atoms->size * GRID_CELLS_PER_ATOM;
+    int j;
+    for (i = 1; i < atoms->size; i++)
+    {
+        const float coordinates[NUM_OF_COORDS] = {atoms->x[i], atoms->y[i], atoms->z[i]};
+        for (j = 0; j < NUM_OF_COORDS; j++)
+        {
+            minimum[j] = coordinates[j] < minimum[j] ? coordinates[j] : minimum[j];
+            maximum[j] = coordinates[j] > maximum[j] ? coordinates[j] : maximum[j];
+        }
+    }
+    memcpy(grid->origin, minimum, sizeof(minimum));
+    grid->cellSize = cutoff;
+    do
+    {
+        double cellsNum = 1;
+        for (j = 0; j < NUM_OF_COORDS; j++)
+        {
+            grid->dims[j] = (size_t) ((maximum[j] - minimum[j]) / grid->cellSize) + 1;
+            cellsNum *= (double) grid->dims[j];
+        }
+        if (cellsNum <= (double) maxCells)
+        {
+            grid->cellsNum = (size_t) cellsNum;
+            break;
+        }
+        grid->cellSize *= (float) cbrt(cellsNum / (double) maxCells) * 1.01f;
+    } while (1);
+
+    grid->cellStart = (size_t *) calloc(grid->cellsNum + 1, sizeof(size_t));
+    grid->cellAtoms = (size_t *) malloc(atoms->size * sizeof(size_t));
+    if (grid->cellStart == NULL || grid->cellAtoms == NULL)
+    {
+        free(grid->cellStart);
+        free(grid->cellAtoms);
+        return FAILURE;
+    }
+    for (i = 0; i < atoms->size; i++)
+    {
+        getCell(grid, atoms, i, cell);
+        grid->cellStart[(cell[2] * grid->dims[1] + cell[1]) * grid->dims[0] + cell[0] + 1]++;
+    }
+    for (i = 0; i < grid->cellsNum; i++)
+    {
+        grid->cellStart[i + 1] += grid->cellStart[i];
+    }
+    for (i = 0; i < atoms->size; i++)
+    {
+        // cellStart[c] counts the atoms of cell c that are placed, it ends up at the start of cell c + 1
+        getCell(grid, atoms, i, cell);
+        grid->cellAtoms[grid->cellStart[(cell[2] * grid->dims[1] + cell[1]) * grid->dims[0] + cell[0]]++] = i;
+    }
+    for (i = grid->cellsNum; i > 0; i--)
+    {
+        grid->cellStart[i] = grid->cellStart[i - 1];
+    }
+    grid->cellStart[0] = 0;
+    return 0;
+}
+
+/**
+ *This function frees the buffers of the given grid
+ */
+void freeGrid(SpatialGrid *grid)
+{
+    free(grid->cellStart);
+    free(grid->cellAtoms);
+    grid->cellStart = grid->cellAtoms = NULL;
+}
+
+/**
+ *This function appends a pair of atoms in contact to the pairs of the given contacts
+ *
+ * @return if successful returns 0 and FAILURE if there is no memory
+ */
+int appendPair(Contacts *contacts, size_t first, size_t second, float squaredDistance)
+{
+    if (contacts->pairsNum == contacts->pairsCapacity)
+    {
+        size_t capacity = contacts->pairsCapacity == 0 ? INITIAL_PAIRS_CAPACITY : 2 * contacts->pairsCapacity;
+        ContactPair *grown = (ContactPair *) realloc(contacts->pairs, capacity * sizeof(ContactPair));
+        if (grown == NULL)
+        {
+            return FAILURE;
+        }
+        contacts->pairs = grown;
+        contacts->pairsCapacity = capacity;
+    }
+    contacts->pairs[contacts->pairsNum].first = first;
+    contacts->pairs[contacts->pairsNum].second = second;
+    contacts->pairs[contacts->pairsNum].squaredDistance = squaredDistance;
+    contacts->pairsNum++;
+    return 0;
+}
+
+/**
+ * Compares two pairs of atoms in contact by their first atom and then by their second atom for qsort
+ */
+int compareContactPairs(const void *a, const void *b)
+{
+    const ContactPair *first = (const ContactPair *) a, *second = (const ContactPair *) b;
+    if (first->first != second->first)
+    {
+        return (first->first > second->first) - (first->first < second->first);
+    }
+    return (first->second > second->second) - (first->second < second->second);
+}
+
+/**
+ *This function frees the contact map of the given contacts
+ */
+void freeContacts(Contacts *contacts)
+{
+    free(contacts->neighbors);
+    free(contacts->pairs);
+    contacts->neighbors = NULL;
+    contacts->pairs = NULL;
+    contacts->pairsNum = contacts->pairsCapacity = 0;
+}
+
+/**
+ *This function runs a task of the contacts: every atom of its cells is compared to the atoms of the 27 cells around
+ * it, so every contact is seen from both of its atoms and is kept in the contact map from its first atom
+ *
+ * @param arg - The ContactsTask, its contacts are set to what it found
+ * @return NULL
+ */
+void *runContactsTask(void *arg)
+{
+    ContactsTask *task = (ContactsTask *) arg;
+    const SpatialGrid *grid = task->grid;
+    const Atoms *atoms = task->atoms;
+    float cutoff2 = task->cutoff * task->cutoff, clash2 = CLASH_DISTANCE * CLASH_DISTANCE;
+    size_t c, a, b, halfContacts = 0;
+    for (c = task->firstCell; c < task->lastCell; c++)
+    {
+        size_t cell[NUM_OF_COORDS] = {c % grid->dims[0], c / grid->dims[0] % grid->dims[1],
+                                      c / grid->dims[0] / grid->dims[1]};
+        for (a = grid->cellStart[c]; a < grid->cellStart[c + 1]; a++)
+        {
+            size_t i = grid->cellAtoms[a], neighbors = 0;
+            int dx, dy, dz;
+            for (dz = -1; dz <= 1; dz++)
+            {
+                for (dy = -1; dy <= 1; dy++)
+                {
+                    for (dx = -1; dx <= 1; dx++)
+                    {
+                        // unsigned wrap around makes the cells before 0 too big as well
+                        size_t x = cell[0] + dx, y = cell[1] + dy, z = cell[2] + dz;
+                        if (x >= grid->dims[0] || y >= grid->dims[1] || z >= grid->dims[2])
+                        {
+                            continue;
+                        }
+                        size_t other = (z * grid->dims[1] + y) * grid->dims[0] + x;
+                        for (b = grid->cellStart[other]; b < grid->cellStart[other + 1]; b++)
+                        {
+                            size_t k = grid->cellAtoms[b];
+                            float ddx = atoms->x[i] - atoms->x[k], ddy = atoms->y[i] - atoms->y[k];
+                            float ddz = atoms->z[i] - atoms->z[k];
+                            float curSum = ddx * ddx + ddy * ddy + ddz * ddz;
+                            if (k != i && curSum <= cutoff2)
+                            {
+                                neighbors++;
+                                task->contacts.clashes += k > i && curSum < clash2;
+                                if (task->contacts.neighbors != NULL && k > i && !task->failed)
+                                {
+                                    task->failed = appendPair(&task->contacts, i, k, curSum) == FAILURE;
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+            halfContacts += neighbors;
+            if (task->contacts.neighbors != NULL)
+            {
+                task->contacts.neighbors[i] = neighbors;
+            }
+            task->contacts.maxNeighbors = neighbors > task->contacts.maxNeighbors ? neighbors :
+                                          task->contacts.maxNeighbors;
+        }
+    }
+    task->contacts.contacts = halfContacts;
+    return NULL;
+}
+
+/**
+ *This function counts the contacts of the given atoms, the pairs not farther than cutoff, with a grid so that only
+ * close atoms are compared. The cells are split between threads so that every thread has about the same number of
+ * atoms. With a contact map the neighbors of every atom and the pairs in contact are kept too, the pairs of the
+ * threads are joined and sorted so the map doesn't depend on the number of threads.
+ *
+ * @param atoms - The atoms, there is at least one
+ * @param cutoff - The distance of a contact, positive
+ * @param contactMap - Non zero to keep the contact map
+ * @param contacts - Container for the contacts, its contact map is to free with freeContacts
+ * @return if successful returns 0 and FAILURE if there is no memory
+ */
+int getContacts(const Atoms *atoms, float cutoff, int contactMap, Contacts *contacts)
+{
+    ContactsTask tasks[MAX_KERNEL_THREADS];
+    SpatialGrid grid;
+    size_t t, cell = 0;
+    int failed = 0;
+    memset(contacts, 0, sizeof(Contacts));
+    if (contactMap)
+    {
+        contacts->neighbors = (size_t *) calloc(atoms->size, sizeof(size_t));
+    }
+    if ((contactMap && contacts->neighbors == NULL) || buildGrid(atoms, cutoff, &grid) == FAILURE)
+    {
+        freeContacts(contacts);
+        return FAILURE;
+    }
+    size_t threadsNum = getThreadsNum(atoms->size, CONTACTS_MIN_ATOMS_PER_THREAD);
+    for (t = 0; t < threadsNum; t++)
+    {
+        size_t share = atoms->size / threadsNum * (t + 1);
+        tasks[t].atoms = atoms;
+        tasks[t].grid = &grid;
+        tasks[t].cutoff = cutoff;
+        tasks[t].firstCell = cell;
+        memset(&tasks[t].contacts, 0, sizeof(Contacts));
+        tasks[t].contacts.neighbors = contacts->neighbors;
+        tasks[t].failed = 0;
+        while (cell < grid.cellsNum && grid.cellStart[cell] < share)
+        {
+            cell++;
+        }
+        tasks[t].lastCell = t + 1 == threadsNum ? grid.cellsNum : cell;
+        tasks[t].started = t > 0 && pthread_create(&tasks[t].thread, NULL, runContactsTask, &tasks[t]) == 0;
+    }
+    for (t = 0; t < threadsNum; t++)
+    {
+        if (tasks[t].started)
+        {
+            pthread_join(tasks[t].thread, NULL);
+        }
+        else
+        {
+            runContactsTask(&tasks[t]); // the first task and the ones whose thread could not start
+        }
+        contacts->contacts += tasks[t].contacts.contacts;
+        contacts->clashes += tasks[t].contacts.clashes;
+        contacts->maxNeighbors = tasks[t].contacts.maxNeighbors > contacts->maxNeighbors ?
+                                 tasks[t].contacts.maxNeighbors : contacts->maxNeighbors;
+        contacts->pairsNum += tasks[t].contacts.pairsNum;
+        failed |= tasks[t].failed;
+    }
+    contacts->contacts /= 2; // every contact was counted from both of its atoms
+    freeGrid(&grid);
+    if (contactMap && !failed && contacts->pairsNum > 0)
+    {
+        contacts->pairs = (ContactPair *) malloc(contacts->pairsNum * sizeof(ContactPair));
+        contacts->pairsCapacity = contacts->pairsNum;
+        failed = contacts->pairs == NULL;
+    }
+    for (t = 0, contacts->pairsNum = 0; t < threadsNum; t++)
+    {
+        if (!failed && tasks[t].contacts.pairsNum > 0)
+        {
+            memcpy(contacts->pairs + contacts->pairsNum, tasks[t].contacts.pairs,
+                   tasks[t].contacts.pairsNum * sizeof(ContactPair));
+            contacts->pairsNum += tasks[t].contacts.pairsNum;
+        }
+        free(tasks[t].contacts.pairs);
+    }
+    if (failed)
+    {
+        freeContacts(contacts);
+        return FAILURE;
+    }
+    if (contacts->pairsNum > 0)
+    {
+        qsort(contacts->pairs, contacts->pairsNum, sizeof(ContactPair), compareContactPairs);
+    }
+    return 0;
+}
+
+/**
+ *This function subtracts the center of mass from the coordinates of the given atoms
+ *
+ * @param atoms - The atoms, there is at least one
+ * @return The sum of the squared centered coordinates
+ */
+double centerAtoms(Atoms *atoms)
+{
+    float cg[NUM_OF_COORDS];
+    double squares = 0;
+    size_t i;
+    createCg(atoms, cg);
+    for (i = 0; i < atoms->size; i++)
+    {
+        atoms->x[i] -= cg[0];
+        atoms->y[i] -= cg[1];
+        atoms->z[i] -= cg[2];
+        squares += (double) atoms->x[i] * atoms->x[i] + (double) atoms->y[i] * atoms->y[i] +
+                   (double) atoms->z[i] * atoms->z[i];
+    }
+    return squares;
+}
+
+/**
+ *This function calculates the RMSD of two centered structures after the rotation that superposes them best, with
+ * the QCP method (Theobald 2005): the largest eigenvalue of the 4x4 key matrix of the quaternion of the rotation is
+ * found by Newton's method on its characteristic polynomial, so the rotation itself is never needed.
+ *
+ * @param first - The atoms of the first structure, centered
+ * @param second - The atoms of the second structure, centered, with as many atoms as the first
+ * @param squares - The sum of the squared coordinates of the first and of the second structure
+ * @return The RMSD of the structures
+ */
+double getRmsd(const Atoms *first, const Atoms *second, double squares)
+{
+    double m[NUM_OF_COORDS][NUM_OF_COORDS] = {{0, 0, 0}, {0, 0, 0}, {0, 0, 0}};
+    size_t i, n = first->size;
+    int iteration;
+    for (i = 0; i < n; i++)
+    {
+        double x1 = first->x[i], y1 = first->y[i], z1 = first->z[i];
+        double x2 = second->x[i], y2 = second->y[i], z2 = second->z[i];
+        m[0][0] += x1 * x2;
+        m[0][1] += x1 * y2;
+        m[0][2] += x1 * z2;
+        m[1][0] += y1 * x2;
+        m[1][1] += y1 * y2;
+        m[1][2] += y1 * z2;
+        m[2][0] += z1 * x2;
+        m[2][1] += z1 * y2;
+        m[2][2] += z1 * z2;
+    }
+    double sxx = m[0][0], sxy = m[0][1], sxz = m[0][2], syx = m[1][0], syy = m[1][1], syz = m[1][2];
+    double szx = m[2][0], szy = m[2][1], szz = m[2][2];
+    double sxx2 = sxx * sxx, syy2 = syy * syy, szz2 = szz * szz, sxy2 = sxy * sxy, syz2 = syz * syz;
+    double sxz2 = sxz * sxz, syx2 = syx * syx, szy2 = szy * szy, szx2 = szx * szx;
+    double syzSzymSyySzz2 = 2 * (syz * szy - syy * szz);
+    double sxx2Syy2Szz2Syz2Szy2 = syy2 + szz2 - sxx2 + syz2 + szy2;
+    double sxy2Sxz2Syx2Szx2 = sxy2 + sxz2 - syx2 - szx2;
+    double sxzpSzx = sxz + szx, syzpSzy = syz + szy, sxypSyx = sxy + syx;
+    double syzmSzy = syz - szy, sxzmSzx = sxz - szx, sxymSyx = sxy - syx;
+    double sxxpSyy = sxx + syy, sxxmSyy = sxx - syy;
+
+    // the characteristic polynomial x^4 + c2 x^2 + c1 x + c0 of the key matrix
+    double c2 = -2 * (sxx2 + syy2 + szz2 + sxy2 + syx2 + sxz2 + szx2 + syz2 + szy2);
+    double c1 = 8 * (sxx * syz * szy + syy * szx * sxz + szz * sxy * syx) -
+                8 * (sxx * syy * szz + syz * szx * sxy + szy * syx * sxz);
+    double c0 = sxy2Sxz2Syx2Szx2 * sxy2Sxz2Syx2Szx2 +
+                (sxx2Syy2Szz2Syz2Szy2 + syzSzymSyySzz2) * (sxx2Syy2Szz2Syz2Szy2 - syzSzymSyySzz2) +
+                (-sxzpSzx * syzmSzy + sxymSyx * (sxxmSyy - szz)) * (-sxzmSzx * syzpSzy + sxymSyx * (sxxmSyy + szz)) +
+                (-sxzpSzx * syzpSzy - sxypSyx * (sxxpSyy - szz)) * (-sxzmSzx * syzmSzy - sxypSyx * (sxxpSyy + szz)) +
+                (sxypSyx * syzpSzy + sxzpSzx * (sxxmSyy + szz)) * (-sxymSyx * syzmSzy + sxzpSzx * (sxxpSyy + szz)) +
+                (sxypSyx * syzmSzy + sxzmSzx * (sxxmSyy - szz)) * (-sxymSyx * syzpSzy + sxzmSzx * (sxxpSyy - szz));
+
+    // the largest eigenvalue is at most half of the sum of squares, Newton's method goes down to it from there
+    double e0 = squares / 2, eigenvalue = e0;
+    for (iteration = 0; iteration < QCP_MAX_ITERATIONS; iteration++)
+    {
+        double previous = eigenvalue, x2 = eigenvalue * eigenvalue;
+        double b = (x2 + c2) * eigenvalue, a = b + c1;
+        double denominator = 2 * x2 * eigenvalue + b + a;
+        if (denominator == 0)
+        {
+            break;
+        }
+        eigenvalue -= (a * eigenvalue + c0) / denominator;
+        if (fabs(eigenvalue - previous) < fabs(QCP_PRECISION * eigenvalue))
+        {
+            break;
+        }
+    }
+    double msd = 2 * (e0 - eigenvalue) / (double) n;
+    return msd > 0 ? sqrt(msd) : 0;
+}
+
+/**
+ *This function is the body of a worker of the RMSD matrix: it takes the next tile of the upper triangle until there
+ * are no more tiles and fills both halves of the matrix for the pairs of the tile
+ *
+ * @param arg - The RmsdPool
+ * @return NULL
+ */
+void *runRmsdWorker(void *arg)
+{
+    RmsdPool *pool = (RmsdPool *) arg;
+    size_t n = pool->filesNum;
+    while (1)
+    {
+        pthread_mutex_lock(&pool->lock);
+        size_t tile = pool->next++;
+        pthread_mutex_unlock(&pool->lock);
+        if (tile >= pool->tilesPerSide * pool->tilesPerSide)
+        {
+            break;
+        }
+        size_t rowTile = tile / pool->tilesPerSide, columnTile = tile % pool->tilesPerSide, i, j;
+        if (rowTile > columnTile)
+        {
+            continue;
+        }
+        size_t rowEnd = (rowTile + 1) * pool->tileSize < n ? (rowTile + 1) * pool->tileSize : n;
+        size_t columnEnd = (columnTile + 1) * pool->tileSize < n ? (columnTile + 1) * pool->tileSize : n;
+        for (i = rowTile * pool->tileSize; i < rowEnd; i++)
+        {
+            for (j = i + 1 > columnTile * pool->tileSize ? i + 1 : columnTile * pool->tileSize; j < columnEnd; j++)
+            {
+                double rmsd = getRmsd(&pool->structures[i], &pool->structures[j],
+                                      pool->squares[i] + pool->squares[j]);
+                pool->matrix[i * n + j] = pool->matrix[j * n + i] = rmsd;
+            }
+        }
+    }
+    return NULL;
+}
+
+/**
+ *This function prints the output of the analysis.
+ *
+ * @param fileName - The name of the file which is being analyzed
+ * @param numOfAtoms - The number of atoms that appears in the file
+ * @param cg - Three coordinates of the Center of mass
+ * @param rg - The Radius of gyration
+ * @param dMax - The maximum distance within the protein : the max distance of all the atoms in the protein, NULL if
+ * it was not calculated
+ */
+void printOutput(const char *fileName, size_t numOfAtoms, const float *cg, float rg, const float *dMax)
+{
+    printf("PDB file %s, %zu atoms were read\n", fileName, numOfAtoms);
+    printf("Cg = %.3f %.3f %.3f\n", cg[0], cg[1], cg[2]);
+    printf("Rg = %.3f\n", rg);
+    if (dMax != NULL)
+    {
+        printf("Dmax = %.3f\n", *dMax);
+    }
+}
+
+/**
+ *This function calculates the results of the given analysis from the atoms of its file
+ *
+ * @param analysis - The analysis
+ * @param atoms - The atoms of the file, there is at least one
+ * @return if successful returns 0 and FAILURE otherwise
+ */
+int analyzeAtoms(Analysis *analysis, const Atoms *atoms)
+{
+    analysis->numOfAtoms = atoms->size;
+    createCg(atoms, analysis->cg);
+    analysis->rg = getRg(atoms, analysis->cg);
+    if (analysis->options->binWidth > 0)
+    {
+        if (getPairHistogram(atoms, analysis->options->binWidth, &analysis->histogram, &analysis->dMax) == FAILURE)
+        {
+            snprintf(analysis->error, ERROR_LEN, "Error - no room for the P(r) of the file %s with bins of %g",
+                     analysis->fileName, analysis->options->binWidth);
+            return FAILURE;
+        }
+    }
+    else
+    {
+        analysis->dMax = getDmax(atoms);
+    }
+    if (analysis->options->cutoff > 0 &&
+        getContacts(atoms, analysis->options->cutoff, analysis->options->contactMap, &analysis->contacts) == FAILURE)
+    {
+        snprintf(analysis->error, ERROR_LEN, "Error - out of memory while analyzing the file %s", analysis->fileName);
+        return FAILURE;
+    }
+    analysis->result = 0;
+    return 0;
+}
+
+/**
+ *This function is given a file (which contains text), the function reads the file and performs mathematical
+ * manipulations on the text in order to analyze it.
+ *
+ * @param analysis - The analysis, its fileName is the file to analyze and the rest is filled
+ * @param atoms - Buffers for the atoms of the file, they may hold the atoms of a previous file and are reused
+ * @return if successful returns 0 and FAILURE otherwise. With the cache option the atoms are taken from the cache of
+ * the file if it is valid, and the cache is written otherwise.
+ */
+int analyzeFile(Analysis *analysis, Atoms *atoms)
+{
+    Moments moments = {0, {0, 0, 0}, 0};
+    SourceStamp stamp;
+    int useCache = analysis->options->cache && !analysis->options->streaming;
+    AtomSink sink = {analysis->options->streaming ? NULL : atoms, analysis->options->streaming ? &moments : NULL,
+                     NULL, NULL, &analysis->options->selection, useCache ? &stamp : NULL};
+    Atoms cached;
+    void *mapping;
+    size_t mappingLen;
+    analysis->result = FAILURE;
+    analysis->histogram.counts = NULL;
+    analysis->contacts.neighbors = NULL;
+    analysis->contacts.pairs = NULL;
+    if (useCache && loadCache(analysis->fileName, &analysis->options->selection, &cached, &mapping, &mappingLen) == 0)
+    {
+        int result = analyzeAtoms(analysis, &cached);
+        munmap(mapping, mappingLen);
+        return result;
+    }
+    atoms->size = 0;
+    long numOfAtoms = readAtoms(analysis->fileName, &sink, analysis->error);
+    if (numOfAtoms < 0)
+    {
+        return FAILURE;
+    }
+    if (numOfAtoms == 0)
+    {
+        snprintf(analysis->error, ERROR_LEN, "Error - 0 atoms were found in the file %s", analysis->fileName);
+        return FAILURE;
+    }
+    if (analysis->options->streaming)
+    {
+        analysis->numOfAtoms = (size_t) numOfAtoms;
+        analysis->result = 0;
+        getMomentsResults(&moments, analysis->cg, &analysis->rg);
+        return 0;
+    }
+    if (useCache)
+    {
+        writeCache(analysis->fileName, &analysis->options->selection, &stamp, atoms);
+    }
+    return analyzeAtoms(analysis, atoms);
+}
+
+/**
+ *This function prints the output of the given analysis, or the reason of its failure to stderr
+ *
+ * @return The result of the analysis
+ */
+int reportAnalysis(const Analysis *analysis)
+{
+    size_t i;
+    if (analysis->result == FAILURE)
+    {
+        fflush(stdout); // keep the order of the files when stdout and stderr go to the same place
+        fprintf(stderr, "%s\n", analysis->error);
+        return FAILURE;
+    }
+    printOutput(analysis->fileName, analysis->numOfAtoms, analysis->cg, analysis->rg,
+                analysis->options->streaming ? NULL : &analysis->dMax);
+    if (analysis->options->cutoff > 0 && !analysis->options->streaming)
+    {
+        printf("Contacts = %zu (cutoff %.3f), neighbors per atom = %.3f (max %zu), clashes = %zu\n",
+               analysis->contacts.contacts, analysis->options->cutoff,
+               2.0 * analysis->contacts.contacts / analysis->numOfAtoms, analysis->contacts.maxNeighbors,
+               analysis->contacts.clashes);
+    }
+    if (analysis->contacts.neighbors != NULL)
+    {
+        printf("Neighbors of every atom:\n");
+        for (i = 0; i < analysis->numOfAtoms; i++)
+        {
+            printf("%zu %zu\n", i + 1, analysis->contacts.neighbors[i]);
+        }
+        printf("Contact map, atoms closer than %.3f (clashes closer than %.3f):\n", analysis->options->cutoff,
+               CLASH_DISTANCE);
+        for (i = 0; i < analysis->contacts.pairsNum; i++)
+        {
+            const ContactPair *pair = &analysis->contacts.pairs[i];
+            printf("%zu %zu %.3f%s\n", pair->first + 1, pair->second + 1, sqrtf(pair->squaredDistance),
+                   pair->squaredDistance < CLASH_DISTANCE * CLASH_DISTANCE ? " clash" : "");
+        }
+    }
+    if (analysis->histogram.counts != NULL)
+    {
+        printf("P(r), bins of %.3f:\n", analysis->histogram.binWidth);
+        for (i = 0; i < analysis->histogram.binsNum; i++)
+        {
+            printf("%.3f %llu\n", (i + 0.5) * analysis->histogram.binWidth,
+                   (unsigned long long) analysis->histogram.counts[i]);
+        }
+    }
+    return 0;
+}
+
+/**
+ *This function is the body of a worker of a parallel run: it analyzes the next file of the pool until there are no
+ * more files, with its own atom buffers.
+ *
+ * @param arg - The AnalysisPool
+ * @return NULL
+ */
+void *runAnalysisWorker(void *arg)
+{
+    AnalysisPool *pool = (AnalysisPool *) arg;
+    Atoms atoms = {NULL, NULL, NULL, 0, 0};
+    while (1)
+    {
+        pthread_mutex_lock(&pool->lock);
+        size_t i = pool->next++;
+        pthread_mutex_unlock(&pool->lock);
+        if (i >= pool->analysesNum)
+        {
+            break;
+        }
+        analyzeFile(&pool->analyses[i], &atoms);
+        pthread_mutex_lock(&pool->lock);
+        pool->analyses[i].done = 1;
+        pthread_cond_broadcast(&pool->analyzed);
+        pthread_mutex_unlock(&pool->lock);
+    }
+    freeAtoms(&atoms);
+    return NULL;
+}
+
+/**
+ *This function calculates the results of a model that was read
+ *
+ * @param frame - The frame of the model, it has at least one atom
+ * @param options - The options of the run
+ */
+void analyzeFrame(Frame *frame, const Options *options)
+{
+    if (options->streaming)
+    {
+        getMomentsResults(&frame->moments, frame->cg, &frame->rg);
+        return;
+    }
+    createCg(&frame->atoms, frame->cg);
+    frame->rg = getRg(&frame->atoms, frame->cg);
+    frame->dMax = getDmax(&frame->atoms);
+}
+
+/**
+ *This function prints the analyzed models of the trajectory that are next in order and frees their frames, the
+ * lock of the trajectory is held
+ */
+void printFrames(Trajectory *trajectory)
+{
+    while (trajectory->printedNum < trajectory->readNum)
+    {
+        Frame *frame = &trajectory->frames[trajectory->printedNum % trajectory->framesNum];
+        if (frame->state != FRAME_ANALYZED)
+        {
+            return;
+        }
+        if (trajectory->printedNum == 0)
+        {
+            printf("PDB file %s\n", trajectory->fileName);
+        }
+        printf("Model %ld, %zu atoms: Cg = %.3f %.3f %.3f, Rg = %.3f", frame->model,
+               trajectory->options->streaming ? frame->moments.count : frame->atoms.size, frame->cg[0], frame->cg[1],
+               frame->cg[2], frame->rg);
+        if (!trajectory->options->streaming)
+        {
+            printf(", Dmax = %.3f", frame->dMax);
+        }
+        printf("\n");
+        frame->state = FRAME_FREE;
+        trajectory->printedNum++;
+        pthread_cond_broadcast(&trajectory->changed);
+    }
+}
+
+/**
+ *This function hands the model that was read into the current frame to the workers, or analyzes it if there are
+ * no workers. A frame without atoms (ENDMDL of an empty model) is not a model.
+ *
+ * @param trajectory - The trajectory
+ * @param sink - The sink the model was read into
+ */
+void submitFrame(Trajectory *trajectory, AtomSink *sink)
+{
+    Frame *frame = &trajectory->frames[trajectory->readNum % trajectory->framesNum];
+    if (frame->atoms.size == 0 && frame->moments.count == 0)
+    {
+        return;
+    }
+    frame->model = trajectory->readNum + 1;
+    if (trajectory->options->threadsNum == 0)
+    {
+        analyzeFrame(frame, trajectory->options);
+    }
+    pthread_mutex_lock(&trajectory->lock);
+    frame->state = trajectory->options->threadsNum == 0 ? FRAME_ANALYZED : FRAME_READ;
+    trajectory->readNum++;
+    pthread_cond_broadcast(&trajectory->changed);
+    pthread_mutex_unlock(&trajectory->lock);
+    sink->atoms = NULL;
+    sink->moments = NULL;
+}
+
+/**
+ *This function is the endModel of the sink of a trajectory: it submits the model that was read and waits for the
+ * next frame to be free, printing the models that are ready meanwhile
+ *
+ * @param sink - The sink, its context is the trajectory
+ * @return 0, the frames are allocated in advance
+ */
+int endFrame(AtomSink *sink)
+{
+    Trajectory *trajectory = (Trajectory *) sink->context;
+    submitFrame(trajectory, sink);
+    pthread_mutex_lock(&trajectory->lock);
+    Frame *frame = &trajectory->frames[trajectory->readNum % trajectory->framesNum];
+    printFrames(trajectory);
+    while (frame->state != FRAME_FREE)
+    {
+        pthread_cond_wait(&trajectory->changed, &trajectory->lock);
+        printFrames(trajectory);
+    }
+    pthread_mutex_unlock(&trajectory->lock);
+    frame->atoms.size = 0;
+    memset(&frame->moments, 0, sizeof(Moments));
+    sink->atoms = trajectory->options->streaming ? NULL : &frame->atoms;
+    sink->moments = trajectory->options->streaming ? &frame->moments : NULL;
+    return 0;
+}
+
+/**
+ *This function is the body of a worker of a trajectory: it analyzes the models that were read in order until the
+ * file is over
+ *
+ * @param arg - The Trajectory
+ * @return NULL
+ */
+void *runFrameWorker(void *arg)
+{
+    Trajectory *trajectory = (Trajectory *) arg;
+    pthread_mutex_lock(&trajectory->lock);
+    while (1)
+    {
+        while (trajectory->analyzedNext >= trajectory->readNum && !trajectory->finished)
+        {
+            pthread_cond_wait(&trajectory->changed, &trajectory->lock);
+        }
+        if (trajectory->analyzedNext >= trajectory->readNum)
+        {
+            break;
+        }
+        Frame *frame = &trajectory->frames[trajectory->analyzedNext++ % trajectory->framesNum];
+        pthread_mutex_unlock(&trajectory->lock);
+        analyzeFrame(frame, trajectory->options);
+        pthread_mutex_lock(&trajectory->lock);
+        frame->state = FRAME_ANALYZED;
+        pthread_cond_broadcast(&trajectory->changed);
+    }
+    pthread_mutex_unlock(&trajectory->lock);
+    return NULL;
+}
+
+/**
+ *This function analyzes the given file model by model and prints the results of every model as a time series. The
+ * file is read once and only FRAMES_PER_THREAD frames per thread are kept, so the number of models is not limited.
+ * Atoms out of MODEL .. ENDMDL records are a model of their own, so a file without models is one model.
+ *
+ * @param fileName - The name of the file
+ * @param options - The options of the run
+ * @return if successful returns 0 and FAILURE otherwise
+ */
+int analyzeTrajectory(const char *fileName, const Options *options)
+{
+    char error[ERROR_LEN];
+    size_t i;
+    int t, startedNum = 0;
+    Options serial = *options;
+    Trajectory trajectory = {fileName, options, NULL, 0, 0, 0, 0, 0, PTHREAD_MUTEX_INITIALIZER,
+                             PTHREAD_COND_INITIALIZER};
+    AtomSink sink = {NULL, NULL, endFrame, &trajectory, &options->selection, NULL};
+    trajectory.framesNum = options->threadsNum > 0 ? (size_t) options->threadsNum * FRAMES_PER_THREAD : 1;
+    trajectory.frames = (Frame *) calloc(trajectory.framesNum, sizeof(Frame));
+    pthread_t *threads = (pthread_t *) malloc((options->threadsNum > 0 ? options->threadsNum : 1) * sizeof(pthread_t));
+    if (trajectory.frames == NULL || threads == NULL)
+    {
+        fprintf(stderr, "Error - out of memory\n");
+        free(trajectory.frames);
+        free(threads);
+        return FAILURE;
+    }
+    for (t = 0; t < options->threadsNum; t++)
+    {
+        startedNum += pthread_create(&threads[startedNum], NULL, runFrameWorker, &trajectory) == 0;
+    }
+    if (startedNum == 0 && options->threadsNum > 0)
+    {
+        serial.threadsNum = 0; // no worker could start, the frames are analyzed as they are read
+        trajectory.options = &serial;
+    }
+
+    sink.atoms = options->streaming ? NULL : &trajectory.frames[0].atoms;
+    sink.moments = options->streaming ? &trajectory.frames[0].moments : NULL;
+    long numOfAtoms = readAtoms(fileName, &sink, error);
+    if (numOfAtoms > 0)
+    {
+        submitFrame(&trajectory, &sink); // the atoms after the last ENDMDL
+    }
+
+    pthread_mutex_lock(&trajectory.lock);
+    trajectory.finished = 1;
+    pthread_cond_broadcast(&trajectory.changed);
+    printFrames(&trajectory);
+    while (trajectory.printedNum < trajectory.readNum)
+    {
+        pthread_cond_wait(&trajectory.changed, &trajectory.lock);
+        printFrames(&trajectory);
+    }
+    pthread_mutex_unlock(&trajectory.lock);
+    for (t = 0; t < startedNum; t++)
+    {
+        pthread_join(threads[t], NULL);
+    }
+    for (i = 0; i < trajectory.framesNum; i++)
+    {
+        freeAtoms(&trajectory.frames[i].atoms);
+    }
+    free(trajectory.frames);
+    free(threads);
+
+    if (numOfAtoms == 0)
+    {
+        snprintf(error, ERROR_LEN, "Error - 0 atoms were found in the file %s", fileName);
+    }
+    if (numOfAtoms <= 0)
+    {
+        fflush(stdout);
+        fprintf(stderr, "%s\n", error);
+        return FAILURE;
+    }
+    printf("%ld models, %ld atoms were read\n", trajectory.readNum, numOfAtoms);
+    return 0;
+}
+
+/**
+ *This function analyzes the given files one after the other and stops at the first file that fails
+ *
+ * @return if successful returns 0 and FAILURE otherwise
+ */
+int analyzeFiles(char **fileNames, size_t filesNum, const Options *options)
+{
+    size_t i;
+    int result = 0;
+    Atoms atoms = {NULL, NULL, NULL, 0, 0};
+    Analysis analysis;
+    for (i = 0; i < filesNum && result == 0; i++)
+    {
+        analysis.fileName = fileNames[i];
+        analysis.options = options;
+        if (options->perModel)
+        {
+            result = analyzeTrajectory(fileNames[i], options);
+            continue;
+        }
+        analyzeFile(&analysis, &atoms);
+        result = reportAnalysis(&analysis);
+        free(analysis.histogram.counts);
+        freeContacts(&analysis.contacts);
+    }
+    freeAtoms(&atoms);
+    return result;
+}
+
+/**
+ *This function analyzes the given files on options->threadsNum threads and prints the results in the order of the
+ * files as soon as they are ready. A file that fails is reported and the rest of the files are still analyzed.
+ *
+ * @return if every file was analyzed returns 0 and FAILURE otherwise
+ */
+int analyzeFilesParallel(char **fileNames, size_t filesNum, const Options *options)
+{
+    size_t i;
+    int t, startedNum = 0, result = 0;
+    AnalysisPool pool = {NULL, filesNum, 0, PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER};
+    pthread_t *threads = (pthread_t *) malloc(options->threadsNum * sizeof(pthread_t));
+    pool.analyses = (Analysis *) calloc(filesNum, sizeof(Analysis));
+    if (threads == NULL || pool.analyses == NULL)
+    {
+        fprintf(stderr, "Error - out of memory\n");
+        free(threads);
+        free(pool.analyses);
+        return FAILURE;
+    }
+    for (i = 0; i < filesNum; i++)
+    {
+        pool.analyses[i].fileName = fileNames[i];
+        pool.analyses[i].options = options;
+    }
+    for (t = 0; t < options->threadsNum && (size_t) t < filesNum; t++)
+    {
+        startedNum += pthread_create(&threads[startedNum], NULL, runAnalysisWorker, &pool) == 0;
+    }
+    if (startedNum == 0)
+    {
+        runAnalysisWorker(&pool);
+    }
+    for (i = 0; i < filesNum; i++)
+    {
+        pthread_mutex_lock(&pool.lock);
+        while (!pool.analyses[i].done)
+        {
+            pthread_cond_wait(&pool.analyzed, &pool.lock);
+        }
+        pthread_mutex_unlock(&pool.lock);
+        result |= reportAnalysis(&pool.analyses[i]);
+        free(pool.analyses[i].histogram.counts);
+        freeContacts(&pool.analyses[i].contacts);
+    }
+    for (t = 0; t < startedNum; t++)
+    {
+        pthread_join(threads[t], NULL);
+    }
+    free(threads);
+    free(pool.analyses);
+    return result;
+}
+
+/**
+ *This function reads the atoms of the given file for the RMSD matrix, from its cache if the cache option is set and
+ * the cache is valid
+ *
+ * @param fileName - The name of the file
+ * @param options - The options of the run
+ * @param atoms - Container for the atoms of the file, empty
+ * @param error - Container of ERROR_LEN characters for the reason of a failure
+ * @return if successful returns 0 and FAILURE otherwise
+ */
+int loadStructure(const char *fileName, const Options *options, Atoms *atoms, char *error)
+{
+    SourceStamp stamp;
+    AtomSink sink = {atoms, NULL, NULL, NULL, &options->selection, options->cache ? &stamp : NULL};
+    Atoms cached;
+    void *mapping;
+    size_t mappingLen, i;
+    if (options->cache && loadCache(fileName, &options->selection, &cached, &mapping, &mappingLen) == 0)
+    {
+        for (i = 0; i < cached.size; i++)
+        {
+            const float coordinates[NUM_OF_COORDS] = {cached.x[i], cached.y[i], cached.z[i]};
+            if (appendAtom(atoms, coordinates) == FAILURE)
+            {
+                munmap(mapping, mappingLen);
+                snprintf(error, ERROR_LEN, "Error - out of memory while reading the file %s", fileName);
+                return FAILURE;
+            }
+        }
+        munmap(mapping, mappingLen);
+        return 0;
+    }
+    long numOfAtoms = readAtoms(fileName, &sink, error);
+    if (numOfAtoms == 0)
+    {
+        snprintf(error, ERROR_LEN, "Error - 0 atoms were found in the file %s", fileName);
+    }
+    if (numOfAtoms <= 0)
+    {
+        return FAILURE;
+    }
+    if (options->cache)
+    {
+        writeCache(fileName, &options->selection, &stamp, atoms);
+    }
+    return 0;
+}
+
+/**
+ *This function writes the given RMSD matrix to a file, see RmsdHeader
+ *
+ * @return if successful returns 0 and FAILURE otherwise
+ */
+int writeRmsdMatrix(const char *matrixName, const double *matrix, size_t filesNum, size_t numOfAtoms)
+{
+    RmsdHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, RMSD_MAGIC, sizeof(RMSD_MAGIC));
+    header.filesNum = filesNum;
+    header.numOfAtoms = numOfAtoms;
+    FILE *matrixFile = fopen(matrixName, "wb");
+    if (matrixFile == NULL)
+    {
+        fprintf(stderr, "Error opening file: %s\n", matrixName);
+        return FAILURE;
+    }
+    int failed = fwrite(&header, sizeof(header), 1, matrixFile) != 1 ||
+                 fwrite(matrix, sizeof(double), filesNum * filesNum, matrixFile) != filesNum * filesNum;
+    failed |= fclose(matrixFile) != 0;
+    if (failed)
+    {
+        fprintf(stderr, "Error writing file: %s\n", matrixName);
+        return FAILURE;
+    }
+    return 0;
+}
+
+/**
+ *This function superposes every pair of the given files and writes the matrix of their RMSDs to
+ * options->rmsdMatrix. All the structures are kept in memory, centered, and the pairs are compared on
+ * options->threadsNum threads, or on as many threads as the work is worth without -j.
+ *
+ * @param fileNames - The files, their atoms are matched by their order in the files
+ * @param filesNum - The number of files
+ * @param options - The options of the run
+ * @return if successful returns 0 and FAILURE otherwise
+ */
+int compareFiles(char **fileNames, size_t filesNum, const Options *options)
+{
+    char error[ERROR_LEN];
+    size_t i, t, startedNum = 0;
+    int result = 0;
+    RmsdPool pool = {NULL, NULL, filesNum, 1, 0, 0, NULL, PTHREAD_MUTEX_INITIALIZER};
+    Atoms *structures = (Atoms *) calloc(filesNum, sizeof(Atoms));
+    double *squares = (double *) malloc(filesNum * sizeof(double));
+    pool.matrix = (double *) calloc(filesNum * filesNum, sizeof(double));
+    if (structures == NULL || squares == NULL || pool.matrix == NULL)
+    {
+        fprintf(stderr, "Error - out of memory\n");
+        free(structures);
+        free(squares);
+        free(pool.matrix);
+        return FAILURE;
+    }
+    for (i = 0; i < filesNum && result == 0; i++)
+    {
+        result = loadStructure(fileNames[i], options, &structures[i], error);
+        if (result == 0 && structures[i].size != structures[0].size)
+        {
+            snprintf(error, ERROR_LEN, "Error - the file %s has %zu atoms and the file %s has %zu atoms",
+                     fileNames[i], structures[i].size, fileNames[0], structures[0].size);
+            result = FAILURE;
+        }
+        if (result == 0)
+        {
+            squares[i] = centerAtoms(&structures[i]);
+        }
+    }
+
+    if (result == 0)
+    {
+        size_t bytesPerStructure = structures[0].size * NUM_OF_COORDS * sizeof(float);
+        size_t work = filesNum * (filesNum - 1) / 2 * structures[0].size;
+        size_t threadsNum = options->threadsNum > 0 ? (size_t) options->threadsNum :
+                            getThreadsNum(work, RMSD_MIN_WORK_PER_THREAD);
+        pthread_t *threads = (pthread_t *) malloc(threadsNum * sizeof(pthread_t));
+        pool.structures = structures;
+        pool.squares = squares;
+        // the two sides of a tile share the cache
+        pool.tileSize = RMSD_TILE_BYTES / 2 / bytesPerStructure > 1 ? RMSD_TILE_BYTES / 2 / bytesPerStructure : 1;
+        pool.tilesPerSide = (filesNum + pool.tileSize - 1) / pool.tileSize;
+        for (t = 1; t < threadsNum && threads != NULL; t++)
+        {
+            startedNum += pthread_create(&threads[startedNum], NULL, runRmsdWorker, &pool) == 0;
+        }
+        runRmsdWorker(&pool);
+        for (t = 0; t < startedNum; t++)
+        {
+            pthread_join(threads[t], NULL);
+        }
+        free(threads);
+        result = writeRmsdMatrix(options->rmsdMatrix, pool.matrix, filesNum, structures[0].size);
+        if (result == 0)
+        {
+            printf("RMSD matrix of %zu files, %zu atoms each, was written to %s\n", filesNum, structures[0].size,
+                   options->rmsdMatrix);
+        }
+    }
+    else
+    {
+        fflush(stdout);
+        fprintf(stderr, "%s\n", error);
+    }
+    for (i = 0; i < filesNum; i++)
+    {
+        freeAtoms(&structures[i]);
+    }
+    free(structures);
+    free(squares);
+    free(pool.matrix);
+    return result;
+}
+
+/**
+ *This function reads the options at the start of the arguments, the first argument that is not an option is the
+ * first file. Options that the run would ignore are invalid: -r, -n and -p can't be combined with -s or -m, and
+ * -x can only be combined with -j, -c and -a.
+ *
+ * @param options - Container for the options
+ * @return The index of the first file or -1 if the options are invalid
+ */
+int parseOptions(int argc, char **argv, Options *options)
+{
+    int i = 1;
+    options->threadsNum = 0;
+    options->streaming = 0;
+    options->perModel = 0;
+    options->cache = 0;
+    options->cutoff = 0;
+    options->contactMap = 0;
+    options->binWidth = 0;
+    options->rmsdMatrix = NULL;
+    compileSelection("", &options->selection);
+    while (i < argc)
+    {
+        if (strcmp(argv[i], JOBS_FLAG) == 0)
+        {
+            options->threadsNum = i + 1 < argc ? atoi(argv[i + 1]) : 0;
+            if (options->threadsNum <= 0)
+            {
+                return -1;
+            }
+            i += 2;
+        }
+        else if (strcmp(argv[i], STREAM_FLAG) == 0)
+        {
+            options->streaming = 1;
+            i++;
+        }
+        else if (strcmp(argv[i], MODEL_FLAG) == 0)
+        {
+            options->perModel = 1;
+            i++;
+        }
+        else if (strcmp(argv[i], CACHE_FLAG) == 0)
+        {
+            options->cache = 1;
+            i++;
+        }
+        else if (strcmp(argv[i], CONTACTS_FLAG) == 0)
+        {
+            options->cutoff = i + 1 < argc ? strtof(argv[i + 1], NULL) : 0;
+            if (!(options->cutoff > 0))
+            {
+                return -1;
+            }
+            i += 2;
+        }
+        else if (strcmp(argv[i], CONTACT_MAP_FLAG) == 0)
+        {
+            options->contactMap = 1;
+            i++;
+        }
+        else if (strcmp(argv[i], HISTOGRAM_FLAG) == 0)
+        {
+            options->binWidth = i + 1 < argc ? strtof(argv[i + 1], NULL) : 0;
+            if (!(options->binWidth > 0))
+            {
+                return -1;
+            }
+            i += 2;
+        }
+        else if (strcmp(argv[i], SELECT_FLAG) == 0)
+        {
+            if (i + 1 >= argc)
+            {
+                return -1;
+            }
+            if (compileSelection(argv[i + 1], &options->selection) == FAILURE)
+            {
+                fprintf(stderr, "Error - invalid selection: %s\n", argv[i + 1]);
+                return -1;
+            }
+            i += 2;
+        }
+        else if (strcmp(argv[i], RMSD_FLAG) == 0)
+        {
+            if (i + 1 >= argc)
+            {
+                return -1;
+            }
+            options->rmsdMatrix = argv[i + 1];
+            i += 2;
+        }
+        else
+        {
+            break;
+        }
+    }
+    if (options->contactMap && !(options->cutoff > 0))
+    {
+        return -1; // a contact map needs a cutoff
+    }
+    if ((options->cutoff > 0 || options->binWidth > 0) && (options->streaming || options->perModel))
+    {
+        return -1; // the contacts and P(r) are taken over the atoms of a whole file, a streaming run keeps no atoms
+    }
+    if (options->rmsdMatrix != NULL && (options->streaming || options->perModel || options->cutoff > 0 ||
+                                        options->binWidth > 0))
+    {
+        return -1; // the files are only superposed as whole structures, -n was checked with -r
+    }
+    return i;
+}
+
+/**
+ *Runs the AnalyzeProtein program, with -j N the files are analyzed on N threads, with -s only Cg and Rg are
+ * calculated, while reading, with -m every model of a file is analyzed on its own and with -c the atoms of the files
+ * are cached in binary caches next to them, with -r R the contacts closer than R are counted (and with -n the
+ * neighbors of every atom and the contact map are printed) and with -p W the P(r) of every file is printed in bins
+ * of W, neither of them with -s or -m. With -a S only the atoms of the selection S are read. With -x M the files
+ * are superposed instead and the matrix of their RMSDs is written to M, only -j, -c and -a apply then.
+ *
+ * @return if successful returns 0 and 1 otherwise
+ */
+int main(int argc, char **argv)
+{
+    Options options;
+    int first = parseOptions(argc, argv, &options);
+    if (first < 0 || first >= argc) // Too few arguments
+    {
+        fprintf(stdout, "Usage: AnalyzeProtein [-j <threads>] [-s] [-m] [-c] [-r <cutoff> [-n]] [-p <bin width>] "
+                        "[-a <selection>] [-x <matrix>] <pdb1> <pdb2> ...\n");
+        return FAILURE;
+    }
+    if (options.rmsdMatrix != NULL)
+    {
+        return compareFiles(argv + first, (size_t) (argc - first), &options);
+    }
+    if (options.threadsNum > 0 && !options.perModel)
+    {
+        return analyzeFilesParallel(argv + first, (size_t) (argc - first), &options);
+    }
+    return analyzeFiles(argv + first, (size_t) (argc - first), &options);
+}
@@ -0,0 +1,138 @@
+/**
+ * @file testDmax.c
+ *
+ * @brief Checks the convex hull Dmax against the all pairs Dmax.
+ *
+ * @section DESCRIPTION
+ * getDmax compares only the vertices of the convex hull of the atoms, getDmaxBruteForce compares every pair. Both
+ * must find the same maximum distance on seeded random clouds and on the clouds that are degenerate for the hull:
+ * lattices, spherical shells, flat and collinear clouds and clouds of duplicated atoms, around HULL_MIN_ATOMS and
+ * well above it. The coordinates are rounded to the 3 decimals of a PDB file.
+ * Output : one line per cloud with both distances, the exit status is non zero if any cloud disagrees.
+ * Build  : gcc -O2 -Wall -Wextra tests/testDmax.c -lm -pthread -o testDmax (from the Protein Analyzer directory)
+ */
+
+// ------------------------------ includes ------------------------------
+
+#define main analyzeProtein
+#include "../AnalyzeProtein.c"
+#undef main
+
+// -------------------------- const definitions -------------------------
+
+#define SEED 20181002
+
+#define CLOUD_SIZES_NUM 5
+
+#define MAX_COORDINATE 100.0
+
+// ------------------------------ globals -----------------------------
+
+/**
+ * The numbers of atoms of every kind of cloud, around HULL_MIN_ATOMS and above it
+ */
+const size_t cloudSizes[CLOUD_SIZES_NUM] = {2, HULL_MIN_ATOMS - 1, HULL_MIN_ATOMS, HULL_MIN_ATOMS + 1, 20000};
+
+// ------------------------------ functions -----------------------------
+
+/**
+ * @return a uniform random number in [-1, 1)
+ */
+double randomUnit()
+{
+    return 2.0 * rand() / ((double) RAND_MAX + 1) - 1;
+}
+
+/**
+ *This function appends an atom rounded to the precision of a PDB file
+ *
+ * @return if successful returns 0 and FAILURE if there is no memory
+ */
+int appendRounded(Atoms *atoms, double x, double y, double z)
+{
+    float coordinates[NUM_OF_COORDS] = {(float) (round(x * COORD_SCALE) / COORD_SCALE),
+                                        (float) (round(y * COORD_SCALE) / COORD_SCALE),
+                                        (float) (round(z * COORD_SCALE) / COORD_SCALE)};
+    return appendAtom(atoms, coordinates);
+}
+
+/**
+ *This function creates a cloud of the given kind and size
+ *
+ * @param kind - random, lattice, shell, flat, collinear or duplicate
+ * @return if successful returns 0 and FAILURE if there is no memory
+ */
+int createCloud(const char *kind, size_t size, Atoms *atoms)
+{
+    size_t i, side = (size_t) ceil(cbrt((double) size));
+    int status = 0;
+    for (i = 0; i < size && status == 0; i++)
+    {
+        if (strcmp(kind, "random") == 0)
+        {
+            status = appendRounded(atoms, MAX_COORDINATE * randomUnit(), MAX_COORDINATE * randomUnit(),
+                                   MAX_COORDINATE * randomUnit());
+        }
+        else if (strcmp(kind, "lattice") == 0)
+        {
+            status = appendRounded(atoms, 1.5 * (double) (i % side), 1.5 * (double) (i / side % side),
+                                   1.5 * (double) (i / side / side));
+        }
+        else if (strcmp(kind, "shell") == 0)
+        {
+            double x = randomUnit(), y = randomUnit(), z = randomUnit();
+            double norm = sqrt(x * x + y * y + z * z) + 1e-12;
+            status = appendRounded(atoms, MAX_COORDINATE * x / norm, MAX_COORDINATE * y / norm,
+                                   MAX_COORDINATE * z / norm);
+        }
+        else if (strcmp(kind, "flat") == 0)
+        {
+            double u = randomUnit(), v = randomUnit();
+            status = appendRounded(atoms, MAX_COORDINATE * (u + v), MAX_COORDINATE * (u - v), 12.5);
+        }
+        else if (strcmp(kind, "collinear") == 0)
+        {
+            double t = MAX_COORDINATE * randomUnit();
+            status = appendRounded(atoms, t, 2 * t, -t);
+        }
+        else
+        {
+            // 7 atoms that are not on a plane, each repeated over and over
+            double j = (double) (i % 7);
+            status = appendRounded(atoms, j * j, (double) (i % 7 * 3 % 5), (double) (i % 7 % 2) - 0.125);
+        }
+    }
+    return status;
+}
+
+/**
+ *This function compares getDmax with getDmaxBruteForce on every kind and size of cloud
+ *
+ * @return if all the clouds agree returns 0 and FAILURE otherwise
+ */
+int main()
+{
+    const char *kinds[] = {"random", "lattice", "shell", "flat", "collinear", "duplicate"};
+    size_t k, s;
+    int failed = 0;
+    srand(SEED);
+    for (k = 0; k < sizeof(kinds) / sizeof(kinds[0]); k++)
+    {
+        for (s = 0; s < CLOUD_SIZES_NUM; s++)
+        {
+            Atoms atoms = {NULL, NULL, NULL, 0, 0};
+            if (createCloud(kinds[k], cloudSizes[s], &atoms) == FAILURE)
+            {
+                fprintf(stderr, "Error: out of memory\n");
+                freeAtoms(&atoms);
+                return FAILURE;
+            }
+            float dMax = getDmax(&atoms), expected = getDmaxBruteForce(&atoms, NULL);
+            printf("%s atoms=%zu dmax=%.4f brute_force=%.4f %s\n", kinds[k], atoms.size, dMax, expected,
+                   dMax == expected ? "ok" : "MISMATCH");
+            failed |= dMax != expected;
+            freeAtoms(&atoms);
+        }
+    }
+    return failed ? FAILURE : 0;
+}
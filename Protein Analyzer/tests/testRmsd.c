@@ -0,0 +1,182 @@
+/**
+ * @file testRmsd.c
+ *
+ * @brief Checks the QCP RMSD of getRmsd on superpositions whose RMSD is known.
+ *
+ * @section DESCRIPTION
+ * A copy of a structure that is rotated and moved must have an RMSD of 0 from it. A mirror image can't be rotated
+ * onto the structure: the best rotation mirrors it back through the plane of its smallest spread, so each atom is
+ * off by twice its distance from that plane. The mirrored clouds have the 8 sign combinations of every point, so
+ * their principal axes are x, y and z, and with z the thinnest the expected RMSD is 2 * sqrt(sum(z^2) / n).
+ * Output : one line per structure with the RMSD and the expected RMSD, the exit status is non zero if any of them
+ * is off by more than RMSD_TOLERANCE.
+ * Build  : gcc -O2 -Wall -Wextra tests/testRmsd.c -lm -pthread -o testRmsd (from the Protein Analyzer directory)
+ */
+
+// ------------------------------ includes ------------------------------
+
+#define main analyzeProtein
+#include "../AnalyzeProtein.c"
+#undef main
+
+// -------------------------- const definitions -------------------------
+
+#define SEED 20181002
+
+#define STRUCTURE_SIZES_NUM 4
+
+#define MAX_COORDINATE 30.0
+
+#define RMSD_TOLERANCE 1e-3
+
+// ------------------------------ globals -----------------------------
+
+/**
+ * The numbers of points of the structures, the mirrored ones have 8 atoms per point
+ */
+const size_t structureSizes[STRUCTURE_SIZES_NUM] = {1, 3, 100, 5000};
+
+// ------------------------------ functions -----------------------------
+
+/**
+ * @return a uniform random number in [-1, 1)
+ */
+double randomUnit()
+{
+    return 2.0 * rand() / ((double) RAND_MAX + 1) - 1;
+}
+
+/**
+ *This function creates a random rotation matrix from a random unit quaternion
+ *
+ * @param rotation - Container for the rotation
+ */
+void createRotation(double rotation[NUM_OF_COORDS][NUM_OF_COORDS])
+{
+    double w = randomUnit(), x = randomUnit(), y = randomUnit(), z = randomUnit();
+    double norm = sqrt(w * w + x * x + y * y + z * z) + 1e-12;
+    w /= norm;
+    x /= norm;
+    y /= norm;
+    z /= norm;
+    rotation[0][0] = 1 - 2 * (y * y + z * z);
+    rotation[0][1] = 2 * (x * y - w * z);
+    rotation[0][2] = 2 * (x * z + w * y);
+    rotation[1][0] = 2 * (x * y + w * z);
+    rotation[1][1] = 1 - 2 * (x * x + z * z);
+    rotation[1][2] = 2 * (y * z - w * x);
+    rotation[2][0] = 2 * (x * z - w * y);
+    rotation[2][1] = 2 * (y * z + w * x);
+    rotation[2][2] = 1 - 2 * (x * x + y * y);
+}
+
+/**
+ *This function appends to the copy the rotated and moved copies of the atoms of the structure
+ *
+ * @param mirror - if non zero the copy is a mirror image, x is negated before the rotation
+ * @return if successful returns 0 and FAILURE if there is no memory
+ */
+int createCopy(const Atoms *structure, int mirror, Atoms *copy)
+{
+    double rotation[NUM_OF_COORDS][NUM_OF_COORDS];
+    double shift[NUM_OF_COORDS] = {MAX_COORDINATE * randomUnit(), MAX_COORDINATE * randomUnit(),
+                                   MAX_COORDINATE * randomUnit()};
+    size_t i;
+    int j, status = 0;
+    createRotation(rotation);
+    for (i = 0; i < structure->size && status == 0; i++)
+    {
+        double point[NUM_OF_COORDS] = {mirror ? -structure->x[i] : structure->x[i], structure->y[i], structure->z[i]};
+        float coordinates[NUM_OF_COORDS];
+        for (j = 0; j < NUM_OF_COORDS; j++)
+        {
+            coordinates[j] = (float) (rotation[j][0] * point[0] + rotation[j][1] * point[1] +
+                                      rotation[j][2] * point[2] + shift[j]);
+        }
+        status = appendAtom(copy, coordinates);
+    }
+    return status;
+}
+
+/**
+ *This function creates a random structure, or with symmetric the 8 sign combinations of random points that are
+ * farther from the yz plane than from the xz plane and farther from the xz plane than from the xy plane
+ *
+ * @param pointsNum - The number of random points
+ * @return if successful returns 0 and FAILURE if there is no memory
+ */
+int createStructure(size_t pointsNum, int symmetric, Atoms *structure)
+{
+    size_t i;
+    int signs, status = 0;
+    for (i = 0; i < pointsNum && status == 0; i++)
+    {
+        double x = MAX_COORDINATE * randomUnit(), y = MAX_COORDINATE * randomUnit(), z = MAX_COORDINATE * randomUnit();
+        if (!symmetric)
+        {
+            float coordinates[NUM_OF_COORDS] = {(float) x, (float) y, (float) z};
+            status = appendAtom(structure, coordinates);
+            continue;
+        }
+        for (signs = 0; signs < 8 && status == 0; signs++)
+        {
+            double far = 4 * MAX_COORDINATE + x, middle = 2 * MAX_COORDINATE + y;
+            float coordinates[NUM_OF_COORDS] = {(float) (signs & 1 ? far : -far),
+                                                (float) (signs & 2 ? middle : -middle), (float) (signs & 4 ? z : -z)};
+            status = appendAtom(structure, coordinates);
+        }
+    }
+    return status;
+}
+
+/**
+ *This function centers the structure and its copy and compares their RMSD with the expected one
+ *
+ * @return 0 if the RMSD is within RMSD_TOLERANCE of the expected one and FAILURE otherwise
+ */
+int checkRmsd(const char *kind, Atoms *structure, Atoms *copy, double expected)
+{
+    double squares = centerAtoms(structure) + centerAtoms(copy);
+    double rmsd = getRmsd(structure, copy, squares);
+    int failed = !(fabs(rmsd - expected) <= RMSD_TOLERANCE);
+    printf("%s atoms=%zu rmsd=%.6f expected=%.6f %s\n", kind, structure->size, rmsd, expected,
+           failed ? "MISMATCH" : "ok");
+    return failed ? FAILURE : 0;
+}
+
+/**
+ *This function compares getRmsd with the known RMSD of rotated copies and of mirror images
+ *
+ * @return if all the structures agree returns 0 and FAILURE otherwise
+ */
+int main()
+{
+    size_t s, i;
+    int mirror, failed = 0;
+    srand(SEED);
+    for (mirror = 0; mirror <= 1; mirror++)
+    {
+        for (s = 0; s < STRUCTURE_SIZES_NUM; s++)
+        {
+            Atoms structure = {NULL, NULL, NULL, 0, 0}, copy = {NULL, NULL, NULL, 0, 0};
+            if (createStructure(structureSizes[s], mirror, &structure) == FAILURE ||
+                createCopy(&structure, mirror, &copy) == FAILURE)
+            {
+                fprintf(stderr, "Error: out of memory\n");
+                freeAtoms(&structure);
+                freeAtoms(&copy);
+                return FAILURE;
+            }
+            double expected = 0;
+            for (i = 0; mirror && i < structure.size; i++)
+            {
+                expected += (double) structure.z[i] * structure.z[i];
+            }
+            expected = 2 * sqrt(expected / (double) structure.size);
+            failed |= checkRmsd(mirror ? "mirror" : "rotated", &structure, &copy, expected) == FAILURE;
+            freeAtoms(&structure);
+            freeAtoms(&copy);
+        }
+    }
+    return failed ? FAILURE : 0;
+}